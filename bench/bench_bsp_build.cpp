@@ -0,0 +1,91 @@
+// BSP build time against worker count. Every parallel build is checked
+// against the serial one, node for node.
+//
+// Usage: bench_bsp_build [grid_size] [runs]
+
+#include "bench_levels.h"
+#include "game/bsp.h"
+#include "platform/thread_pool.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace {
+
+template <typename T>
+bool same_array(const core::FlatArray<T>& a, const core::FlatArray<T>& b) {
+    return a.size() == b.size() && memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0;
+}
+
+bool same_tree(const game::BSPTree& a, const game::BSPTree& b) {
+    return same_array(a.get_nodes(), b.get_nodes()) &&
+           same_array(a.get_subsectors(), b.get_subsectors()) &&
+           same_array(a.get_subsector_vertices(), b.get_subsector_vertices()) &&
+           same_array(a.get_segs(), b.get_segs());
+}
+
+// Median wall time of several builds, in milliseconds
+double time_build(const game::Level& level, const game::BSPBuildConfig& config,
+                  int runs, game::BSPTree& tree) {
+    std::vector<double> times;
+    for (int i = 0; i < runs; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        tree.build_from_level(level, config);
+        times.push_back(std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start).count());
+    }
+    std::sort(times.begin(), times.end());
+    return times[times.size() / 2];
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    uint32_t grid = argc > 1 ? static_cast<uint32_t>(atoi(argv[1])) : 200;
+    int runs = argc > 2 ? std::max(atoi(argv[2]), 1) : 3;
+
+    game::Level level = bench::make_grid_level(grid, grid, 1234);
+    printf("grid %ux%u: %zu sectors, %u hardware threads\n",
+           grid, grid, level.get_sectors().size(), std::thread::hardware_concurrency());
+
+    // Serial reference: no subtree tasks, no parallel splitter scoring
+    platform::ThreadPool serial_pool(1);
+    game::BSPBuildConfig serial_config;
+    serial_config.task_cutoff = 0;
+    serial_config.parallel_threshold = 0xFFFFFFFFu;
+    serial_config.pool = &serial_pool;
+
+    game::BSPTree reference;
+    double serial_ms = time_build(level, serial_config, runs, reference);
+    const game::BSPBuildStats& stats = reference.get_build_stats();
+    printf("tree: %u nodes, %u leaves, depth %u\n", stats.node_count, stats.leaf_count, stats.max_depth);
+    printf("%8s %10s %8s %s\n", "threads", "ms", "speedup", "identical");
+    printf("%8s %10.1f %8.2f %s\n", "serial", serial_ms, 1.0, "-");
+
+    // Pools of n - 1 workers plus the calling thread
+    unsigned hardware = std::max(std::thread::hardware_concurrency(), 1u);
+    std::vector<unsigned> thread_counts;
+    for (unsigned n = 2; n < hardware; n *= 2) {
+        thread_counts.push_back(n);
+    }
+    thread_counts.push_back(std::max(hardware, 2u));
+
+    bool all_identical = true;
+    for (unsigned threads : thread_counts) {
+        platform::ThreadPool pool(threads - 1);
+        game::BSPBuildConfig config;
+        config.pool = &pool;
+
+        game::BSPTree tree;
+        double ms = time_build(level, config, runs, tree);
+        bool identical = same_tree(tree, reference);
+        all_identical &= identical;
+        printf("%8u %10.1f %8.2f %s\n", threads, ms, serial_ms / ms, identical ? "yes" : "NO");
+    }
+
+    return all_identical ? 0 : 1;
+}
@@ -0,0 +1,145 @@
+// Floor and ceiling triangulation of whole levels against worker count:
+// the BSP sub-sectors of a jittered arena (convex), and a level of star
+// shaped sectors with no tree (concave, ear clipped). Every parallel build
+// is checked against a serial one, index for index.
+//
+// Usage: bench_floor_triangulation [grid_size] [runs]
+
+#include "bench_levels.h"
+#include "game/bsp.h"
+#include "game/floor_triangulation.h"
+#include "platform/thread_pool.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+namespace {
+
+double elapsed_ms(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+// Sectors shaped like stars with `points` points, one per grid cell
+game::Level make_star_level(uint32_t side, uint32_t points) {
+    const float pi = 3.14159265f;
+    game::Level level;
+    level.reserve(static_cast<size_t>(side) * side, 0, static_cast<size_t>(side) * side * points * 2);
+    for (uint32_t row = 0; row < side; ++row) {
+        for (uint32_t column = 0; column < side; ++column) {
+            game::SectorDesc sector;
+            float center_x = column * 4.0f + 2.0f;
+            float center_z = row * 4.0f + 2.0f;
+            for (uint32_t i = 0; i < points * 2; ++i) {
+                float angle = pi * static_cast<float>(i) / static_cast<float>(points);
+                float radius = (i % 2 == 0) ? 1.9f : 0.8f;
+                sector.vertices.emplace_back(center_x + radius * cosf(angle),
+                                             center_z + radius * sinf(angle));
+                game::Wall wall;
+                wall.vertex_a = i;
+                wall.vertex_b = (i + 1) % (points * 2);
+                sector.walls.push_back(wall);
+            }
+            level.add_sector(sector);
+        }
+    }
+    return level;
+}
+
+// Serial reference: every piece triangulated in order on this thread
+std::vector<uint32_t> triangulate_serial(const game::Level& level, double& ms) {
+    bool by_subsector = level.get_bsp_tree() != nullptr;
+    size_t piece_count = by_subsector ? level.get_bsp_tree()->get_subsectors().size()
+                                      : level.get_sectors().size();
+    auto start = std::chrono::steady_clock::now();
+    std::vector<uint32_t> indices;
+    std::vector<game::Vertex> outline;
+    for (size_t piece = 0; piece < piece_count; ++piece) {
+        uint32_t count = game::FloorTriangulation::get_outline(
+            level, by_subsector, static_cast<uint32_t>(piece), outline);
+        if (count >= 3) {
+            size_t first = indices.size();
+            indices.resize(first + (count - 2) * 3);
+            game::FloorTriangulation::triangulate(outline.data(), count, &indices[first]);
+        }
+    }
+    ms = elapsed_ms(start);
+    return indices;
+}
+
+bool same_triangles(const game::FloorTriangulation& floors, const std::vector<uint32_t>& expected) {
+    size_t position = 0;
+    for (uint32_t piece = 0; piece < floors.get_piece_count(); ++piece) {
+        core::Span<const uint32_t> triangles = floors.get_triangles(piece);
+        if (position + triangles.size() > expected.size() ||
+            !std::equal(triangles.begin(), triangles.end(), expected.begin() + position)) {
+            return false;
+        }
+        position += triangles.size();
+    }
+    return position == expected.size();
+}
+
+bool run_level(const char* name, const game::Level& level, int runs) {
+    double serial_ms = 0.0;
+    std::vector<uint32_t> expected = triangulate_serial(level, serial_ms);
+    for (int i = 1; i < runs; ++i) {
+        double ms = 0.0;
+        triangulate_serial(level, ms);
+        serial_ms = std::min(serial_ms, ms);
+    }
+    size_t triangles = expected.size() / 3;
+    printf("%s: %zu sectors, %zu triangles\n", name, level.get_sectors().size(), triangles);
+    printf("%8s %10s %12s %8s %s\n", "threads", "ms", "Mtri/s", "speedup", "identical");
+    printf("%8s %10.1f %12.1f %8.2f %s\n", "serial", serial_ms, triangles / serial_ms / 1000.0, 1.0, "-");
+
+    // Pools of n - 1 workers plus the calling thread
+    unsigned hardware = std::max(std::thread::hardware_concurrency(), 1u);
+    std::vector<unsigned> thread_counts;
+    for (unsigned n = 2; n < hardware; n *= 2) {
+        thread_counts.push_back(n);
+    }
+    thread_counts.push_back(std::max(hardware, 2u));
+
+    bool all_identical = true;
+    for (unsigned threads : thread_counts) {
+        platform::ThreadPool pool(threads - 1);
+        game::FloorTriangulation floors;
+        double best_ms = 0.0;
+        for (int i = 0; i < runs; ++i) {
+            auto start = std::chrono::steady_clock::now();
+            floors.build(level, &pool);
+            double ms = elapsed_ms(start);
+            best_ms = i == 0 ? ms : std::min(best_ms, ms);
+        }
+        bool identical = same_triangles(floors, expected);
+        all_identical &= identical;
+        printf("%8u %10.1f %12.1f %8.2f %s\n", threads, best_ms, triangles / best_ms / 1000.0,
+               serial_ms / best_ms, identical ? "yes" : "NO");
+    }
+    return all_identical;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    uint32_t grid = argc > 1 ? static_cast<uint32_t>(atoi(argv[1])) : 500;
+    int runs = argc > 2 ? std::max(atoi(argv[2]), 1) : 3;
+
+    game::LevelGeneratorConfig config =
+        bench::room_level_config(game::LevelLayout::ARENA, grid, grid, 1234, 4.0f);
+    config.corner_jitter = 0.2f;
+    game::Level arena = game::LevelGenerator::generate(config);
+    arena.build_bsp();
+    bool identical = run_level("arena sub-sectors", arena, runs);
+
+    // Fewer, bigger sectors: 8 points, 16 corners each
+    uint32_t star_grid = std::max(grid / 2, 1u);
+    identical &= run_level("star sectors", make_star_level(star_grid, 8), runs);
+
+    return identical ? 0 : 1;
+}
@@ -0,0 +1,118 @@
+// The whole frame pipeline with no window: scripted input drives the game
+// state (movement, collision, hitscan) and a NullRenderer runs visibility
+// and counts what would have been drawn. Runs the open arena twice: with
+// a BSP tree and PVS, then portal visibility only. Both have the spatial
+// grid, so collision keeps the walker inside. Then a streamed world of
+// arena chunks, walked across chunk seams while chunks load around it.
+//
+// Usage: bench_headless_frame [grid_size] [frames]
+
+#include "bench_levels.h"
+#include "game/game_state.h"
+#include "game/level_streamer.h"
+#include "rendering/core/null_renderer.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+
+namespace {
+
+double elapsed_ms(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+// Walk forward while sweeping the view from side to side, firing now and
+// then, with pauses on the spot
+platform::InputState scripted_input(int frame) {
+    platform::InputState input;
+    input.forward = (frame / 120) % 4 != 3;
+    input.strafe_left = (frame / 45) % 5 == 0;
+    input.mouse_delta.x = 40.0f * sinf(static_cast<float>(frame) * 0.02f);
+    input.mouse_delta.y = 2.0f * cosf(static_cast<float>(frame) * 0.013f);
+    input.shoot = frame % 15 == 0;
+    return input;
+}
+
+void run(const char* name, game::GameState& state, int frames) {
+    rendering::NullRenderer renderer;
+    const float delta_time = 1.0f / 60.0f;
+
+    double update_ms = 0.0;
+    double render_ms = 0.0;
+    double worst_ms = 0.0;
+    uint64_t sectors = 0;
+    uint64_t quads = 0;
+    uint64_t triangles = 0;
+    uint64_t binds = 0;
+    for (int frame = 0; frame < frames; ++frame) {
+        auto start = std::chrono::steady_clock::now();
+        state.update(delta_time, scripted_input(frame));
+        double update = elapsed_ms(start);
+
+        start = std::chrono::steady_clock::now();
+        renderer.begin_frame();
+        if (const game::LevelStreamer* streamer = state.get_streamer()) {
+            renderer.render_world(*streamer, state.get_camera());
+        } else {
+            renderer.render(state.get_level(), state.get_camera());
+        }
+        renderer.end_frame();
+        double render = elapsed_ms(start);
+
+        update_ms += update;
+        render_ms += render;
+        worst_ms = std::max(worst_ms, update + render);
+        const rendering::NullRenderStats& stats = renderer.get_stats();
+        sectors += stats.sectors;
+        quads += stats.wall_quads;
+        triangles += stats.floor_triangles;
+        binds += stats.texture_binds;
+    }
+
+    double count = static_cast<double>(renderer.get_frame_count());
+    printf("%-12s %10.3f %10.3f %10.3f %9.1f %9.1f %11.1f %7.1f\n", name, update_ms / count,
+           render_ms / count, worst_ms, sectors / count, quads / count, triangles / count, binds / count);
+}
+
+void run(const char* name, game::Level&& level, int frames) {
+    game::GameState state;
+    state.initialize(std::move(level));
+    run(name, state, frames);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    uint32_t grid = argc > 1 ? static_cast<uint32_t>(std::max(atoi(argv[1]), 2)) : 64;
+    int frames = argc > 2 ? std::max(atoi(argv[2]), 1) : 3600;
+
+    printf("%ux%u arena, %d frames at 60 Hz, per frame:\n", grid, grid, frames);
+    printf("%-12s %10s %10s %10s %9s %9s %11s %7s\n", "visibility", "update ms", "render ms",
+           "worst ms", "sectors", "quads", "triangles", "binds");
+
+    game::Level with_tree = bench::make_arena_level(grid, grid, 1234);
+    with_tree.build_bsp();
+    with_tree.build_pvs();
+    with_tree.build_spatial_grid();
+    run("bsp + pvs", std::move(with_tree), frames);
+
+    game::Level portals_only = bench::make_arena_level(grid, grid, 1234);
+    portals_only.build_spatial_grid();
+    run("portals", std::move(portals_only), frames);
+
+    // Chunks of 16x16 rooms, started in the middle of a 16x16 chunk world
+    game::LevelGeneratorConfig generator;
+    generator.layout = game::LevelLayout::ARENA;
+    generator.seed = 1234;
+    auto source = std::make_unique<game::GeneratedChunkSource>(generator, 16, 16);
+    float middle = source->get_chunk_size() * 8.0f;
+    game::GameState streamed;
+    streamed.initialize_streaming(std::make_unique<game::LevelStreamer>(std::move(source)),
+                                  {middle, 0.0f, middle});
+    run("streamed", streamed, frames);
+    return 0;
+}
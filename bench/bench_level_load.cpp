@@ -0,0 +1,70 @@
+// JSON level load times: writes generated room grids of increasing size to
+// level files, then times JsonLevel::load on each (scan, SAX parse, level
+// build) against parsing the same file into an nlohmann DOM.
+//
+// Usage: bench_level_load [max_sectors] [directory]
+
+#include "bench_levels.h"
+#include "game/json_level.h"
+#include <nlohmann/json.hpp>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+namespace {
+
+const uint32_t SEED = 20240611;
+
+double elapsed_ms(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t max_sectors = argc > 1 ? static_cast<size_t>(atol(argv[1])) : 100000;
+    std::string directory = argc > 2 ? argv[2] : ".";
+
+    printf("%9s %9s %9s %9s %9s %9s %9s %9s\n", "sectors", "MB", "scan ms", "parse ms",
+           "build ms", "total ms", "MB/s", "DOM ms");
+    for (size_t target = 1000; target <= max_sectors; target *= 10) {
+        uint32_t side = static_cast<uint32_t>(std::lround(std::sqrt(static_cast<double>(target))));
+        game::Level level = bench::make_grid_level(side, side, SEED);
+
+        std::string path = directory + "/bench_level_" + std::to_string(target) + ".json";
+        std::string error;
+        if (!game::JsonLevel::write(level, path, &error)) {
+            fprintf(stderr, "Cannot write %s: %s\n", path.c_str(), error.c_str());
+            return 1;
+        }
+
+        game::Level loaded;
+        game::JsonLevelStats stats;
+        if (!game::JsonLevel::load(path, loaded, &error, &stats)) {
+            fprintf(stderr, "Cannot load %s: %s\n", path.c_str(), error.c_str());
+            return 1;
+        }
+
+        // Reference: the whole file as a DOM, without building a level
+        std::ifstream file(path);
+        std::stringstream text;
+        text << file.rdbuf();
+        std::string contents = text.str();
+        auto dom_start = std::chrono::steady_clock::now();
+        nlohmann::json dom = nlohmann::json::parse(contents);
+        double dom_ms = elapsed_ms(dom_start);
+
+        double megabytes = static_cast<double>(stats.file_bytes) / (1024.0 * 1024.0);
+        printf("%9u %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f\n", stats.sector_count, megabytes,
+               stats.scan_ms, stats.parse_ms, stats.build_ms, stats.total_ms,
+               megabytes * 1000.0 / stats.total_ms, dom_ms);
+        fflush(stdout);
+        std::remove(path.c_str());
+    }
+    return 0;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "game/level.h"
+#include "game/level_generator.h"
+#include <cstdint>
+
+namespace bench {
+
+// Benchmark levels: square rooms cell_size apart with full-width doorways,
+// 3 units floor to ceiling, no spawns besides the player's. The same seed
+// always gives the same level.
+inline game::LevelGeneratorConfig room_level_config(game::LevelLayout layout, uint32_t width,
+                                                    uint32_t height, uint32_t seed,
+                                                    float cell_size) {
+    game::LevelGeneratorConfig config;
+    config.layout = layout;
+    config.width = width;
+    config.height = height;
+    config.seed = seed;
+    config.cell_size = cell_size;
+    config.floor_levels = 1;
+    config.min_room_height = 3.0f;
+    config.max_room_height = 3.0f;
+    config.spawn_chance = 0.0f;
+    return config;
+}
+
+// Grid of rooms; each pair of neighbouring rooms gets a doorway with
+// door_chance
+inline game::Level make_grid_level(uint32_t width, uint32_t height, uint32_t seed,
+                                   float door_chance = 0.5f, float cell_size = 4.0f) {
+    game::LevelGeneratorConfig config =
+        room_level_config(game::LevelLayout::GRID, width, height, seed, cell_size);
+    config.door_chance = door_chance;
+    return game::LevelGenerator::generate(config);
+}
+
+// Perfect maze of rooms (exactly one path between any two): long
+// corridors, little visible at once
+inline game::Level make_maze_level(uint32_t width, uint32_t height, uint32_t seed,
+                                   float cell_size = 4.0f) {
+    return game::LevelGenerator::generate(
+        room_level_config(game::LevelLayout::MAZE, width, height, seed, cell_size));
+}
+
+// Open arena: every room opens into all its neighbours, with solid pillars
+// (missing rooms) scattered over it and floors at a few step heights, so a
+// lot is visible from anywhere
+inline game::Level make_arena_level(uint32_t width, uint32_t height, uint32_t seed,
+                                    float pillar_chance = 0.1f, float cell_size = 4.0f) {
+    game::LevelGeneratorConfig config =
+        room_level_config(game::LevelLayout::ARENA, width, height, seed, cell_size);
+    config.pillar_chance = pillar_chance;
+    config.floor_levels = 3;
+    config.floor_step = 0.25f;
+    return game::LevelGenerator::generate(config);
+}
+
+} // namespace bench
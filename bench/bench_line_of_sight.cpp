@@ -0,0 +1,84 @@
+// Line-of-sight throughput: SIMD ray packets against the scalar one ray
+// at a time walk, on a room grid with random entity pairs. Both must give
+// the same visibility mask.
+//
+// Usage: bench_line_of_sight [grid_size] [pairs] [max_pair_distance]
+
+#include "bench_levels.h"
+#include "game/line_of_sight.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace {
+
+// Best of several runs of test (or test_scalar), in milliseconds
+template <typename Test>
+double time_runs(int runs, Test&& test) {
+    double best = 1e30;
+    for (int i = 0; i < runs; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        test();
+        best = std::min(best, std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    uint32_t grid = argc > 1 ? static_cast<uint32_t>(atoi(argv[1])) : 100;
+    size_t pair_count = argc > 2 ? static_cast<size_t>(atol(argv[2])) : 100000;
+    float max_distance = argc > 3 ? static_cast<float>(atof(argv[3])) : 24.0f;
+
+    game::Level level = bench::make_grid_level(grid, grid, 42, 0.6f);
+    level.build_bsp();
+
+    game::LineOfSight line_of_sight;
+    line_of_sight.build(level);
+
+    // Entities at eye height, each paired with another nearby one
+    std::mt19937 rng(17);
+    float extent = grid * 4.0f;
+    std::uniform_real_distribution<float> coord(0.1f, extent - 0.1f);
+    std::uniform_real_distribution<float> offset(-max_distance, max_distance);
+    std::uniform_real_distribution<float> eye(0.5f, 2.5f);
+    std::vector<Vector3> from(pair_count);
+    std::vector<Vector3> to(pair_count);
+    for (size_t i = 0; i < pair_count; ++i) {
+        from[i] = {coord(rng), eye(rng), coord(rng)};
+        to[i] = {std::clamp(from[i].x + offset(rng), 0.1f, extent - 0.1f), eye(rng),
+                 std::clamp(from[i].z + offset(rng), 0.1f, extent - 0.1f)};
+    }
+
+    std::vector<uint64_t> scalar_mask;
+    std::vector<uint64_t> packet_mask;
+    double scalar_ms = time_runs(5, [&]() {
+        line_of_sight.test_scalar(from.data(), to.data(), pair_count, scalar_mask);
+    });
+    double packet_ms = time_runs(5, [&]() {
+        line_of_sight.test(from.data(), to.data(), pair_count, packet_mask);
+    });
+
+    size_t visible = 0;
+    for (uint64_t word : packet_mask) {
+        visible += static_cast<size_t>(__builtin_popcountll(word));
+    }
+    bool identical = scalar_mask == packet_mask;
+
+    printf("grid %ux%u: %zu sectors, %zu walls, %zu pairs (%.1f%% visible)\n",
+           grid, grid, level.get_sectors().size(), line_of_sight.get_wall_count(),
+           pair_count, 100.0 * visible / pair_count);
+    printf("%12s %10s %14s %8s\n", "path", "ms", "rays/s", "speedup");
+    printf("%12s %10.2f %14.0f %8.2f\n", "scalar", scalar_ms,
+           pair_count / (scalar_ms / 1000.0), 1.0);
+    printf("%9d-ray %10.2f %14.0f %8.2f\n", game::LineOfSight::get_packet_width(), packet_ms,
+           pair_count / (packet_ms / 1000.0), scalar_ms / packet_ms);
+    printf("identical: %s\n", identical ? "yes" : "NO");
+
+    return identical ? 0 : 1;
+}
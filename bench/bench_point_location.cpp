@@ -0,0 +1,108 @@
+// Point location ("which sector is this point in") through the BSP tree
+// against the linear scan it replaced, for growing room grids. Every BSP
+// answer is checked against the linear one.
+//
+// Usage: bench_point_location [max_sectors] [queries]
+
+#include "bench_levels.h"
+#include "game/bsp.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace {
+
+double elapsed_ms(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+// Reference result: the old linear scan
+int32_t find_sector_linear(const game::Level& level, float x, float z) {
+    const auto& sectors = level.get_sectors();
+    const game::LevelGeometry& geometry = level.get_geometry();
+    for (size_t i = 0; i < sectors.size(); ++i) {
+        const game::Sector& sector = sectors[i];
+        int intersections = 0;
+        for (uint32_t v = 0; v < sector.vertex_count; ++v) {
+            game::Vertex a = geometry.get_vertex(sector, v);
+            game::Vertex b = geometry.get_vertex(sector, (v + 1) % sector.vertex_count);
+            if ((a.z > z) != (b.z > z)) {
+                float x_intersect = a.x + (z - a.z) * (b.x - a.x) / (b.z - a.z);
+                if (x < x_intersect) {
+                    intersections++;
+                }
+            }
+        }
+        if (intersections % 2 == 1) {
+            return static_cast<int32_t>(i);
+        }
+    }
+    return -1;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t max_sectors = argc > 1 ? static_cast<size_t>(atol(argv[1])) : 1000000;
+    size_t query_count = argc > 2 ? static_cast<size_t>(atol(argv[2])) : 100000;
+
+    printf("%10s %10s %12s %12s %12s %10s %s\n", "sectors", "build ms",
+           "linear us", "bsp us", "batch us", "speedup", "identical");
+
+    bool all_identical = true;
+    for (size_t target = 1000; target <= max_sectors; target *= 10) {
+        uint32_t side = static_cast<uint32_t>(std::sqrt(static_cast<double>(target)));
+        game::Level level = bench::make_grid_level(side, side, 99);
+
+        auto build_start = std::chrono::steady_clock::now();
+        level.build_bsp();
+        double build_ms = elapsed_ms(build_start);
+
+        // Points spread over the level and a little beyond it
+        std::mt19937 rng(7);
+        float extent = side * 4.0f;
+        std::uniform_real_distribution<float> coord(-0.05f * extent, 1.05f * extent);
+        std::vector<float> xs(query_count);
+        std::vector<float> zs(query_count);
+        for (size_t i = 0; i < query_count; ++i) {
+            xs[i] = coord(rng);
+            zs[i] = coord(rng);
+        }
+
+        // The linear scan is slow on big levels; time a sample of it
+        size_t linear_count = std::max<size_t>(1, std::min(query_count, 20000000 / target));
+        std::vector<int32_t> expected(linear_count);
+        auto linear_start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < linear_count; ++i) {
+            expected[i] = find_sector_linear(level, xs[i], zs[i]);
+        }
+        double linear_us = elapsed_ms(linear_start) * 1000.0 / linear_count;
+
+        std::vector<int32_t> single(query_count);
+        auto bsp_start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < query_count; ++i) {
+            single[i] = level.find_sector_at_point(xs[i], zs[i]);
+        }
+        double bsp_us = elapsed_ms(bsp_start) * 1000.0 / query_count;
+
+        std::vector<int32_t> batch(query_count);
+        auto batch_start = std::chrono::steady_clock::now();
+        level.find_sectors_at_points(xs.data(), zs.data(), query_count, batch.data());
+        double batch_us = elapsed_ms(batch_start) * 1000.0 / query_count;
+
+        bool identical = single == batch &&
+                         std::equal(expected.begin(), expected.end(), single.begin());
+        all_identical &= identical;
+
+        printf("%10zu %10.1f %12.3f %12.3f %12.3f %9.0fx %s\n", level.get_sectors().size(),
+               build_ms, linear_us, bsp_us, batch_us, linear_us / bsp_us,
+               identical ? "yes" : "NO");
+    }
+
+    return all_identical ? 0 : 1;
+}
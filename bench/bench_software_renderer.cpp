@@ -0,0 +1,117 @@
+// Headless software renderer frame times against worker count: an open
+// arena (lots in view, floor steps) seen from a ring of viewpoints. Every
+// parallel frame is checked against a serial one, pixel for pixel.
+//
+// Usage: bench_software_renderer [width] [height] [frames]
+
+#include "bench_levels.h"
+#include "game/camera.h"
+#include "platform/thread_pool.h"
+#include "rendering/core/software_renderer.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+namespace {
+
+double elapsed_ms(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+// Cameras on a circle round the arena's middle, each looking a different
+// way, at eye height over whatever sector they stand in
+std::vector<game::Camera> make_viewpoints(const game::Level& level, float center, int count) {
+    std::vector<game::Camera> cameras;
+    for (int i = 0; i < count * 4 && static_cast<int>(cameras.size()) < count; ++i) {
+        float angle = 6.2831853f * static_cast<float>(i) / static_cast<float>(count);
+        float x = center + cosf(angle) * center * 0.5f + 0.37f * static_cast<float>(i);
+        float z = center + sinf(angle) * center * 0.5f;
+        int32_t sector = level.find_sector_at_point(x, z);
+        if (sector < 0) {
+            continue;   // Inside a pillar
+        }
+        float eye = level.get_sector(static_cast<uint32_t>(sector)).floor_height + 1.7f;
+        float yaw = angle * 2.0f;
+        float pitch = 0.15f * sinf(angle * 3.0f);
+        Vector3 position = {x, eye, z};
+        Vector3 target = {x + sinf(yaw) * cosf(pitch), eye + sinf(pitch), z + cosf(yaw) * cosf(pitch)};
+        cameras.emplace_back(position, target, 75.0f);
+    }
+    return cameras;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int width = argc > 1 ? std::max(atoi(argv[1]), 16) : 1280;
+    int height = argc > 2 ? std::max(atoi(argv[2]), 16) : 720;
+    int frames = argc > 3 ? std::max(atoi(argv[3]), 1) : 32;
+
+    const uint32_t side = 64;
+    const float cell_size = 4.0f;
+    game::Level level = bench::make_arena_level(side, side, 1234, 0.1f, cell_size);
+    level.build_bsp();
+    std::vector<game::Camera> cameras = make_viewpoints(level, side * cell_size * 0.5f, frames);
+
+    // Serial reference frames
+    platform::ThreadPool serial_pool(0);
+    rendering::SoftwareRendererConfig config;
+    config.width = width;
+    config.height = height;
+    config.pool = &serial_pool;
+    rendering::SoftwareRenderer serial(config);
+    std::vector<std::vector<uint32_t>> expected;
+    double serial_ms = 0.0;
+    for (const game::Camera& camera : cameras) {
+        auto start = std::chrono::steady_clock::now();
+        serial.begin_frame();
+        serial.render(level, camera);
+        serial.end_frame();
+        serial_ms += elapsed_ms(start);
+        core::Span<const uint32_t> pixels = serial.get_framebuffer();
+        expected.emplace_back(pixels.begin(), pixels.end());
+    }
+    serial_ms /= static_cast<double>(cameras.size());
+    const rendering::SoftwareRenderStats& stats = serial.get_stats();
+    printf("%dx%d, %zu frames of a %ux%u arena (last: %u walls, %u columns, %u spans)\n",
+           width, height, cameras.size(), side, side, stats.walls, stats.wall_columns, stats.spans);
+    printf("%8s %10s %10s %8s %s\n", "threads", "ms/frame", "Mpix/s", "speedup", "identical");
+    double megapixels = static_cast<double>(width) * height / 1e6;
+    printf("%8s %10.2f %10.1f %8.2f %s\n", "serial", serial_ms, megapixels / serial_ms * 1000.0, 1.0, "-");
+
+    // Pools of n - 1 workers plus the calling thread
+    unsigned hardware = std::max(std::thread::hardware_concurrency(), 1u);
+    std::vector<unsigned> thread_counts;
+    for (unsigned n = 2; n < hardware; n *= 2) {
+        thread_counts.push_back(n);
+    }
+    thread_counts.push_back(std::max(hardware, 2u));
+
+    bool all_identical = true;
+    for (unsigned threads : thread_counts) {
+        platform::ThreadPool pool(threads - 1);
+        config.pool = &pool;
+        rendering::SoftwareRenderer renderer(config);
+        double total_ms = 0.0;
+        bool identical = true;
+        for (size_t i = 0; i < cameras.size(); ++i) {
+            auto start = std::chrono::steady_clock::now();
+            renderer.begin_frame();
+            renderer.render(level, cameras[i]);
+            renderer.end_frame();
+            total_ms += elapsed_ms(start);
+            core::Span<const uint32_t> pixels = renderer.get_framebuffer();
+            identical &= std::equal(pixels.begin(), pixels.end(), expected[i].begin());
+        }
+        double ms = total_ms / static_cast<double>(cameras.size());
+        all_identical &= identical;
+        printf("%8u %10.2f %10.1f %8.2f %s\n", threads, ms, megapixels / ms * 1000.0,
+               serial_ms / ms, identical ? "yes" : "NO");
+    }
+    return all_identical ? 0 : 1;
+}
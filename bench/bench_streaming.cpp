@@ -0,0 +1,86 @@
+// Level streaming under a moving camera: flies straight across a generated
+// world of chunks at a fixed speed, 60 frames a second in real time, and
+// reports the main-thread cost of LevelStreamer::update (the hitches a
+// player would see), chunks missing under the camera, load latency and
+// resident memory against the budget.
+//
+// Usage: bench_streaming [speed] [seconds] [budget_mb]
+
+#include "game/level_streamer.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace {
+
+double elapsed_ms(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    float speed = argc > 1 ? static_cast<float>(atof(argv[1])) : 40.0f;
+    float seconds = argc > 2 ? static_cast<float>(atof(argv[2])) : 10.0f;
+    double budget_mb = argc > 3 ? atof(argv[3]) : 64.0;
+
+    // 64x64 chunks of 16x16 rooms: a 4096x4096 world, 4M sectors
+    game::LevelGeneratorConfig generator;
+    generator.layout = game::LevelLayout::ARENA;
+    generator.seed = 20240611;
+    const uint32_t rooms_per_chunk = 16;
+    const uint32_t world_chunks = 64;
+
+    game::LevelStreamerConfig config;
+    config.memory_budget = static_cast<size_t>(budget_mb * 1024.0 * 1024.0);
+    game::LevelStreamer streamer(
+        std::make_unique<game::GeneratedChunkSource>(generator, rooms_per_chunk, world_chunks), config);
+
+    // Diagonally across the world from near one corner
+    const float frame_seconds = 1.0f / 60.0f;
+    const int frame_count = static_cast<int>(seconds / frame_seconds);
+    Vector3 position = {32.0f, 1.7f, 32.0f};
+
+    // Start resident around the spawn point, as a level load would
+    streamer.update(position, frame_seconds);
+    streamer.finish_loads();
+
+    std::vector<double> update_times;
+    update_times.reserve(frame_count);
+    int hitches = 0;
+    int misses = 0;
+    for (int frame = 0; frame < frame_count; ++frame) {
+        auto frame_start = std::chrono::steady_clock::now();
+        position.x += speed * 0.7071f * frame_seconds;
+        position.z += speed * 0.7071f * frame_seconds;
+
+        auto update_start = std::chrono::steady_clock::now();
+        streamer.update(position, frame_seconds);
+        update_times.push_back(elapsed_ms(update_start));
+        hitches += update_times.back() > config.hitch_ms;
+        misses += streamer.get_chunk_at(position.x, position.z) == nullptr;
+
+        std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(
+            std::max(frame_seconds * 1000.0 - elapsed_ms(frame_start), 0.0)));
+    }
+
+    std::sort(update_times.begin(), update_times.end());
+    const game::StreamingStats& stats = streamer.get_stats();
+    printf("speed %.0f u/s, %d frames, %.0f-unit chunks, load distance %.0f, budget %.1f MB\n",
+           speed, frame_count, rooms_per_chunk * generator.cell_size, config.load_distance, budget_mb);
+    printf("update ms: p50 %.3f  p99 %.3f  max %.3f  (hitches over %.1f ms: %d)\n",
+           update_times[update_times.size() / 2], update_times[update_times.size() * 99 / 100],
+           update_times.back(), config.hitch_ms, hitches);
+    printf("loads %llu  evictions %llu (budget %llu)  frames with the camera's chunk missing %d\n",
+           static_cast<unsigned long long>(stats.loads), static_cast<unsigned long long>(stats.evictions),
+           static_cast<unsigned long long>(stats.budget_evictions), misses);
+    printf("load latency ms: mean %.1f  max %.1f\n", stats.mean_load_ms, stats.max_load_ms);
+    printf("resident: %u chunks, %.1f MB (peak %.1f MB)\n", stats.resident_chunks,
+           stats.resident_bytes / (1024.0 * 1024.0), stats.peak_bytes / (1024.0 * 1024.0));
+    return 0;
+}
@@ -0,0 +1,226 @@
+// Scaling benchmarks for the BSP and the queries built on it, over room
+// grids, mazes and open arenas from 1k sectors up to max_sectors. Levels
+// come from LevelGenerator with fixed seeds, so runs on different commits
+// measure the same work. Results are written as JSON for comparing runs; a
+// summary goes to stdout.
+//
+// Usage: bench_suite [max_sectors] [output.json] [label]
+
+#include "bench_levels.h"
+#include "game/bsp.h"
+#include "game/pvs.h"
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using json = nlohmann::json;
+
+namespace {
+
+const uint32_t SEED = 20240611;
+
+double elapsed_ms(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+struct LevelKind {
+    const char* name;
+    game::Level (*make)(uint32_t side);
+};
+
+game::Level make_grid(uint32_t side) { return bench::make_grid_level(side, side, SEED); }
+game::Level make_maze(uint32_t side) { return bench::make_maze_level(side, side, SEED); }
+game::Level make_arena(uint32_t side) { return bench::make_arena_level(side, side, SEED); }
+
+// Center of a random sector, at eye height above its floor
+Vector3 random_viewpoint(const game::Level& level, std::mt19937& rng) {
+    const game::Sector& sector = level.get_sector(
+        static_cast<uint32_t>(rng() % level.get_sectors().size()));
+    float x = 0.0f;
+    float z = 0.0f;
+    for (uint32_t i = 0; i < sector.vertex_count; ++i) {
+        game::Vertex v = level.get_geometry().get_vertex(sector, i);
+        x += v.x;
+        z += v.z;
+    }
+    float count = static_cast<float>(sector.vertex_count);
+    return {x / count, sector.floor_height + 1.7f, z / count};
+}
+
+Vector3 random_direction(std::mt19937& rng, float max_pitch) {
+    std::uniform_real_distribution<float> yaw(0.0f, 6.2831853f);
+    std::uniform_real_distribution<float> pitch(-max_pitch, max_pitch);
+    float a = yaw(rng);
+    float b = pitch(rng);
+    return {sinf(a) * cosf(b), sinf(b), cosf(a) * cosf(b)};
+}
+
+json run_level(const LevelKind& kind, uint32_t side) {
+    auto generate_start = std::chrono::steady_clock::now();
+    game::Level level = kind.make(side);
+    double generate_ms = elapsed_ms(generate_start);
+    size_t sector_count = level.get_sectors().size();
+
+    // Tree build: median of a few runs on smaller levels
+    int runs = sector_count <= 100000 ? 3 : 1;
+    std::vector<double> build_times;
+    std::unique_ptr<game::BSPTree> tree;
+    for (int i = 0; i < runs; ++i) {
+        tree = std::make_unique<game::BSPTree>();
+        auto start = std::chrono::steady_clock::now();
+        tree->build_from_level(level);
+        build_times.push_back(elapsed_ms(start));
+    }
+    std::sort(build_times.begin(), build_times.end());
+    game::BSPBuildStats stats = tree->get_build_stats();
+    level.set_precomputed(std::move(tree), nullptr);
+    const game::BSPTree& bsp_tree = *level.get_bsp_tree();
+
+    std::mt19937 rng(SEED);
+
+    // Frustum-culled visible sectors from random viewpoints
+    const size_t view_count = 1000;
+    std::vector<game::Frustum> frustums;
+    for (size_t i = 0; i < view_count; ++i) {
+        frustums.emplace_back(random_viewpoint(level, rng), random_direction(rng, 0.3f),
+                              75.0f, 16.0f / 9.0f, 0.01f);
+    }
+    std::vector<uint32_t> visible;
+    size_t visible_total = 0;
+    auto visible_start = std::chrono::steady_clock::now();
+    for (const game::Frustum& frustum : frustums) {
+        bsp_tree.get_visible_sectors(frustum, visible);
+        visible_total += visible.size();
+    }
+    double visible_ms = elapsed_ms(visible_start);
+
+    // Point location over the level's extent and a little beyond
+    const game::BSPNode& root = *bsp_tree.get_root();
+    std::uniform_real_distribution<float> coord_x(root.bounds.min.x - 1.0f, root.bounds.max.x + 1.0f);
+    std::uniform_real_distribution<float> coord_z(root.bounds.min.z - 1.0f, root.bounds.max.z + 1.0f);
+    const size_t point_count = 100000;
+    std::vector<float> xs(point_count);
+    std::vector<float> zs(point_count);
+    for (size_t i = 0; i < point_count; ++i) {
+        xs[i] = coord_x(rng);
+        zs[i] = coord_z(rng);
+    }
+    size_t inside = 0;
+    auto point_start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < point_count; ++i) {
+        inside += level.find_sector_at_point(xs[i], zs[i]) >= 0;
+    }
+    double point_ms = elapsed_ms(point_start);
+
+    // Hitscan rays from random viewpoints
+    const size_t ray_count = 100000;
+    std::vector<Vector3> origins(ray_count);
+    std::vector<Vector3> directions(ray_count);
+    for (size_t i = 0; i < ray_count; ++i) {
+        origins[i] = random_viewpoint(level, rng);
+        directions[i] = random_direction(rng, 0.2f);
+    }
+    size_t hits = 0;
+    double hit_distance = 0.0;
+    auto ray_start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < ray_count; ++i) {
+        game::RayHit hit;
+        if (bsp_tree.cast_ray(level, origins[i], directions[i], 1e6f, hit)) {
+            hits++;
+            hit_distance += hit.distance;
+        }
+    }
+    double ray_ms = elapsed_ms(ray_start);
+
+    json result;
+    result["level"] = kind.name;
+    result["sectors"] = sector_count;
+    result["generate_ms"] = generate_ms;
+    result["bsp"] = {
+        {"build_ms", build_times[build_times.size() / 2]},
+        {"nodes", stats.node_count},
+        {"leaves", stats.leaf_count},
+        {"max_depth", stats.max_depth},
+        {"splits", stats.split_count},
+    };
+    result["visible_sectors"] = {
+        {"queries", view_count},
+        {"us_per_query", visible_ms * 1000.0 / view_count},
+        {"mean_visible", static_cast<double>(visible_total) / view_count},
+    };
+    result["find_sector_at_point"] = {
+        {"queries", point_count},
+        {"us_per_query", point_ms * 1000.0 / point_count},
+        {"inside_fraction", static_cast<double>(inside) / point_count},
+    };
+    result["ray_cast"] = {
+        {"rays", ray_count},
+        {"us_per_ray", ray_ms * 1000.0 / ray_count},
+        {"hit_fraction", static_cast<double>(hits) / ray_count},
+        {"mean_distance", hits > 0 ? hit_distance / hits : 0.0},
+    };
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t max_sectors = argc > 1 ? static_cast<size_t>(atol(argv[1])) : 1000000;
+    std::string output_path = argc > 2 ? argv[2] : "";
+    std::string label = argc > 3 ? argv[3] : "";
+
+    const LevelKind kinds[] = {
+        {"grid", make_grid},
+        {"maze", make_maze},
+        {"arena", make_arena},
+    };
+
+    json report;
+    report["label"] = label;
+    report["seed"] = SEED;
+    report["timestamp"] = static_cast<int64_t>(std::time(nullptr));
+    report["hardware_threads"] = std::thread::hardware_concurrency();
+    report["results"] = json::array();
+
+    printf("%-6s %9s %10s %10s %8s %10s %10s\n", "level", "sectors", "build ms",
+           "visible us", "visible", "point us", "ray us");
+    for (size_t target = 1000; target <= max_sectors; target *= 10) {
+        uint32_t side = static_cast<uint32_t>(std::lround(std::sqrt(static_cast<double>(target))));
+        for (const LevelKind& kind : kinds) {
+            json result = run_level(kind, side);
+            printf("%-6s %9zu %10.1f %10.2f %8.1f %10.3f %10.3f\n", kind.name,
+                   result["sectors"].get<size_t>(),
+                   result["bsp"]["build_ms"].get<double>(),
+                   result["visible_sectors"]["us_per_query"].get<double>(),
+                   result["visible_sectors"]["mean_visible"].get<double>(),
+                   result["find_sector_at_point"]["us_per_query"].get<double>(),
+                   result["ray_cast"]["us_per_ray"].get<double>());
+            fflush(stdout);
+            report["results"].push_back(result);
+        }
+    }
+
+    if (output_path.empty()) {
+        std::cout << report.dump(2) << std::endl;
+    } else {
+        std::ofstream file(output_path);
+        if (!file) {
+            fprintf(stderr, "Cannot write %s\n", output_path.c_str());
+            return 1;
+        }
+        file << report.dump(2) << std::endl;
+    }
+    return 0;
+}
@@ -18,13 +18,15 @@ public:
         int window_height;
         int target_fps;
         bool fullscreen;
+        bool streaming;     // Stream a generated world instead of the test level
 
         Config()
             : window_title("Yoshi's Wrath")
             , window_width(1280)
             , window_height(720)
             , target_fps(60)
-            , fullscreen(false) {}
+            , fullscreen(false)
+            , streaming(false) {}
     };
 
     Application(const Config& config);
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace core {
+
+// Contiguous array that either owns its elements or borrows them from
+// memory someone else keeps alive (e.g. a memory-mapped file). Reads look
+// the same either way; any write first copies borrowed elements into owned
+// storage. T must be trivially copyable to be borrowed from a file.
+template <typename T>
+class FlatArray {
+public:
+    FlatArray() : m_view(nullptr), m_view_size(0) {}
+
+    // Point at external elements; they must outlive this array (or the
+    // next write to it)
+    void borrow(const T* data, size_t size) {
+        m_owned.clear();
+        m_owned.shrink_to_fit();
+        m_view = data;
+        m_view_size = size;
+    }
+
+    bool is_borrowed() const { return m_view != nullptr; }
+
+    // Read access
+    const T* data() const { return m_view ? m_view : m_owned.data(); }
+    size_t size() const { return m_view ? m_view_size : m_owned.size(); }
+    bool empty() const { return size() == 0; }
+    const T& operator[](size_t index) const { return data()[index]; }
+    const T& back() const { return data()[size() - 1]; }
+    const T* begin() const { return data(); }
+    const T* end() const { return data() + size(); }
+
+    // Owned storage for writing, copying borrowed elements in first
+    std::vector<T>& edit() {
+        if (m_view) {
+            m_owned.assign(m_view, m_view + m_view_size);
+            m_view = nullptr;
+            m_view_size = 0;
+        }
+        return m_owned;
+    }
+
+    // Vector-style writes used while building
+    T& operator[](size_t index) { return edit()[index]; }
+    void clear() { m_view = nullptr; m_view_size = 0; m_owned.clear(); }
+    void reserve(size_t count) { edit().reserve(count); }
+    void push_back(const T& value) { edit().push_back(value); }
+    void emplace_back() { edit().emplace_back(); }
+    void assign(size_t count, const T& value) { clear(); m_owned.assign(count, value); }
+
+    template <typename Iterator>
+    void append(Iterator first, Iterator last) {
+        std::vector<T>& owned = edit();
+        owned.insert(owned.end(), first, last);
+    }
+
+private:
+    std::vector<T> m_owned;
+    const T* m_view;
+    size_t m_view_size;
+};
+
+} // namespace core
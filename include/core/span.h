@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+
+namespace core {
+
+// Non-owning view of a contiguous run of elements (std::span stand-in
+// until the project moves past C++17)
+template <typename T>
+class Span {
+public:
+    Span() : m_data(nullptr), m_size(0) {}
+    Span(T* data, size_t size) : m_data(data), m_size(size) {}
+
+    T* data() const { return m_data; }
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    T& operator[](size_t index) const { return m_data[index]; }
+    T* begin() const { return m_data; }
+    T* end() const { return m_data + m_size; }
+
+private:
+    T* m_data;
+    size_t m_size;
+};
+
+} // namespace core
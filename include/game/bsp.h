@@ -1,9 +1,19 @@
 #pragma once
 
 #include "game/level.h"
+#include "game/frustum.h"
+#include "core/flat_array.h"
+#include <algorithm>
+#include <array>
 #include <vector>
-#include <memory>
+#include <cmath>
 #include <cstdint>
+#include <memory>
+#include <utility>
+
+namespace platform {
+class ThreadPool;
+}
 
 namespace game {
 
@@ -19,22 +29,201 @@ struct BSPSplitter {
         : x(x_val), z(z_val), dx(dx_val), dz(dz_val) {}
 };
 
-// BSP node in the tree
+// Piece of a sector wall that lies inside one sub-sector (Doom "seg").
+// Oriented like the wall it came from (vertex_a towards vertex_b).
+struct BSPSeg {
+    Vertex start;
+    Vertex end;
+    uint32_t wall;          // Index into the sector's wall list
+    float offset;           // Distance from the wall's start to this seg's start
+
+    BSPSeg() : start(), end(), wall(0), offset(0.0f) {}
+};
+
+// First solid wall a ray runs into
+struct RayHit {
+    uint32_t sector;        // Sector owning the wall
+    uint32_t wall;          // Index into that sector's wall list
+    float distance;         // Along the ray, from its origin
+    Vector3 point;
+
+    RayHit() : sector(0), wall(0), distance(0.0f), point{0.0f, 0.0f, 0.0f} {}
+};
+
+// Convex fragment of a sector left after clipping by every splitter above
+// its leaf (Doom "ssector"). Each piece of level geometry lives in exactly
+// one sub-sector.
+struct BSPSubSector {
+    uint32_t sector;        // Sector this fragment was cut from
+
+    // Fragment outline in the tree's sub-sector vertex array
+    uint32_t first_vertex;
+    uint32_t vertex_count;
+
+    // Wall pieces bounding the fragment in the tree's seg array
+    uint32_t first_seg;
+    uint32_t seg_count;
+
+    BSPSubSector()
+        : sector(0)
+        , first_vertex(0)
+        , vertex_count(0)
+        , first_seg(0)
+        , seg_count(0) {}
+};
+
+// Sentinel for a missing child in the flat node array
+constexpr uint32_t BSP_NULL_NODE = 0xFFFFFFFFu;
+
+// BSP node in the tree (stored by value in one contiguous array)
 struct BSPNode {
     BSPSplitter splitter;
 
-    // Indices of sectors visible from this node
-    std::vector<uint32_t> sector_indices;
+    // Child node indices into the tree's node array (BSP_NULL_NODE if absent)
+    uint32_t front;
+    uint32_t back;
 
-    // Child nodes (nullptr if leaf)
-    std::unique_ptr<BSPNode> front;
-    std::unique_ptr<BSPNode> back;
+    // Range of sub-sectors in this node's subtree (the leaf's own
+    // sub-sectors for a leaf); subtrees are stored contiguously
+    uint32_t first_subsector;
+    uint32_t subsector_count;
+
+    // World-space box around everything in the subtree (XZ from the
+    // fragment outlines, Y from floor to ceiling)
+    BoundingBox bounds;
 
     bool is_leaf() const {
-        return front == nullptr && back == nullptr;
+        return front == BSP_NULL_NODE && back == BSP_NULL_NODE;
     }
 
-    BSPNode() : splitter(), sector_indices(), front(nullptr), back(nullptr) {}
+    BSPNode()
+        : splitter()
+        , front(BSP_NULL_NODE)
+        , back(BSP_NULL_NODE)
+        , first_subsector(0)
+        , subsector_count(0)
+        , bounds{{0.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 0.0f}} {}
+};
+
+// Tuning for BSP construction. Splitter candidates are scored as
+//   balance_weight * |front - back| + split_weight * spanning
+// over the node's sector fragments, and the cheapest one wins.
+struct BSPBuildConfig {
+    float split_weight;             // Cost per fragment cut by the candidate line
+    float balance_weight;           // Cost per fragment of front/back imbalance
+
+    // Candidate walls scored per node. Lower builds faster, higher gives
+    // better trees; 0 scores every wall (can be very slow on big maps).
+    uint32_t max_candidates;
+
+    // Score candidates on the thread pool once candidates * fragments
+    // reaches this many classifications
+    uint32_t parallel_threshold;
+
+    // Build a node's front and back subtrees as separate pool tasks when it
+    // holds at least this many fragments; below it recursion stays serial.
+    // 0 never splits off tasks. The tree is the same either way.
+    uint32_t task_cutoff;
+
+    int max_depth;                  // Clamped to BSPTree::MAX_DEPTH
+
+    // Pool for parallel work; nullptr uses the shared pool
+    platform::ThreadPool* pool;
+
+    BSPBuildConfig()
+        : split_weight(8.0f)
+        , balance_weight(1.0f)
+        , max_candidates(128)
+        , parallel_threshold(1u << 16)
+        , task_cutoff(2048)
+        , max_depth(48)
+        , pool(nullptr) {}
+};
+
+// Shape of the last built tree
+struct BSPBuildStats {
+    uint32_t node_count;
+    uint32_t leaf_count;
+    uint32_t subsector_count;
+    uint32_t max_depth;
+    uint32_t max_leaf_size;         // Most sub-sectors stored in a single leaf
+    float average_leaf_size;
+    uint32_t split_count;           // Fragments cut in two by a splitter
+    double build_time_ms;
+
+    BSPBuildStats()
+        : node_count(0)
+        , leaf_count(0)
+        , subsector_count(0)
+        , max_depth(0)
+        , max_leaf_size(0)
+        , average_leaf_size(0.0f)
+        , split_count(0)
+        , build_time_ms(0.0) {}
+};
+
+// Counters from a frustum-culled traversal
+struct BSPCullStats {
+    uint32_t nodes_visited;         // Nodes tested against the frustum
+    uint32_t nodes_culled;          // Subtrees rejected (counted once at their root)
+    uint32_t subsectors_culled;     // Sub-sectors inside rejected subtrees
+    uint32_t subsectors_visible;
+
+    BSPCullStats()
+        : nodes_visited(0)
+        , nodes_culled(0)
+        , subsectors_culled(0)
+        , subsectors_visible(0) {}
+};
+
+// A built tree's arrays, laid out exactly as BSPTree stores them
+struct BSPFlatData {
+    const BSPNode* nodes;
+    uint32_t node_count;
+    const BSPSubSector* subsectors;
+    uint32_t subsector_count;
+    const Vertex* subsector_vertices;
+    uint32_t subsector_vertex_count;
+    const BSPSeg* segs;
+    uint32_t seg_count;
+
+    BSPFlatData()
+        : nodes(nullptr)
+        , node_count(0)
+        , subsectors(nullptr)
+        , subsector_count(0)
+        , subsector_vertices(nullptr)
+        , subsector_vertex_count(0)
+        , segs(nullptr)
+        , seg_count(0) {}
+};
+
+// The part of a level a BSPTree::rebuild_from() reads: the changed
+// sectors and every other sector with pieces in a leaf the changed ones,
+// old shape or new, can reach. Ranges point into the input's own geometry,
+// so a small edit snapshots a small part of the level.
+struct BSPRebuildInput {
+    uint32_t sector_count;              // Sectors in the whole level
+    std::vector<uint32_t> indices;      // Level index of each sector below, ascending
+    std::vector<Sector> sectors;
+    LevelGeometry geometry;
+    std::vector<uint32_t> changed;      // Level indices of the edited sectors
+
+    // Sectors with an area (3+ corners) gained by the edits, for the stats
+    int32_t area_sector_change;
+
+    BSPRebuildInput()
+        : sector_count(0)
+        , area_sector_change(0) {}
+
+    // Sector by level index, nullptr if it isn't in the input
+    const Sector* find(uint32_t level_index) const {
+        auto it = std::lower_bound(indices.begin(), indices.end(), level_index);
+        if (it == indices.end() || *it != level_index) {
+            return nullptr;
+        }
+        return &sectors[it - indices.begin()];
+    }
 };
 
 // BSP tree for level spatial partitioning
@@ -44,44 +233,375 @@ public:
     ~BSPTree() = default;
 
     // Build BSP tree from level sectors
-    void build_from_level(const Level& level);
+    void build_from_level(const Level& level,
+                          const BSPBuildConfig& config = BSPBuildConfig());
 
-    // Get visible sectors from a point (for rendering)
+    // Build a tree for the edited level by reusing previous, its tree from
+    // before input.changed were edited. Subtrees that hold none of the
+    // changed sectors, old or new shape, are copied as they are; only the
+    // rest is rebuilt. Sector indices must be stable. If previous isn't
+    // built the input must hold every sector.
+    void rebuild_from(const BSPTree& previous, const BSPRebuildInput& input);
+
+    // Call visit(sector_index) for each sector with pieces in a leaf that a
+    // shape inside the XZ box could reach in rebuild_from(), repeats
+    // included; such sectors must be in its input
+    template <typename Visitor>
+    void for_each_sector_reached(float min_x, float min_z, float max_x, float max_z,
+                                 Visitor&& visit) const;
+
+    // Use an already built tree in place, without copying (e.g. straight
+    // out of a memory-mapped cooked level). backing owns that memory and is
+    // kept alive as long as the tree uses it.
+    void attach(std::shared_ptr<const void> backing, const BSPFlatData& data,
+                const BSPBuildStats& stats);
+
+    // Get visible sectors from a point, front to back. A sector that was
+    // split across several leaves is reported once per fragment; use a
+    // VisibilityQuery for a de-duplicated, allocation-free list.
     void get_visible_sectors(const Vector3& camera_pos,
                             std::vector<uint32_t>& visible_sectors) const;
 
-    // Get the root node
-    const BSPNode* get_root() const { return m_root.get(); }
+    // Get visible sub-sector indices from a point, front to back (for rendering)
+    void get_visible_subsectors(const Vector3& camera_pos,
+                               std::vector<uint32_t>& visible_subsectors) const;
+
+    // Frustum-culled variants: subtrees whose bounds lie outside the
+    // frustum are skipped. Order is front to back from the frustum origin.
+    void get_visible_sectors(const Frustum& frustum,
+                            std::vector<uint32_t>& visible_sectors,
+                            BSPCullStats* stats = nullptr) const;
+    void get_visible_subsectors(const Frustum& frustum,
+                               std::vector<uint32_t>& visible_subsectors,
+                               BSPCullStats* stats = nullptr) const;
+
+    // Index of the leaf node containing a point, or BSP_NULL_NODE if the
+    // point falls into empty space outside the level
+    uint32_t find_leaf(float x, float z) const;
+
+    // Call visit(leaf_index) for every leaf whose sub-sectors may cover a
+    // point: the one find_leaf() gives, plus the far side of any splitter
+    // the point is within tolerance of. Sub-sectors are cut with that
+    // tolerance, so near a splitter they can reach across it.
+    template <typename Visitor>
+    void for_each_leaf_near(float x, float z, Visitor&& visit) const;
+
+    // Call visit(leaf_index) for every leaf whose bounds overlap an XZ box
+    template <typename Visitor>
+    void for_each_leaf_in_box(float min_x, float min_z, float max_x, float max_z,
+                              Visitor&& visit) const;
+
+    // Cast a ray from origin along direction (any length) for up to
+    // max_distance and report the first solid wall it hits. Portal walls
+    // let the ray through where it passes inside their opening and stop it
+    // above or below. Floors and ceilings are not tested. Leaves are walked
+    // front to back along the ray and the walk stops at the first hit.
+    // The level must be the one the tree was built from.
+    bool cast_ray(const Level& level, const Vector3& origin, const Vector3& direction,
+                  float max_distance, RayHit& hit) const;
+
+    // Get the root node (always index 0 of the node array)
+    const BSPNode* get_root() const { return m_nodes.empty() ? nullptr : &m_nodes[0]; }
+
+    // Flat node storage access
+    const BSPNode& get_node(uint32_t index) const { return m_nodes[index]; }
+    const core::FlatArray<BSPNode>& get_nodes() const { return m_nodes; }
+
+    // Sub-sector storage; leaves own contiguous runs of sub-sectors, which
+    // in turn own runs of the vertex and seg arrays
+    const BSPSubSector& get_subsector(uint32_t index) const { return m_subsectors[index]; }
+    const core::FlatArray<BSPSubSector>& get_subsectors() const { return m_subsectors; }
+    const core::FlatArray<Vertex>& get_subsector_vertices() const { return m_subsector_vertices; }
+    const core::FlatArray<BSPSeg>& get_segs() const { return m_segs; }
 
     // Check if tree is built
-    bool is_built() const { return m_root != nullptr; }
+    bool is_built() const { return !m_nodes.empty(); }
+
+    // Statistics from the last build
+    const BSPBuildStats& get_build_stats() const { return m_stats; }
+
+    // Deepest node the builder will create; bounds the traversal stack
+    static constexpr int MAX_DEPTH = 64;
+
+    // Distance from a splitter within which a point counts as on it
+    static constexpr float CLASSIFY_EPSILON = 0.001f;
 
 private:
-    std::unique_ptr<BSPNode> m_root;
+    static constexpr int MAX_STACK = MAX_DEPTH + 2;
+
+    // Outline edge of a build fragment, running points[i] -> points[i + 1]
+    struct FragmentEdge {
+        int32_t wall;           // Sector wall index, -1 if laid down by a splitter
+        bool reversed;          // Wall runs points[i + 1] -> points[i]
+        Vertex wall_start;      // Wall's own start point, for texture offsets
+    };
+
+    // Convex sector piece being pushed down the tree during the build
+    struct BuildFragment {
+        uint32_t sector;
+        float floor_height;
+        float ceiling_height;
+        std::vector<Vertex> points;
+        std::vector<FragmentEdge> edges;
+    };
+
+    // Built in place, or borrowed from m_backing after attach()
+    core::FlatArray<BSPNode> m_nodes;
+    core::FlatArray<BSPSubSector> m_subsectors;
+    core::FlatArray<Vertex> m_subsector_vertices;
+    core::FlatArray<BSPSeg> m_segs;
+    std::shared_ptr<const void> m_backing;
+    BSPBuildConfig m_config;
+    BSPBuildStats m_stats;
+
+    // Array sizes of a tree, or of the part of one before some point
+    struct BuildSizes {
+        size_t nodes;
+        size_t subsectors;
+        size_t vertices;
+        size_t segs;
+
+        BuildSizes operator+(const BuildSizes& other) const {
+            return {nodes + other.nodes, subsectors + other.subsectors,
+                    vertices + other.vertices, segs + other.segs};
+        }
+    };
+
+    // A node's two subtrees, built by pool tasks into trees of their own
+    // and left there until splice_parts()
+    struct Splice {
+        uint32_t node;                  // Own node they are the children of
+        BuildSizes cut;                 // Own array sizes when they were built
+        BuildSizes before;              // Sizes of the earlier splices' parts
+        std::unique_ptr<BSPTree> front;
+        std::unique_ptr<BSPTree> back;
+        BuildSizes front_sizes;         // Spliced sizes of each
+        BuildSizes back_sizes;
+    };
+
+    // Where a tree's own arrays go in the spliced arrays
+    struct PartPlacement {
+        const BSPTree* tree;
+        BuildSizes base;
+    };
+
+    // Subtrees built by pool tasks, in node order
+    std::vector<Splice> m_splices;
+
+    // Own interior nodes over a splice (splice nodes included), children
+    // first: their ranges and bounds are merged again once it is spliced
+    std::vector<uint32_t> m_merge_again;
+
+    // Walk the tree front to back from a point, calling visit(leaf) per
+    // leaf. With a frustum, subtrees outside it are skipped.
+    template <typename Visitor>
+    void walk_front_to_back(const Vector3& camera_pos, const Frustum* frustum,
+                            BSPCullStats* stats, Visitor&& visit) const;
+
+    // State for one rebuild_from() pass
+    struct RebuildContext {
+        const BSPTree* previous;
+        const BSPRebuildInput* input;
+        std::vector<uint8_t> changed;           // Per sector: 1 if edited
+        std::vector<uint32_t> changed_prefix;   // Edited sub-sectors before each old index
+
+        // Splitters above the node being rebuilt, with the side taken
+        std::vector<std::pair<BSPSplitter, int>> path;
+    };
+
+    // Rebuild the subtree under an old node with the new fragments of the
+    // changed sectors that reach it. Returns BSP_NULL_NODE if it ends up
+    // empty.
+    uint32_t rebuild_node(RebuildContext& context, uint32_t old_index,
+                          std::vector<BuildFragment>& incoming, int depth);
+
+    // Append an unchanged subtree of another tree, rebasing its indices
+    uint32_t copy_subtree(const BSPTree& source, uint32_t source_index, int depth);
+
+    // Clip a whole-sector fragment down to the region at the end of the
+    // rebuild path. Returns false if nothing of it lies there.
+    bool clip_to_path(const RebuildContext& context, BuildFragment& fragment) const;
+
+    // Thread pool the build runs parallel work on
+    platform::ThreadPool& get_pool() const;
+
+    // Build a node's two subtrees as pool tasks, each into its own tree,
+    // and record them as a splice on the node
+    void build_children_parallel(std::vector<BuildFragment>& front_fragments,
+                                 std::vector<BuildFragment>& back_fragments,
+                                 int depth, uint32_t node_index);
+
+    // Own array sizes plus those of every part spliced into this tree
+    BuildSizes get_spliced_sizes() const;
+
+    // Add this tree and, recursively, its parts to out, this tree's own
+    // arrays starting at base
+    void place_parts(const BuildSizes& base, std::vector<PartPlacement>& out) const;
+
+    // Index in the spliced arrays of an element of one of this tree's own
+    // arrays (field picks which), its own arrays starting at base
+    uint32_t get_spliced_index(const BuildSizes& base, size_t BuildSizes::*field,
+                               size_t index) const;
+
+    // Copy this tree's own arrays to their place in the spliced arrays
+    void copy_to_splice(const BuildSizes& base, BSPNode* nodes, BSPSubSector* subsectors,
+                        Vertex* vertices, BSPSeg* segs) const;
+
+    // Move the parts built by pool tasks into this tree's arrays in the
+    // serial build's order. Every part is copied once, the parts side by
+    // side on the pool.
+    void splice_parts();
+
+    // Recursively build BSP tree, returns index of the new node
+    uint32_t build_node(std::vector<BuildFragment>& fragments, int depth);
 
-    // Recursively build BSP tree
-    std::unique_ptr<BSPNode> build_node(const std::vector<uint32_t>& sector_indices,
-                                        const Level& level, int depth);
+    // Full build over the given sectors (build_from_level() body)
+    void build(const std::vector<Sector>& sectors, const LevelGeometry& geometry,
+               const BSPBuildConfig& config);
 
-    // Choose best splitter from available walls
-    BSPSplitter choose_splitter(const std::vector<uint32_t>& sector_indices,
-                               const Level& level) const;
+    // Turn a sector into the root fragment of the build
+    BuildFragment make_fragment(const LevelGeometry& geometry, const Sector& sector,
+                                uint32_t sector_index) const;
+
+    // Store a leaf's fragments as sub-sectors and segs
+    void emit_subsectors(const std::vector<BuildFragment>& fragments, BSPNode& leaf);
+
+    // Fill in an interior node's subtree range and bounds from its children
+    void merge_child_bounds(BSPNode& node) const;
+
+    // Choose the cheapest splitter from the fragments' walls.
+    // Returns false if no wall separates the fragments.
+    bool choose_splitter(const std::vector<BuildFragment>& fragments,
+                         BSPSplitter& splitter) const;
+
+    // Classify a whole fragment: 1 = front, -1 = back, 0 = spanning
+    int classify_fragment(const BSPSplitter& splitter, const BuildFragment& fragment) const;
 
     // Classify a point relative to a splitter
     // Returns: -1 = back, 0 = on line, 1 = front
     int classify_point(const BSPSplitter& splitter, float x, float z) const;
 
-    // Partition sectors based on splitter
-    void partition_sectors(const BSPSplitter& splitter,
-                          const std::vector<uint32_t>& sector_indices,
-                          const Level& level,
-                          std::vector<uint32_t>& front_sectors,
-                          std::vector<uint32_t>& back_sectors,
-                          std::vector<uint32_t>& spanning_sectors) const;
-
-    // Recursively traverse tree to find visible sectors
-    void traverse_node(const BSPNode* node, const Vector3& camera_pos,
-                      std::vector<uint32_t>& visible_sectors) const;
+    // Clip a spanning fragment into the parts in front of and behind the splitter
+    void split_fragment(const BSPSplitter& splitter, const BuildFragment& fragment,
+                        BuildFragment& front, BuildFragment& back) const;
+
+    // Partition fragments based on splitter, cutting the spanning ones
+    void partition_fragments(const BSPSplitter& splitter,
+                            std::vector<BuildFragment>& fragments,
+                            std::vector<BuildFragment>& front_fragments,
+                            std::vector<BuildFragment>& back_fragments);
 };
 
+template <typename Visitor>
+void BSPTree::for_each_leaf_near(float x, float z, Visitor&& visit) const {
+    if (m_nodes.empty()) {
+        return;
+    }
+
+    // Each node pushes at most one extra child, so depth bounds the stack
+    std::array<uint32_t, MAX_STACK> stack;
+    size_t top = 0;
+    stack[top++] = 0;
+
+    while (top > 0) {
+        const BSPNode& node = m_nodes[stack[--top]];
+        if (node.is_leaf()) {
+            visit(static_cast<uint32_t>(&node - m_nodes.data()));
+            continue;
+        }
+
+        // Besides the build tolerance, allow for rounding in the products
+        const BSPSplitter& splitter = node.splitter;
+        float a = (x - splitter.x) * splitter.dz;
+        float b = (z - splitter.z) * splitter.dx;
+        float cross = a - b;
+        float margin = 2.0f * CLASSIFY_EPSILON + (fabsf(a) + fabsf(b)) * 1e-6f;
+
+        if (cross >= -margin && node.front != BSP_NULL_NODE) {
+            stack[top++] = node.front;
+        }
+        if (cross <= margin && node.back != BSP_NULL_NODE) {
+            stack[top++] = node.back;
+        }
+    }
+}
+
+template <typename Visitor>
+void BSPTree::for_each_leaf_in_box(float min_x, float min_z, float max_x, float max_z,
+                                   Visitor&& visit) const {
+    if (m_nodes.empty()) {
+        return;
+    }
+
+    std::array<uint32_t, MAX_STACK> stack;
+    size_t top = 0;
+    stack[top++] = 0;
+
+    while (top > 0) {
+        uint32_t index = stack[--top];
+        const BSPNode& node = m_nodes[index];
+        if (node.bounds.min.x > max_x || node.bounds.max.x < min_x ||
+            node.bounds.min.z > max_z || node.bounds.max.z < min_z) {
+            continue;
+        }
+
+        if (node.is_leaf()) {
+            visit(index);
+            continue;
+        }
+        if (node.front != BSP_NULL_NODE) {
+            stack[top++] = node.front;
+        }
+        if (node.back != BSP_NULL_NODE) {
+            stack[top++] = node.back;
+        }
+    }
+}
+
+template <typename Visitor>
+void BSPTree::for_each_sector_reached(float min_x, float min_z, float max_x, float max_z,
+                                      Visitor&& visit) const {
+    if (m_nodes.empty()) {
+        return;
+    }
+
+    // Fragments are sent down by which side of each splitter they lie on,
+    // so follow every side the box touches (node bounds only cover the
+    // old pieces, not the whole region a leaf stands for)
+    std::array<uint32_t, MAX_STACK> stack;
+    size_t top = 0;
+    stack[top++] = 0;
+
+    while (top > 0) {
+        const BSPNode& node = m_nodes[stack[--top]];
+        if (node.is_leaf()) {
+            for (uint32_t i = 0; i < node.subsector_count; ++i) {
+                visit(m_subsectors[node.first_subsector + i].sector);
+            }
+            continue;
+        }
+
+        const BSPSplitter& splitter = node.splitter;
+        float min_cross = 0.0f;
+        float max_cross = 0.0f;
+        float magnitude = 0.0f;
+        for (int corner = 0; corner < 4; ++corner) {
+            float a = ((corner & 1 ? max_x : min_x) - splitter.x) * splitter.dz;
+            float b = ((corner & 2 ? max_z : min_z) - splitter.z) * splitter.dx;
+            float cross = a - b;
+            min_cross = corner == 0 ? cross : std::min(min_cross, cross);
+            max_cross = corner == 0 ? cross : std::max(max_cross, cross);
+            magnitude = std::max(magnitude, fabsf(a) + fabsf(b));
+        }
+        float margin = 2.0f * CLASSIFY_EPSILON + magnitude * 1e-6f;
+
+        if (max_cross >= -margin && node.front != BSP_NULL_NODE) {
+            stack[top++] = node.front;
+        }
+        if (min_cross <= margin && node.back != BSP_NULL_NODE) {
+            stack[top++] = node.back;
+        }
+    }
+}
+
 } // namespace game
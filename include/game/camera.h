@@ -1,6 +1,7 @@
 #pragma once
 
 #include "raylib.h"
+#include "game/frustum.h"
 #include "platform/input.h"
 
 namespace game {
@@ -26,6 +27,9 @@ public:
     // Get forward direction vector (normalized)
     Vector3 get_forward() const;
 
+    // View frustum for a viewport of the given aspect ratio (width / height)
+    Frustum get_frustum(float aspect, float far_distance = 0.0f) const;
+
     // Setters
     void set_position(const Vector3& position);
     void set_target(const Vector3& target);
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "game/level.h"
+#include "game/level_streamer.h"
+#include "core/span.h"
+#include <vector>
+#include <cstdint>
+
+namespace game {
+
+// Player body used for movement against the level
+struct CollisionConfig {
+    float radius;           // Body radius in XZ
+    float height;           // Feet to top of head
+    float eye_height;       // Feet to camera
+    float step_height;      // Highest floor rise walked up without jumping
+    int max_slides;         // Contacts resolved per move before stopping
+
+    CollisionConfig()
+        : radius(0.3f)
+        , height(1.8f)
+        , eye_height(1.7f)
+        , step_height(0.5f)
+        , max_slides(3) {}
+};
+
+// Swept-circle movement against sector walls with sliding. Solid walls
+// always block; a portal wall blocks unless the body fits through its
+// opening (floor at most a step up, ceiling above the head). Candidate
+// walls come from the level's spatial grid around the move, so the cost
+// depends on the walls nearby, not on the size of the map. Keeps its
+// buffers between moves.
+class PlayerCollision {
+public:
+    explicit PlayerCollision(const CollisionConfig& config = CollisionConfig());
+    ~PlayerCollision() = default;
+
+    // Move a camera (eye) position by delta in XZ, stopping at walls and
+    // sliding along them. The result's height follows the floor of the
+    // sector it ends up in. Without a spatial grid the move is not checked.
+    Vector3 move(const Level& level, const Vector3& eye_position, const Vector3& delta);
+
+    // move() through several streamed chunks side by side. The walls of
+    // each chunk near the move count, except those on its seams
+    // (find_sector_across), which let the body through like a portal into
+    // the sector across. The height follows the floor of whichever chunk
+    // the body ends up in.
+    Vector3 move(core::Span<const ChunkLevel> chunks, const Vector3& eye_position,
+                 const Vector3& delta);
+
+    const CollisionConfig& get_config() const { return m_config; }
+    void set_config(const CollisionConfig& config) { m_config = config; }
+
+    // Walls tested by the last move
+    size_t get_candidate_count() const { return m_walls.size(); }
+
+private:
+    // Blocking wall near the move
+    struct WallSegment {
+        Vertex a;
+        Vertex b;
+    };
+
+    CollisionConfig m_config;
+    std::vector<WallSegment> m_walls;
+
+    // Collect the walls that block a body with its feet at feet_y inside
+    // the box
+    void gather_walls(core::Span<const ChunkLevel> chunks, float feet_y, float min_x,
+                      float min_z, float max_x, float max_z);
+
+    // A body with its feet at feet_y fits through an opening from floor_y
+    // to ceiling_y
+    bool fits(float feet_y, float floor_y, float ceiling_y) const;
+
+    // Push the circle out of any wall it already overlaps
+    void depenetrate(float& x, float& z) const;
+
+    // Earliest time in [0, 1] at which the circle moving by (dx, dz) touches
+    // a wall, with the contact normal; returns a value above 1 for no contact
+    float sweep(float x, float z, float dx, float dz, float& normal_x, float& normal_z) const;
+};
+
+} // namespace game
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "game/level.h"
+#include <cstdint>
+#include <string>
+
+namespace game {
+
+// Binary "cooked" level: sectors, walls, portals, spawns and the prebuilt
+// BSP (and PVS, if built) stored as flat arrays behind a versioned header
+// and a checksum. Loading maps the file and uses the BSP and PVS arrays in
+// place, so load time doesn't depend on how long the tree took to build.
+//
+// Files are written in the host's byte order and struct layout; a file
+// from a different version, byte order or layout is rejected, not fixed up.
+class CookedLevel {
+public:
+    // Bump whenever the file layout or any stored struct changes
+    static constexpr uint32_t VERSION = 2;
+
+    // Write a level with a built BSP tree. Returns false (with a reason in
+    // error, if given) if the tree isn't built or the file can't be written.
+    static bool write(const Level& level, const std::string& path,
+                      std::string* error = nullptr);
+
+    // Map a cooked file and replace level with its contents. On failure
+    // level is left untouched and false is returned.
+    static bool load(const std::string& path, Level& level,
+                     std::string* error = nullptr);
+
+private:
+    CookedLevel() = delete;  // Static class, no instances
+};
+
+} // namespace game
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "game/level.h"
+#include "core/span.h"
+#include <cstdint>
+#include <vector>
+
+namespace platform {
+class ThreadPool;
+}
+
+namespace game {
+
+// Floor and ceiling triangles for every piece of a level, worked out once
+// and kept for as long as the level doesn't change. Pieces are the BSP
+// sub-sectors, or the sectors when there is no tree. Each piece's outline
+// becomes vertex_count - 2 triangles: a fan when it is convex, ear
+// clipping when not. Pieces are triangulated in parallel.
+//
+// Triangles index the piece's outline (get_outline) and wind with positive
+// area in (x, z), i.e. a.x * b.z - b.x * a.z summed over the edges. Texture
+// coordinates are the world x and z, so they aren't stored.
+class FloorTriangulation {
+public:
+    FloorTriangulation();
+    ~FloorTriangulation() = default;
+
+    // Triangulate every piece of the level, on pool (nullptr uses the
+    // shared pool)
+    void build(const Level& level, platform::ThreadPool* pool = nullptr);
+
+    // Built from the level as it is now (same revision)
+    bool is_built_for(const Level& level) const;
+
+    // Pieces are BSP sub-sectors rather than sectors
+    bool is_by_subsector() const { return m_by_subsector; }
+
+    size_t get_piece_count() const {
+        return m_offsets.empty() ? 0 : m_offsets.size() - 1;
+    }
+
+    // Outline indices of piece's triangles, three per triangle
+    core::Span<const uint32_t> get_triangles(uint32_t piece) const {
+        return core::Span<const uint32_t>(m_indices.data() + m_offsets[piece],
+                                          m_offsets[piece + 1] - m_offsets[piece]);
+    }
+
+    // Outline of a piece, written to out (vertex_count of them); returns
+    // the count
+    static uint32_t get_outline(const Level& level, bool by_subsector, uint32_t piece,
+                                std::vector<Vertex>& out);
+
+    // Pieces whose outline wasn't convex
+    uint32_t get_concave_count() const { return m_concave_count; }
+
+    // Triangulate a simple polygon of count >= 3 vertices in either winding
+    // into count - 2 triangles (indices written to out). Returns false if
+    // it wasn't convex.
+    static bool triangulate(const Vertex* vertices, uint32_t count, uint32_t* out);
+
+private:
+    uint64_t m_revision;
+    bool m_by_subsector;
+    uint32_t m_concave_count;
+
+    // Piece p's triangles are m_indices[m_offsets[p] .. [p + 1])
+    std::vector<uint32_t> m_offsets;
+    std::vector<uint32_t> m_indices;
+};
+
+} // namespace game
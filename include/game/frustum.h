@@ -0,0 +1,45 @@
+#pragma once
+
+#include "raylib.h"
+
+namespace game {
+
+// Plane in the form normal . p + distance = 0, normal pointing inside
+struct FrustumPlane {
+    Vector3 normal;
+    float distance;
+
+    FrustumPlane() : normal{0.0f, 0.0f, 0.0f}, distance(0.0f) {}
+};
+
+// View frustum for culling (perspective, world up is +Y)
+class Frustum {
+public:
+    Frustum();
+    Frustum(const Vector3& position, const Vector3& forward,
+            float fov_y, float aspect, float near_distance, float far_distance = 0.0f);
+
+    // Conservative test: false only if the box is fully outside a plane
+    bool intersects_box(const BoundingBox& box) const;
+
+    // Test a single point
+    bool contains_point(const Vector3& point) const;
+
+    // Getters
+    const Vector3& get_position() const { return m_position; }
+    const Vector3& get_forward() const { return m_forward; }
+
+private:
+    static constexpr int MAX_PLANES = 6;
+
+    Vector3 m_position;
+    Vector3 m_forward;
+
+    // Left, right, bottom, top, near, and far if one was given
+    FrustumPlane m_planes[MAX_PLANES];
+    int m_plane_count;
+
+    void add_plane(const Vector3& normal, const Vector3& point);
+};
+
+} // namespace game
@@ -2,8 +2,12 @@
 
 #include "game/level.h"
 #include "game/camera.h"
+#include "game/bsp.h"
+#include "game/collision.h"
+#include "game/level_streamer.h"
 #include "platform/input.h"
 #include <memory>
+#include <vector>
 
 namespace game {
 
@@ -17,21 +21,56 @@ public:
     // Initialize game with a level (takes ownership via move)
     void initialize(Level&& level);
 
+    // Play in a streamed world instead of one level (opt-in). The streamer
+    // keeps the chunks around the player resident; movement collides with
+    // the walls of the chunks it reaches and crosses the seams between
+    // them, and shots carry on across seams. The chunks around position
+    // are loaded before this returns, and the player starts at the spawn
+    // of the chunk there, if it has one.
+    void initialize_streaming(std::unique_ptr<LevelStreamer> streamer, const Vector3& position);
+
     // Update game state
     void update(float delta_time, const platform::InputState& input);
 
     // Getters for rendering
     const Level& get_level() const { return m_level; }
+
+    // Mutable level for editing (sector edits are applied between ticks)
+    Level& get_level() { return m_level; }
     const Camera& get_camera() const { return m_camera; }
 
+    // Streamed world, or nullptr when playing a single level
+    const LevelStreamer* get_streamer() const { return m_streamer.get(); }
+
     // Game state
     bool is_paused() const { return m_is_paused; }
     void set_paused(bool paused) { m_is_paused = paused; }
 
+    // Wall hit by the most recent shot, or nullptr if it hit nothing. When
+    // streaming, its sector is in the chunk under the hit point.
+    const RayHit* get_last_shot() const { return m_has_shot_hit ? &m_last_shot : nullptr; }
+
+    // How far hitscan weapons reach
+    static constexpr float HITSCAN_RANGE = 2048.0f;
+
 private:
     Level m_level;
     Camera m_camera;
+    PlayerCollision m_collision;
     bool m_is_paused;
+
+    RayHit m_last_shot;
+    bool m_has_shot_hit;
+
+    std::unique_ptr<LevelStreamer> m_streamer;
+    std::vector<ChunkLevel> m_nearby_chunks;
+
+    // Seams crossed by one shot before giving up
+    static constexpr int MAX_SEAM_CROSSINGS = 64;
+
+    // Movement and hitscan against the streamed chunks
+    Vector3 move_streamed(const Vector3& eye_position, const Vector3& delta);
+    bool cast_streamed(const Vector3& origin, const Vector3& direction, RayHit& hit);
 };
 
 } // namespace game
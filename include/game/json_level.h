@@ -0,0 +1,68 @@
+#pragma once
+
+#include "game/level.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace game {
+
+// Timings of a JSON level load
+struct JsonLevelStats {
+    size_t file_bytes;
+    uint32_t sector_count;
+    uint32_t chunk_count;       // Parallel sector/portal batches parsed
+    double scan_ms;             // Finding the top-level arrays and their elements
+    double parse_ms;            // SAX parsing the elements
+    double build_ms;            // Adding the parsed sectors to the level
+    double total_ms;
+
+    JsonLevelStats()
+        : file_bytes(0)
+        , sector_count(0)
+        , chunk_count(0)
+        , scan_ms(0.0)
+        , parse_ms(0.0)
+        , build_ms(0.0)
+        , total_ms(0.0) {}
+};
+
+// Human-editable level file (schema in assets/schemas/level_schema.json):
+//
+//   {
+//     "version": 1,
+//     "sectors": [{"floor_height": 0, "ceiling_height": 3,
+//                  "vertices": [[-5, -5], [5, -5], [5, 5], [-5, 5]],
+//                  "walls": [{"vertex_a": 0, "vertex_b": 1, "portal_id": 0}, ...]}],
+//     "portals": [{"target_sector": 1, "floor_height": 0, "ceiling_height": 3}],
+//     "spawns": [{"position": [0, 1.7, 0], "entity_type": 0, "rotation": 0}]
+//   }
+//
+// Loading never builds a DOM. A quick structural scan finds each element of
+// the top-level arrays; the elements are then parsed with nlohmann's SAX
+// interface straight into sector descriptions, portals and spawns, in
+// parallel batches on the shared thread pool. Unknown keys are ignored.
+class JsonLevel {
+public:
+    // Bump when the format changes incompatibly
+    static constexpr uint32_t VERSION = 1;
+
+    // Map a level file and replace level with its contents. On failure
+    // level is left untouched and false is returned, with a reason in
+    // error if given. The BSP is not built.
+    static bool load(const std::string& path, Level& level,
+                     std::string* error = nullptr, JsonLevelStats* stats = nullptr);
+
+    // load() from text already in memory
+    static bool parse(const char* text, size_t size, Level& level,
+                      std::string* error = nullptr, JsonLevelStats* stats = nullptr);
+
+    // Write a level's sectors, portals and spawns in this format
+    static bool write(const Level& level, const std::string& path,
+                      std::string* error = nullptr);
+
+private:
+    JsonLevel() = delete;  // Static class, no instances
+};
+
+} // namespace game
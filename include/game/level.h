@@ -4,14 +4,20 @@
 #include <vector>
 #include <cstdint>
 #include <memory>
+#include <utility>
 
 namespace game {
 
 // Forward declarations
 struct Sector;
+struct SectorDesc;
 struct Wall;
 struct Portal;
 class BSPTree;
+class PotentiallyVisibleSet;
+class SpatialGrid;
+struct BSPRebuildJob;
+struct PVSRebuildJob;
 
 // A 2D vertex in the level
 struct Vertex {
@@ -48,8 +54,8 @@ struct Portal {
         , ceiling_height(0.0f) {}
 };
 
-// A convex sector (room/area) in the level
-struct Sector {
+// Shape and properties of a sector as authored, handed to Level::add_sector()
+struct SectorDesc {
     std::vector<Vertex> vertices;
     std::vector<Wall> walls;
 
@@ -61,7 +67,7 @@ struct Sector {
     // Lighting (0.0 = dark, 1.0 = full brightness)
     float light_level;
 
-    Sector()
+    SectorDesc()
         : floor_height(0.0f)
         , ceiling_height(3.0f)
         , floor_texture(0)
@@ -69,6 +75,70 @@ struct Sector {
         , light_level(1.0f) {}
 };
 
+// A convex sector (room/area) in the level. Its outline and walls are
+// ranges of the level's LevelGeometry.
+struct Sector {
+    uint32_t first_vertex;  // Into LevelGeometry::vertex_indices
+    uint32_t vertex_count;
+    uint32_t first_wall;    // Into the LevelGeometry wall arrays
+    uint32_t wall_count;
+
+    float floor_height;
+    float ceiling_height;
+    uint32_t floor_texture;
+    uint32_t ceiling_texture;
+
+    // Lighting (0.0 = dark, 1.0 = full brightness)
+    float light_level;
+
+    Sector()
+        : first_vertex(0)
+        , vertex_count(0)
+        , first_wall(0)
+        , wall_count(0)
+        , floor_height(0.0f)
+        , ceiling_height(3.0f)
+        , floor_texture(0)
+        , ceiling_texture(0)
+        , light_level(1.0f) {}
+};
+
+// Geometry of all sectors, structure-of-arrays. Corners shared by
+// neighbouring sectors are stored once in the vertex pool; a sector's
+// outline is a run of vertex_indices into it. Wall vertex_a / vertex_b
+// index the sector's outline, as in SectorDesc.
+struct LevelGeometry {
+    // Welded vertex pool
+    std::vector<float> vertex_x;
+    std::vector<float> vertex_z;
+
+    // Sector outlines, in order, as pool indices
+    std::vector<uint32_t> vertex_indices;
+
+    // Walls of all sectors
+    std::vector<uint32_t> wall_vertex_a;
+    std::vector<uint32_t> wall_vertex_b;
+    std::vector<uint32_t> wall_texture;
+    std::vector<int32_t> wall_portal;
+
+    // Outline vertex i of a sector
+    Vertex get_vertex(const Sector& sector, uint32_t i) const {
+        uint32_t index = vertex_indices[sector.first_vertex + i];
+        return Vertex(vertex_x[index], vertex_z[index]);
+    }
+
+    // Wall i of a sector
+    Wall get_wall(const Sector& sector, uint32_t i) const {
+        uint32_t index = sector.first_wall + i;
+        Wall wall;
+        wall.vertex_a = wall_vertex_a[index];
+        wall.vertex_b = wall_vertex_b[index];
+        wall.texture_id = wall_texture[index];
+        wall.portal_id = wall_portal[index];
+        return wall;
+    }
+};
+
 // Entity spawn point
 struct EntitySpawn {
     Vector3 position;
@@ -91,38 +161,178 @@ public:
     Level(const Level&) = delete;
     Level& operator=(const Level&) = delete;
 
-    // Allow move
-    Level(Level&&) = default;
-    Level& operator=(Level&&) = default;
+    // Allow move (defined in level.cpp where the owned types are complete)
+    Level(Level&&);
+    Level& operator=(Level&&);
 
-    // Level building (for now, manual - editor will come later)
-    uint32_t add_sector(const Sector& sector);
+    // Level building (for now, manual - editor will come later). The
+    // sector's geometry is appended to the level's pools, welding corners
+    // that exactly match ones already added.
+    uint32_t add_sector(const SectorDesc& sector);
     uint32_t add_portal(const Portal& portal);
+
+    // Replace all sectors with ones already laid out over geometry (e.g.
+    // by a loader), taking both without copying
+    void set_sectors(std::vector<Sector>&& sectors, LevelGeometry&& geometry);
     void add_entity_spawn(const EntitySpawn& spawn);
 
-    // Build BSP tree for the level (call after adding all sectors)
+    // Build BSP tree and spatial grid for the level (call after adding all
+    // sectors)
     void build_bsp();
 
+    // Build just the spatial grid (build_bsp and set_precomputed do this)
+    void build_spatial_grid();
+
+    // Precompute leaf-to-sector visibility through portals (call after build_bsp)
+    void build_pvs();
+
+    // Install a BSP tree (and optionally a PVS) built earlier for exactly
+    // these sectors, e.g. by a cooked level loader
+    void set_precomputed(std::unique_ptr<BSPTree> bsp_tree,
+                         std::unique_ptr<PotentiallyVisibleSet> pvs);
+
+    // Replace a sector (same index, new shape or properties). The edit and
+    // a BSP tree rebuilt around it on a background thread take effect
+    // together at a later apply_bsp_rebuild(); until then the level reads
+    // as before. Edits made while a rebuild runs go into the next one. The
+    // rebuild gets a copy of just the edited sectors and their neighbours
+    // in the tree, not the whole level.
+    void update_sector(uint32_t index, const SectorDesc& sector);
+
+    // Swap in a finished background rebuild. Call at a tick boundary on the
+    // thread that reads the level; never blocks. Returns true if the
+    // sectors and tree changed.
+    //
+    // Leaves move in a rebuild, so the PVS is dropped with the old tree.
+    // If the level had one, a new one is built in the background once the
+    // edits settle and swapped in by a later call; meanwhile get_pvs() is
+    // nullptr and visibility falls back to frustum culling alone.
+    bool apply_bsp_rebuild();
+
+    // Wait for queued edits and the PVS after them to be rebuilt and
+    // applied (tools and tests)
+    void finish_bsp_rebuild();
+
+    // Edits are queued or being rebuilt
+    bool has_pending_edits() const;
+
+    // The PVS was dropped by an edit and is still being rebuilt
+    bool has_pending_pvs() const;
+
+    // Drop the outline and wall ranges left behind by replaced sectors and
+    // the pool vertices only they used. Edits do this by themselves once
+    // the garbage outgrows the live geometry; it bumps the revision (with
+    // no sectors changed) and rebuilds the spatial grid, as wall indices
+    // move.
+    void compact_geometry();
+
+    // Reserve storage ahead of adding many sectors, portals or walls
+    void reserve(size_t sector_count, size_t portal_count, size_t wall_count = 0);
+
     // Getters
     const std::vector<Sector>& get_sectors() const { return m_sectors; }
     const std::vector<Portal>& get_portals() const { return m_portals; }
     const std::vector<EntitySpawn>& get_spawns() const { return m_entity_spawns; }
     const Sector& get_sector(uint32_t index) const { return m_sectors[index]; }
+    const LevelGeometry& get_geometry() const { return m_geometry; }
     const BSPTree* get_bsp_tree() const { return m_bsp_tree.get(); }
+    const PotentiallyVisibleSet* get_pvs() const { return m_pvs.get(); }
+
+    // Sector and wall lookups by area; nullptr until built. Sector edits and
+    // additions are reflected as they take effect.
+    const SpatialGrid* get_spatial_grid() const { return m_spatial_grid.get(); }
+
+    // Changes whenever the sectors, geometry or BSP tree do. Unique across
+    // levels, so geometry derived from a level can be cached against it.
+    uint64_t get_revision() const { return m_revision; }
+
+    // Sectors whose shape, properties or BSP sub-sectors changed between
+    // an earlier revision and now, ascending, so caches can be patched
+    // rather than rebuilt. Only sector edits are tracked: returns false if
+    // the revision is from before anything else changed the level (sectors
+    // added or loaded, a new tree) or is too old.
+    bool get_sectors_changed_since(uint64_t revision, std::vector<uint32_t>& sectors) const;
 
-    // Find which sector contains a point
+    // Whether a sector's outline contains the point
+    bool sector_contains_point(uint32_t index, float x, float z) const;
+
+    // Find which sector contains a point (the lowest index if several do),
+    // or -1. Descends the BSP tree when one is built, else uses the spatial
+    // grid if there is one.
     int32_t find_sector_at_point(float x, float z) const;
 
+    // find_sector_at_point() for count points given as separate x and z
+    // arrays; large batches are spread over the thread pool
+    void find_sectors_at_points(const float* x, const float* z, size_t count,
+                                int32_t* sectors) const;
+
     // Create a simple test level
     static Level create_test_level();
 
 private:
     std::vector<Sector> m_sectors;
+    LevelGeometry m_geometry;
     std::vector<Portal> m_portals;
     std::vector<EntitySpawn> m_entity_spawns;
-    std::unique_ptr<BSPTree> m_bsp_tree;
+    std::shared_ptr<BSPTree> m_bsp_tree;   // Shared with background rebuilds
+    std::unique_ptr<PotentiallyVisibleSet> m_pvs;
+    std::unique_ptr<SpatialGrid> m_spatial_grid;
+    size_t m_bsp_sector_count;             // Sectors the tree was built with
+    uint64_t m_revision;
+
+    // Sector edits not yet handed to a rebuild, and the rebuild in flight
+    std::vector<std::pair<uint32_t, SectorDesc>> m_pending_edits;
+    std::shared_ptr<BSPRebuildJob> m_rebuild_job;
+
+    // PVS to rebuild after edits (the level had one), and the build in flight
+    bool m_pvs_wanted;
+    std::shared_ptr<PVSRebuildJob> m_pvs_job;
+
+    // Outline and wall entries no sector uses any more
+    size_t m_dead_geometry;
+
+    // Edits since revision m_change_base_revision: each took the level to
+    // its revision and changed m_changed_sectors from its first_sector up
+    // to the next edit's
+    struct ChangeEntry {
+        uint64_t revision;
+        uint32_t first_sector;
+    };
+    uint64_t m_change_base_revision;
+    std::vector<ChangeEntry> m_changes;
+    std::vector<uint32_t> m_changed_sectors;
+
+    // Open-addressed hash of pool vertices for welding in add_sector().
+    // Dropped once the BSP is built.
+    struct WeldSlot {
+        uint64_t key;       // Coordinate bits
+        uint32_t index;     // Pool index + 1, 0 if empty
+    };
+    std::vector<WeldSlot> m_weld_table;
+    size_t m_weld_count;
+
+    uint32_t weld_vertex(const Vertex& vertex);
+
+    // Mark the level changed (new revision). The first form forgets the
+    // edit history; the second records which sectors an edit changed.
+    void bump_revision();
+    void bump_revision(const std::vector<uint32_t>& changed_sectors);
+
+    // Snapshot the sectors with the pending edits and rebuild on the pool
+    void start_bsp_rebuild();
+
+    // Build a PVS for the current tree on the pool, if one is wanted and
+    // no edits are waiting
+    void start_pvs_rebuild();
+    bool apply_pvs_rebuild();
+
+    // Give a sector its new shape at the end of the pools
+    void replace_sector(uint32_t index, const SectorDesc& sector);
 
     bool point_in_sector(const Sector& sector, float x, float z) const;
+
+    // Linear scan over sectors [first, end)
+    int32_t find_sector_linear(float x, float z, size_t first) const;
 };
 
 } // namespace game
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "game/level.h"
+#include <cstdint>
+
+namespace platform {
+class ThreadPool;
+}
+
+namespace game {
+
+// How the generator joins the rooms of its grid
+enum class LevelLayout {
+    GRID,       // Each pair of neighbouring rooms gets a doorway with door_chance
+    MAZE,       // Perfect maze: exactly one path between any two rooms
+    ARENA,      // Every room opens into all its neighbours, with pillars
+};
+
+struct LevelGeneratorConfig {
+    LevelLayout layout;
+    uint32_t width;             // Rooms along x
+    uint32_t height;            // Rooms along z
+    uint32_t seed;
+    float cell_size;            // Room spacing
+    float origin_x;             // World position of the first room's corner
+    float origin_z;
+
+    float door_chance;          // GRID: chance of a doorway between neighbours
+    float pillar_chance;        // ARENA: chance a room is left out (a pillar)
+
+    // Floors are floor_step apart at floor_levels different heights (1 =
+    // all flat); rooms are min to max_room_height from floor to ceiling.
+    // Neighbours whose floor-to-ceiling spans don't overlap get no doorway.
+    uint32_t floor_levels;
+    float floor_step;
+    float min_room_height;
+    float max_room_height;
+
+    // Room corners move up to this fraction of cell_size, so rooms become
+    // irregular quads. Clamped to 0.25, which keeps them convex.
+    float corner_jitter;
+
+    // Chance of an entity spawn in each room (besides the player's in the
+    // first room), with a type from 1 to entity_types
+    float spawn_chance;
+    uint32_t entity_types;
+
+    // Walls, floors and ceilings get texture ids below texture_count
+    uint32_t texture_count;
+
+    // Pool for parallel work; nullptr uses the shared pool
+    platform::ThreadPool* pool;
+
+    LevelGeneratorConfig()
+        : layout(LevelLayout::GRID)
+        , width(32)
+        , height(32)
+        , seed(1)
+        , cell_size(4.0f)
+        , origin_x(0.0f)
+        , origin_z(0.0f)
+        , door_chance(0.5f)
+        , pillar_chance(0.1f)
+        , floor_levels(3)
+        , floor_step(0.25f)
+        , min_room_height(3.0f)
+        , max_room_height(4.0f)
+        , corner_jitter(0.0f)
+        , spawn_chance(0.05f)
+        , entity_types(1)
+        , texture_count(1)
+        , pool(nullptr) {}
+};
+
+// Seeded stress maps: a width x height grid of convex rooms, one sector
+// each, joined by two-way portals. Every random choice is a hash of the
+// seed and the room or corner it is for, so rooms are laid out in parallel
+// and a seed gives the same level on any number of threads. Sectors come
+// out in grid order (rooms left out are skipped); corners shared by
+// neighbouring rooms are one pool vertex. The result is ready for
+// build_bsp().
+class LevelGenerator {
+public:
+    static Level generate(const LevelGeneratorConfig& config);
+
+private:
+    LevelGenerator() = delete;  // Static class, no instances
+};
+
+} // namespace game
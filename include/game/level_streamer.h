@@ -0,0 +1,288 @@
+#pragma once
+
+#include "game/level.h"
+#include "game/level_generator.h"
+#include "core/span.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace game {
+
+// Sides of a chunk, as bits
+constexpr uint32_t CHUNK_EDGE_MIN_X = 1;
+constexpr uint32_t CHUNK_EDGE_MAX_X = 2;
+constexpr uint32_t CHUNK_EDGE_MIN_Z = 4;
+constexpr uint32_t CHUNK_EDGE_MAX_Z = 8;
+
+// Where streamed chunks come from. The world is cut into square chunks
+// get_chunk_size() wide, chunk (x, z) covering [x, x + 1) * size along
+// each axis. Chunks are whole levels of their own: portals don't cross
+// chunk edges, so each chunk is walled in. The source says which sides
+// are seams instead (get_seams()).
+class ChunkSource {
+public:
+    virtual ~ChunkSource() = default;
+
+    virtual float get_chunk_size() const = 0;
+
+    // Fill level with chunk (x, z), BSP not yet built. Called on the
+    // streamer's loader thread. Returns false if there is no such chunk.
+    virtual bool load_chunk(int32_t x, int32_t z, Level& level, std::string* error) = 0;
+
+    // CHUNK_EDGE_* sides of chunk (x, z) that are seams: solid walls lying
+    // on the chunk border there are passed through into the neighbouring
+    // chunk, and not drawn. Walls anywhere else stay walls. Called on the
+    // loader thread after load_chunk(). None by default.
+    virtual uint32_t get_seams(int32_t, int32_t) const { return 0; }
+};
+
+// Chunks generated on demand: each is a LevelGenerator grid of
+// rooms_per_chunk x rooms_per_chunk rooms, seeded from the base config's
+// seed and the chunk's coordinates, over a world of world_chunks x
+// world_chunks chunks from the origin (the config's origin is ignored).
+class GeneratedChunkSource : public ChunkSource {
+public:
+    GeneratedChunkSource(const LevelGeneratorConfig& config, uint32_t rooms_per_chunk,
+                         uint32_t world_chunks);
+
+    float get_chunk_size() const override;
+    bool load_chunk(int32_t x, int32_t z, Level& level, std::string* error) override;
+
+    // Every side facing another chunk of the world
+    uint32_t get_seams(int32_t x, int32_t z) const override;
+
+private:
+    LevelGeneratorConfig m_config;
+    uint32_t m_rooms_per_chunk;
+    uint32_t m_world_chunks;
+};
+
+// Chunks from files named chunk_<x>_<z>.ywlevel (cooked) or, failing that,
+// chunk_<x>_<z>.json in a directory. Only the CHUNK_EDGE_* sides in seams
+// are seams, the same for every chunk; by default there are none, so
+// walls authored on a chunk border stay walls.
+class FileChunkSource : public ChunkSource {
+public:
+    FileChunkSource(const std::string& directory, float chunk_size, uint32_t seams = 0);
+
+    float get_chunk_size() const override { return m_chunk_size; }
+    bool load_chunk(int32_t x, int32_t z, Level& level, std::string* error) override;
+    uint32_t get_seams(int32_t, int32_t) const override { return m_seams; }
+
+private:
+    std::string m_directory;
+    float m_chunk_size;
+    uint32_t m_seams;
+};
+
+// A resident chunk, where it lies, and which of its sides are seams onto
+// another resident chunk
+struct ChunkLevel {
+    const Level* level;
+    float min_x;
+    float min_z;
+    float max_x;
+    float max_z;
+    uint32_t seams;     // CHUNK_EDGE_* bits
+
+    ChunkLevel()
+        : level(nullptr)
+        , min_x(0.0f)
+        , min_z(0.0f)
+        , max_x(0.0f)
+        , max_z(0.0f)
+        , seams(0) {}
+};
+
+// The side among edges of the box that the wall from a to b lies on
+// (both ends on the border line), or 0
+uint32_t find_chunk_edge(float min_x, float min_z, float max_x, float max_z, uint32_t edges,
+                         const Vertex& a, const Vertex& b);
+
+// Unit normal pointing out of a chunk through one side
+void get_chunk_edge_normal(uint32_t edge, float& normal_x, float& normal_z);
+
+// If the wall from a to b of chunks[owner] lies on one of its seams, the
+// sector of another of chunks just across it; nullptr for any other wall,
+// or with no floor across the seam
+const Sector* find_sector_across(core::Span<const ChunkLevel> chunks, size_t owner,
+                                 const Vertex& a, const Vertex& b);
+
+struct LevelStreamerConfig {
+    // Chunks within load_distance of the camera, or of where it will be
+    // prefetch_seconds from now at its current velocity, are loaded. They
+    // are evicted once further than evict_distance from both.
+    float load_distance;
+    float evict_distance;
+    float prefetch_seconds;
+
+    // Resident chunks are evicted, furthest first, to stay under this
+    size_t memory_budget;
+
+    // Chunk requests queued ahead of the loader thread, nearest first
+    uint32_t max_queued_loads;
+
+    // update() calls taking longer than this count as hitches
+    double hitch_ms;
+
+    LevelStreamerConfig()
+        : load_distance(64.0f)
+        , evict_distance(96.0f)
+        , prefetch_seconds(1.0f)
+        , memory_budget(256u * 1024u * 1024u)
+        , max_queued_loads(8)
+        , hitch_ms(1.0) {}
+};
+
+struct StreamingStats {
+    uint32_t resident_chunks;
+    uint32_t queued_loads;
+    size_t resident_bytes;
+    size_t peak_bytes;          // Includes chunks just loaded and evicted in the same update()
+    uint64_t loads;
+    uint64_t evictions;
+    uint64_t budget_evictions;  // Evicted while still wanted, to fit the budget
+    uint64_t misses;            // update() calls with the camera's chunk not resident
+    uint64_t updates;
+    uint64_t hitches;           // update() calls over hitch_ms
+    double last_update_ms;
+    double max_update_ms;
+    double mean_load_ms;        // Request to resident
+    double max_load_ms;
+
+    StreamingStats()
+        : resident_chunks(0)
+        , queued_loads(0)
+        , resident_bytes(0)
+        , peak_bytes(0)
+        , loads(0)
+        , evictions(0)
+        , budget_evictions(0)
+        , misses(0)
+        , updates(0)
+        , hitches(0)
+        , last_update_ms(0.0)
+        , max_update_ms(0.0)
+        , mean_load_ms(0.0)
+        , max_load_ms(0.0) {}
+};
+
+// Keeps the chunks around the camera resident. Chunks are read and their
+// BSP and spatial grid built on a loader thread; update() only hands it requests, picks up
+// finished chunks and evicts, and never waits on the loader (a busy lock
+// is retried next frame). Evicted levels are freed on the loader thread
+// too.
+class LevelStreamer {
+public:
+    explicit LevelStreamer(std::unique_ptr<ChunkSource> source,
+                           const LevelStreamerConfig& config = LevelStreamerConfig());
+    ~LevelStreamer();
+
+    // Disable copy and move (the loader thread holds a pointer)
+    LevelStreamer(const LevelStreamer&) = delete;
+    LevelStreamer& operator=(const LevelStreamer&) = delete;
+
+    // Once per frame on the main thread
+    void update(const Vector3& camera_position, float delta_time);
+
+    // Resident chunk (x, z), or nullptr
+    const Level* get_chunk(int32_t x, int32_t z) const;
+
+    // Resident chunk under a world position, or nullptr
+    const Level* get_chunk_at(float x, float z) const;
+
+    // Seams of resident chunk (x, z) onto a resident neighbour: its
+    // source's get_seams() less the sides whose neighbour isn't resident
+    uint32_t get_open_seams(int32_t x, int32_t z) const;
+
+    // Add the resident chunks overlapping a box in XZ to out
+    void get_chunks_in_box(float min_x, float min_z, float max_x, float max_z,
+                           std::vector<ChunkLevel>& out) const;
+
+    // Call visit(x, z, level) for each resident chunk
+    template <typename Visitor>
+    void for_each_chunk(Visitor&& visit) const {
+        for (const auto& entry : m_chunks) {
+            if (entry.second.level) {
+                visit(entry.second.x, entry.second.z, *entry.second.level);
+            }
+        }
+    }
+
+    // Block until nothing is queued or loading, then pick up the results
+    // (tools and tests)
+    void finish_loads();
+
+    const StreamingStats& get_stats() const { return m_stats; }
+    const LevelStreamerConfig& get_config() const { return m_config; }
+    float get_chunk_size() const { return m_chunk_size; }
+
+private:
+    struct Chunk {
+        int32_t x;
+        int32_t z;
+        std::unique_ptr<Level> level;   // nullptr if the source has no such chunk
+        size_t bytes;
+        uint32_t seams;                 // From the source
+    };
+
+    struct LoadRequest {
+        int32_t x;
+        int32_t z;
+        double requested_ms;
+    };
+
+    // Shared with the loader thread, under m_mutex
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_idle;
+    std::vector<LoadRequest> m_queue;           // Nearest last
+    std::vector<Chunk> m_loaded;
+    std::vector<double> m_load_times;
+    std::vector<std::unique_ptr<Level>> m_retired;
+    bool m_loading;
+    uint64_t m_loading_key;
+    bool m_stopping;
+
+    // Main thread only
+    std::unique_ptr<ChunkSource> m_source;
+    LevelStreamerConfig m_config;
+    float m_chunk_size;
+    std::unordered_map<uint64_t, Chunk> m_chunks;
+    std::unordered_map<uint64_t, double> m_request_times;  // Queued or loading
+    std::vector<std::unique_ptr<Level>> m_to_retire;
+    std::chrono::steady_clock::time_point m_start_time;
+    Vector3 m_last_position;
+    Vector3 m_velocity;
+    bool m_has_position;
+    StreamingStats m_stats;
+    double m_load_time_total;
+
+    std::thread m_loader;
+
+    void loader_main();
+
+    double now_ms() const;
+
+    // Make finished chunks resident
+    void add_loaded(std::vector<Chunk>& loaded, const std::vector<double>& load_times);
+
+    // Evict chunks out of range of the segment from..to, then the furthest
+    // from `from` until under budget. Returns how far from `from` the
+    // furthest chunk left is.
+    float evict(const Vector3& from, const Vector3& to);
+
+    // Replace the loader's queue with the nearest chunks in range of the
+    // segment from..to that aren't resident or loading (under m_mutex)
+    void queue_loads(const Vector3& from, const Vector3& to, float furthest);
+};
+
+} // namespace game
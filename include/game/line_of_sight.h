@@ -0,0 +1,78 @@
+#pragma once
+
+#include "game/level.h"
+#include <vector>
+#include <cstdint>
+
+namespace game {
+
+// Batched line-of-sight tests between pairs of points (bot AI and the like).
+// Blocking walls are copied into a structure-of-arrays table grouped by BSP
+// leaf, and rays are tested in packets of 4 (SSE) or 8 (AVX) lanes: pairs
+// are packed by location, the packet descends the tree together, each
+// subtree only with the lanes whose bounds overlap it, and every wall in a
+// reached leaf is tested against all live lanes at once.
+//
+// Walls stand from -inf to +inf. A portal wall blocks only where the ray
+// crosses it above or below the portal opening, like BSPTree::cast_ray.
+class LineOfSight {
+public:
+    LineOfSight();
+    ~LineOfSight() = default;
+
+    // Gather the level's walls. Uses the BSP tree's segs and leaves when a
+    // tree is built, else one flat list of all walls. Call again after the
+    // level's tree or sectors change.
+    void build(const Level& level);
+
+    // Single segment test, scalar
+    bool is_visible(const Vector3& from, const Vector3& to) const;
+
+    // Test from[i] -> to[i] for count pairs. Bit i of the mask (word i / 64,
+    // bit i % 64) is set if nothing blocks pair i; visible is resized to fit.
+    void test(const Vector3* from, const Vector3* to, size_t count,
+              std::vector<uint64_t>& visible) const;
+
+    // Same result as test(), one ray at a time without SIMD (baseline)
+    void test_scalar(const Vector3* from, const Vector3* to, size_t count,
+                     std::vector<uint64_t>& visible) const;
+
+    // Rays per packet in test(): 8 with AVX, 4 with SSE, 1 without either
+    static int get_packet_width();
+
+    size_t get_wall_count() const { return m_wall_x.size(); }
+
+private:
+    // Tree node with its box in XZ and, for a leaf, its run of walls
+    struct Node {
+        float min_x;
+        float min_z;
+        float max_x;
+        float max_z;
+        uint32_t front;         // BSP_NULL_NODE if absent
+        uint32_t back;
+        uint32_t first_wall;
+        uint32_t wall_end;
+    };
+
+    std::vector<Node> m_nodes;
+
+    // Wall table: start point, start-to-end vector, and the height range a
+    // ray may pass through (empty for solid walls)
+    std::vector<float> m_wall_x;
+    std::vector<float> m_wall_z;
+    std::vector<float> m_wall_dx;
+    std::vector<float> m_wall_dz;
+    std::vector<float> m_open_floor;
+    std::vector<float> m_open_ceiling;
+
+    void add_wall(const Level& level, const Vertex& start, const Vertex& end, int32_t portal_id);
+
+    // Test pairs[0..count) (count up to Lanes::WIDTH); returns a bit per
+    // visible pair, in the order given
+    template <typename Lanes>
+    uint32_t test_packet(const Vector3* from, const Vector3* to,
+                         const uint32_t* pairs, int count) const;
+};
+
+} // namespace game
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "game/level.h"
+#include <vector>
+#include <cstdint>
+
+namespace game {
+
+// Counters from the last portal walk
+struct PortalVisibilityStats {
+    uint32_t windows_processed;     // Sector entries taken off the queue
+    uint32_t portals_tested;
+    uint32_t portals_passed;        // Portals whose opening narrowed to a non-empty window
+    uint32_t sectors_visible;
+
+    PortalVisibilityStats()
+        : windows_processed(0)
+        , portals_tested(0)
+        , portals_passed(0)
+        , sectors_visible(0) {}
+};
+
+// Runtime sector visibility through portals. Starts in the camera's sector
+// and walks out through portal walls, narrowing a horizontal screen-space
+// clip window at each opening, so only sectors actually seen through a
+// chain of openings are reported. Keeps its buffers between calls.
+class PortalVisibility {
+public:
+    PortalVisibility();
+    ~PortalVisibility() = default;
+
+    // Walk the portals from a camera (fov_y in degrees, as for Camera3D).
+    // Returns false if the camera is outside every sector or looks so
+    // steeply up or down that the view can't be bounded horizontally;
+    // callers should fall back to another visibility path then.
+    bool compute(const Level& level, const Vector3& position, const Vector3& forward,
+                 float fov_y, float aspect);
+
+    // Sectors from the last compute(), each once, front to back: a sector
+    // always comes after the sector whose portal it was first seen through
+    const std::vector<uint32_t>& get_visible_sectors() const { return m_visible_sectors; }
+
+    const PortalVisibilityStats& get_stats() const { return m_stats; }
+
+    // Longest chain of portals followed from the camera sector
+    static constexpr uint32_t MAX_PORTAL_DEPTH = 256;
+
+private:
+    // A sector to be drawn through a screen-space window. left/right are
+    // normalized screen x, -1 to 1 across the view.
+    struct ClipWindow {
+        uint32_t sector;
+        uint32_t depth;
+        float left;
+        float right;
+    };
+
+    // Breadth-first queue; entries before m_queue_head are done
+    std::vector<ClipWindow> m_queue;
+    size_t m_queue_head;
+
+    std::vector<uint32_t> m_visible_sectors;
+
+    // Sector i has been reported this walk if m_marks[i] == m_generation
+    std::vector<uint32_t> m_marks;
+    uint32_t m_generation;
+
+    // Widest window each sector has been queued with this walk; a window
+    // inside it would see nothing new (valid when m_window_stamps[i] matches)
+    std::vector<float> m_window_left;
+    std::vector<float> m_window_right;
+    std::vector<uint32_t> m_window_stamps;
+
+    // Queue a sector unless an earlier entry already covers the window
+    void enqueue(uint32_t sector, uint32_t depth, float left, float right);
+
+    PortalVisibilityStats m_stats;
+};
+
+} // namespace game
@@ -0,0 +1,156 @@
+#pragma once
+
+#include "game/level.h"
+#include "core/flat_array.h"
+#include <vector>
+#include <cstdint>
+#include <memory>
+
+namespace game {
+
+class BSPTree;
+
+// Cost and size of the last PVS build
+struct PVSBuildStats {
+    uint32_t leaf_count;
+    uint64_t visible_pairs;         // Sum of visible sectors over all leaves
+    size_t compressed_bytes;
+    size_t uncompressed_bytes;
+    double build_time_ms;
+
+    PVSBuildStats()
+        : leaf_count(0)
+        , visible_pairs(0)
+        , compressed_bytes(0)
+        , uncompressed_bytes(0)
+        , build_time_ms(0.0) {}
+};
+
+// Portal wall as seen from the sector that owns it
+struct PVSPortal {
+    Vertex a;
+    Vertex b;
+    uint32_t target_sector;
+};
+
+// Everything a PVS build reads from the level: its portal walls, grouped
+// by owning sector. Gathering them is one pass over the walls, after which
+// the build can run on another thread while the level changes.
+struct PVSPortals {
+    uint32_t sector_count;
+    std::vector<PVSPortal> portals;
+    std::vector<uint32_t> sector_first_portal;  // Per sector, plus one past the end
+
+    PVSPortals() : sector_count(0) {}
+};
+
+// Precomputed potentially-visible set: for every BSP leaf, the sectors
+// that can be seen from somewhere inside it (Quake-style vis). Rows are
+// sector bitsets, run-length compressed: non-zero bytes are stored as is,
+// a zero byte is followed by the number of zero bytes in the run.
+class PotentiallyVisibleSet {
+public:
+    PotentiallyVisibleSet();
+    ~PotentiallyVisibleSet() = default;
+
+    // Flow visibility through the level's portals and compress one row per
+    // BSP leaf. Source sectors are processed in parallel.
+    void build(const Level& level, const BSPTree& bsp_tree);
+
+    // The same in two steps: gather on the thread that owns the level,
+    // build anywhere
+    static void gather_portals(const Level& level, PVSPortals& out);
+    void build(const PVSPortals& portals, const BSPTree& bsp_tree);
+
+    // Use already built rows in place (e.g. from a memory-mapped cooked
+    // level); backing owns that memory and is kept alive with the set
+    void attach(std::shared_ptr<const void> backing,
+                const uint8_t* rows, size_t row_bytes,
+                const uint32_t* row_offsets, size_t row_offset_count,
+                uint32_t sector_count, const PVSBuildStats& stats);
+
+    // Call visit(sector_index) for each sector visible from a leaf node.
+    // Walks the compressed row directly; O(visible) and allocation-free.
+    // Never yields an index at or past the sector count.
+    template <typename Visitor>
+    void for_each_visible(uint32_t leaf_node, Visitor&& visit) const;
+
+    // Collect visible sectors from a leaf node, in ascending order. Does not
+    // allocate once the output has grown to the level's sector count.
+    void get_visible_sectors(uint32_t leaf_node, std::vector<uint32_t>& visible_sectors) const;
+
+    // Every row decodes to sectors below the sector count; attached rows
+    // are checked with this before use
+    bool rows_in_range() const;
+
+    // Getters
+    bool is_built() const { return !m_row_offsets.empty(); }
+    uint32_t get_sector_count() const { return m_sector_count; }
+    const PVSBuildStats& get_build_stats() const { return m_stats; }
+
+    // Packed compressed rows and their offsets (one more than node count)
+    const core::FlatArray<uint8_t>& get_rows() const { return m_rows; }
+    const core::FlatArray<uint32_t>& get_row_offsets() const { return m_row_offsets; }
+
+private:
+    // One row per BSP node (empty for interior nodes); row i is
+    // m_rows[m_row_offsets[i] .. m_row_offsets[i + 1])
+    core::FlatArray<uint8_t> m_rows;
+    core::FlatArray<uint32_t> m_row_offsets;
+    std::shared_ptr<const void> m_backing;
+    uint32_t m_sector_count;
+    PVSBuildStats m_stats;
+
+    static void compress_row(const std::vector<uint8_t>& bits, std::vector<uint8_t>& out);
+
+    // Decode one compressed row, calling visit(sector_index) per set bit
+    // below limit. Returns false if the row has bits at or past limit.
+    template <typename Visitor>
+    static bool for_each_in_row(const uint8_t* data, const uint8_t* end, uint32_t limit,
+                                Visitor&& visit);
+};
+
+template <typename Visitor>
+void PotentiallyVisibleSet::for_each_visible(uint32_t leaf_node, Visitor&& visit) const {
+    if (leaf_node + 1 >= m_row_offsets.size()) {
+        return;
+    }
+
+    for_each_in_row(m_rows.data() + m_row_offsets[leaf_node],
+                    m_rows.data() + m_row_offsets[leaf_node + 1],
+                    m_sector_count, visit);
+}
+
+template <typename Visitor>
+bool PotentiallyVisibleSet::for_each_in_row(const uint8_t* data, const uint8_t* end,
+                                            uint32_t limit, Visitor&& visit) {
+    uint32_t byte_index = 0;
+
+    while (data < end) {
+        uint8_t value = *data++;
+
+        // Zero run: skip the whole run in one step
+        if (value == 0) {
+            byte_index += (data < end) ? *data++ : 1;
+            continue;
+        }
+
+        // Anything from here on is past the end of the sectors
+        if (byte_index >= (limit + 7) / 8) {
+            return false;
+        }
+        for (uint32_t bit = 0; value != 0; ++bit, value >>= 1) {
+            if (value & 1) {
+                uint32_t sector = byte_index * 8 + bit;
+                if (sector >= limit) {
+                    return false;
+                }
+                visit(sector);
+            }
+        }
+        byte_index++;
+    }
+    return true;
+}
+
+} // namespace game
@@ -0,0 +1,256 @@
+#pragma once
+
+#include "game/level.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace game {
+
+// Uniform grid over a level's XZ extent. Each square cell lists the
+// sectors and walls whose bounding boxes touch it, in flat per-cell runs.
+// Queries walk the cells under a box or circle and call a visitor, never
+// allocating; an item spanning several cells is reported once.
+//
+// Sectors changed (or added) after the build are kept on a short list
+// that queries check directly, and their old cell entries are skipped.
+// Once the list gets long the grid is rebuilt.
+class SpatialGrid {
+public:
+    SpatialGrid();
+    ~SpatialGrid() = default;
+
+    // Index every sector of the level. A cell_size of 0 picks one from the
+    // mean sector size.
+    void build(const Level& level, float cell_size = 0.0f);
+
+    // Sector index has a new shape, or was just added
+    void update_sector(const Level& level, uint32_t index);
+
+    bool is_built() const { return !m_sector_offsets.empty(); }
+    float get_cell_size() const { return m_cell_size; }
+    uint32_t get_width() const { return m_width; }
+    uint32_t get_height() const { return m_height; }
+
+    // Heap held by the grid's arrays
+    size_t get_memory_bytes() const;
+
+    // Call visit(sector) for each sector whose bounds overlap the box
+    template <typename Visitor>
+    void for_each_sector_in_box(float min_x, float min_z, float max_x, float max_z,
+                                Visitor&& visit) const;
+
+    // Call visit(sector) for each sector whose bounds come within radius of
+    // the point
+    template <typename Visitor>
+    void for_each_sector_in_radius(float x, float z, float radius, Visitor&& visit) const;
+
+    // Call visit(sector) for each sector containing the point
+    template <typename Visitor>
+    void for_each_sector_at_point(const Level& level, float x, float z, Visitor&& visit) const;
+
+    // Call visit(sector, wall) for each wall whose bounds overlap the box.
+    // wall indexes the LevelGeometry wall arrays.
+    template <typename Visitor>
+    void for_each_wall_in_box(const Level& level, float min_x, float min_z, float max_x,
+                              float max_z, Visitor&& visit) const;
+
+    // Call visit(sector, wall) for each wall within radius of the point
+    template <typename Visitor>
+    void for_each_wall_in_radius(const Level& level, float x, float z, float radius,
+                                 Visitor&& visit) const;
+
+private:
+    float m_origin_x;
+    float m_origin_z;
+    float m_cell_size;
+    float m_inverse_cell_size;
+    uint32_t m_width;
+    uint32_t m_height;
+
+    // Cell c lists sectors m_sector_ids[m_sector_offsets[c] .. [c + 1]) and
+    // walls m_wall_ids[m_wall_offsets[c] .. [c + 1])
+    std::vector<uint32_t> m_sector_offsets;
+    std::vector<uint32_t> m_sector_ids;
+    std::vector<uint32_t> m_wall_offsets;
+    std::vector<uint32_t> m_wall_ids;
+
+    // Per sector: min_x, min_z, max_x, max_z
+    std::vector<float> m_sector_bounds;
+
+    // Owning sector of each wall indexed at build time
+    std::vector<uint32_t> m_wall_sector;
+
+    // Sectors changed since the build, as a list and as flags
+    std::vector<uint32_t> m_changed;
+    std::vector<uint8_t> m_is_changed;
+
+    uint32_t cell_x(float x) const;
+    uint32_t cell_z(float z) const;
+
+    static void wall_bounds(const Level& level, uint32_t sector, uint32_t wall,
+                            float bounds[4]);
+    static float distance_to_wall(const Level& level, uint32_t sector, uint32_t wall,
+                                  float x, float z);
+    void set_sector_bounds(const Level& level, uint32_t index);
+};
+
+inline uint32_t SpatialGrid::cell_x(float x) const {
+    float cell = floorf((x - m_origin_x) * m_inverse_cell_size);
+    return static_cast<uint32_t>(std::clamp(cell, 0.0f, static_cast<float>(m_width - 1)));
+}
+
+inline uint32_t SpatialGrid::cell_z(float z) const {
+    float cell = floorf((z - m_origin_z) * m_inverse_cell_size);
+    return static_cast<uint32_t>(std::clamp(cell, 0.0f, static_cast<float>(m_height - 1)));
+}
+
+inline void SpatialGrid::wall_bounds(const Level& level, uint32_t sector, uint32_t wall,
+                                     float bounds[4]) {
+    const LevelGeometry& geometry = level.get_geometry();
+    const Sector& owner = level.get_sector(sector);
+    Vertex a = geometry.get_vertex(owner, geometry.wall_vertex_a[wall]);
+    Vertex b = geometry.get_vertex(owner, geometry.wall_vertex_b[wall]);
+    bounds[0] = std::min(a.x, b.x);
+    bounds[1] = std::min(a.z, b.z);
+    bounds[2] = std::max(a.x, b.x);
+    bounds[3] = std::max(a.z, b.z);
+}
+
+inline float SpatialGrid::distance_to_wall(const Level& level, uint32_t sector, uint32_t wall,
+                                           float x, float z) {
+    const LevelGeometry& geometry = level.get_geometry();
+    const Sector& owner = level.get_sector(sector);
+    Vertex a = geometry.get_vertex(owner, geometry.wall_vertex_a[wall]);
+    Vertex b = geometry.get_vertex(owner, geometry.wall_vertex_b[wall]);
+    float ex = b.x - a.x;
+    float ez = b.z - a.z;
+    float length_sq = ex * ex + ez * ez;
+    float t = 0.0f;
+    if (length_sq > 0.0f) {
+        t = std::clamp(((x - a.x) * ex + (z - a.z) * ez) / length_sq, 0.0f, 1.0f);
+    }
+    float dx = a.x + ex * t - x;
+    float dz = a.z + ez * t - z;
+    return sqrtf(dx * dx + dz * dz);
+}
+
+template <typename Visitor>
+void SpatialGrid::for_each_sector_in_box(float min_x, float min_z, float max_x, float max_z,
+                                         Visitor&& visit) const {
+    if (!is_built()) {
+        return;
+    }
+
+    uint32_t x0 = cell_x(min_x);
+    uint32_t z0 = cell_z(min_z);
+    uint32_t x1 = cell_x(max_x);
+    uint32_t z1 = cell_z(max_z);
+    for (uint32_t cz = z0; cz <= z1; ++cz) {
+        for (uint32_t cx = x0; cx <= x1; ++cx) {
+            uint32_t cell = cz * m_width + cx;
+            for (uint32_t i = m_sector_offsets[cell]; i < m_sector_offsets[cell + 1]; ++i) {
+                uint32_t sector = m_sector_ids[i];
+                const float* bounds = &m_sector_bounds[static_cast<size_t>(sector) * 4];
+                if (m_is_changed[sector] || bounds[0] > max_x || bounds[2] < min_x ||
+                    bounds[1] > max_z || bounds[3] < min_z) {
+                    continue;
+                }
+                // Report once, from the cell holding the overlap's min corner
+                if (cell_x(std::max(bounds[0], min_x)) == cx &&
+                    cell_z(std::max(bounds[1], min_z)) == cz) {
+                    visit(sector);
+                }
+            }
+        }
+    }
+
+    for (uint32_t sector : m_changed) {
+        const float* bounds = &m_sector_bounds[static_cast<size_t>(sector) * 4];
+        if (bounds[0] <= max_x && bounds[2] >= min_x && bounds[1] <= max_z && bounds[3] >= min_z) {
+            visit(sector);
+        }
+    }
+}
+
+template <typename Visitor>
+void SpatialGrid::for_each_sector_in_radius(float x, float z, float radius,
+                                            Visitor&& visit) const {
+    float radius_sq = radius * radius;
+    for_each_sector_in_box(x - radius, z - radius, x + radius, z + radius, [&](uint32_t sector) {
+        const float* bounds = &m_sector_bounds[static_cast<size_t>(sector) * 4];
+        float dx = x - std::clamp(x, bounds[0], bounds[2]);
+        float dz = z - std::clamp(z, bounds[1], bounds[3]);
+        if (dx * dx + dz * dz <= radius_sq) {
+            visit(sector);
+        }
+    });
+}
+
+template <typename Visitor>
+void SpatialGrid::for_each_sector_at_point(const Level& level, float x, float z,
+                                           Visitor&& visit) const {
+    for_each_sector_in_box(x, z, x, z, [&](uint32_t sector) {
+        if (level.sector_contains_point(sector, x, z)) {
+            visit(sector);
+        }
+    });
+}
+
+template <typename Visitor>
+void SpatialGrid::for_each_wall_in_box(const Level& level, float min_x, float min_z,
+                                       float max_x, float max_z, Visitor&& visit) const {
+    if (!is_built()) {
+        return;
+    }
+
+    float bounds[4];
+    uint32_t x0 = cell_x(min_x);
+    uint32_t z0 = cell_z(min_z);
+    uint32_t x1 = cell_x(max_x);
+    uint32_t z1 = cell_z(max_z);
+    for (uint32_t cz = z0; cz <= z1; ++cz) {
+        for (uint32_t cx = x0; cx <= x1; ++cx) {
+            uint32_t cell = cz * m_width + cx;
+            for (uint32_t i = m_wall_offsets[cell]; i < m_wall_offsets[cell + 1]; ++i) {
+                uint32_t wall = m_wall_ids[i];
+                uint32_t sector = m_wall_sector[wall];
+                if (m_is_changed[sector]) {
+                    continue;
+                }
+                wall_bounds(level, sector, wall, bounds);
+                if (bounds[0] > max_x || bounds[2] < min_x || bounds[1] > max_z || bounds[3] < min_z) {
+                    continue;
+                }
+                if (cell_x(std::max(bounds[0], min_x)) == cx &&
+                    cell_z(std::max(bounds[1], min_z)) == cz) {
+                    visit(sector, wall);
+                }
+            }
+        }
+    }
+
+    for (uint32_t sector : m_changed) {
+        const Sector& changed = level.get_sector(sector);
+        for (uint32_t wall = changed.first_wall; wall < changed.first_wall + changed.wall_count; ++wall) {
+            wall_bounds(level, sector, wall, bounds);
+            if (bounds[0] <= max_x && bounds[2] >= min_x && bounds[1] <= max_z && bounds[3] >= min_z) {
+                visit(sector, wall);
+            }
+        }
+    }
+}
+
+template <typename Visitor>
+void SpatialGrid::for_each_wall_in_radius(const Level& level, float x, float z, float radius,
+                                          Visitor&& visit) const {
+    for_each_wall_in_box(level, x - radius, z - radius, x + radius, z + radius,
+                         [&](uint32_t sector, uint32_t wall) {
+        if (distance_to_wall(level, sector, wall, x, z) <= radius) {
+            visit(sector, wall);
+        }
+    });
+}
+
+} // namespace game
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "game/level.h"
+#include "game/bsp.h"
+#include "game/frustum.h"
+#include "core/span.h"
+#include <vector>
+#include <cstdint>
+
+namespace game {
+
+// Per-view visibility query, kept alive across frames. Walks the BSP tree
+// front to back inside a frustum, drops sub-sectors whose sector the PVS
+// rules out, and lists each visible sector once. Marks are stamped with a
+// per-query generation instead of being cleared, and every buffer is
+// reused, so a steady-state query allocates nothing.
+class VisibilityQuery {
+public:
+    VisibilityQuery();
+    ~VisibilityQuery() = default;
+
+    // Run the query. Returns the visible sectors, each once, in the order
+    // of their nearest fragment; the view stays valid until the next run.
+    // Without use_pvs (a level seen from outside it, where the viewer's
+    // leaf means nothing) everything in the frustum is kept.
+    core::Span<const uint32_t> run(const Level& level, const Frustum& frustum, bool use_pvs = true);
+
+    // Visible sub-sectors from the last run, front to back
+    core::Span<const uint32_t> get_subsectors() const {
+        return core::Span<const uint32_t>(m_subsectors.data(), m_subsectors.size());
+    }
+
+    // Visible sectors from the last run (same as run() returned)
+    core::Span<const uint32_t> get_sectors() const {
+        return core::Span<const uint32_t>(m_sectors.data(), m_sectors.size());
+    }
+
+    // Frustum culling counters from the last run
+    const BSPCullStats& get_cull_stats() const { return m_cull_stats; }
+
+    // Sub-sectors inside the frustum that the PVS rejected in the last run
+    uint32_t get_pvs_culled() const { return m_pvs_culled; }
+
+private:
+    std::vector<uint32_t> m_subsectors;
+    std::vector<uint32_t> m_sectors;
+
+    // Sector i is in the PVS this run if m_pvs_marks[i] == m_generation,
+    // and already listed if m_sector_marks[i] == m_generation
+    std::vector<uint32_t> m_pvs_marks;
+    std::vector<uint32_t> m_sector_marks;
+    uint32_t m_generation;
+
+    BSPCullStats m_cull_stats;
+    uint32_t m_pvs_culled;
+};
+
+} // namespace game
@@ -25,6 +25,7 @@ struct InputState {
 
     // Misc
     bool pause;
+    bool toggle_visibility;     // Switch between renderer visibility paths
 
     InputState()
         : forward(false)
@@ -38,7 +39,8 @@ struct InputState {
         , use(false)
         , mouse_delta{0.0f, 0.0f}
         , mouse_sensitivity(1.0f)
-        , pause(false) {}
+        , pause(false)
+        , toggle_visibility(false) {}
 };
 
 // Platform input provider interface
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace platform {
+
+// Read-only memory mapping of a whole file. Pages are loaded by the OS on
+// first touch, so opening is cheap regardless of file size.
+class MappedFile {
+public:
+    MappedFile();
+    ~MappedFile();
+
+    // Disable copy and move (the mapping is released in the destructor)
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&&) = delete;
+    MappedFile& operator=(MappedFile&&) = delete;
+
+    // Map a file, replacing any current mapping. Returns false if the file
+    // can't be opened or is empty.
+    bool open(const std::string& path);
+    void close();
+
+    // Getters
+    const unsigned char* get_data() const { return m_data; }
+    size_t get_size() const { return m_size; }
+    bool is_open() const { return m_data != nullptr; }
+
+private:
+    const unsigned char* m_data;
+    size_t m_size;
+
+#ifdef _WIN32
+    void* m_file_handle;
+    void* m_mapping_handle;
+#endif
+};
+
+} // namespace platform
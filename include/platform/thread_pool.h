@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace platform {
+
+// Fixed-size work-stealing pool for data-parallel engine work (BSP builds,
+// etc.). Each worker has its own task deque: tasks a worker submits go on
+// its own deque and are taken newest first, idle workers steal the oldest
+// task from someone else's.
+class ThreadPool {
+public:
+    // worker_count of 0 uses hardware concurrency minus the calling thread
+    explicit ThreadPool(size_t worker_count = 0);
+    ~ThreadPool();
+
+    // Disable copy and move (workers hold a pointer to the pool)
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    ThreadPool(ThreadPool&&) = delete;
+    ThreadPool& operator=(ThreadPool&&) = delete;
+
+    // Queue a task for any worker
+    void submit(std::function<void()> task);
+
+    // Run body(begin, end) over [0, count) in chunks of at least grain_size.
+    // The calling thread takes part and the call returns when all chunks are done.
+    void parallel_for(size_t count, size_t grain_size,
+                      const std::function<void(size_t, size_t)>& body);
+
+    // Run first and second, possibly in parallel, and return when both are
+    // done. The caller runs second itself, then first too if nobody has
+    // picked it up, and otherwise runs other queued tasks while it waits,
+    // so calls can nest freely (fork-join recursion) without deadlocking.
+    void fork_join(const std::function<void()>& first, const std::function<void()>& second);
+
+    // Number of worker threads (not counting callers of parallel_for)
+    size_t get_worker_count() const { return m_workers.size(); }
+
+    // Process-wide pool shared by engine subsystems
+    static ThreadPool& get_shared();
+
+private:
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<WorkerQueue>> m_queues;  // One per worker
+    std::vector<std::thread> m_workers;
+
+    // Sleeping workers wait here until m_queued_count goes above zero
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::atomic<size_t> m_queued_count;
+    std::atomic<size_t> m_next_queue;       // Round robin for outside submits
+    bool m_stopping;
+
+    // Run one queued task: the newest from queue `own` (if it is a worker's),
+    // else the oldest from any other queue. Returns false if all are empty.
+    bool run_one(size_t own);
+
+    // Worker index of the calling thread in this pool, or the worker count
+    size_t current_worker() const;
+
+    void worker_loop(size_t index);
+};
+
+} // namespace platform
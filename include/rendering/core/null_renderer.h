@@ -0,0 +1,71 @@
+#pragma once
+
+#include "rendering/core/renderer_interface.h"
+#include "game/portal_visibility.h"
+#include "game/visibility_query.h"
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace rendering {
+
+// What a NullRenderer frame would have drawn
+struct NullRenderStats {
+    uint32_t sectors;           // Distinct sectors with anything visible
+    uint32_t pieces;            // Sub-sectors (or sectors) drawn
+    uint32_t wall_quads;        // Solid wall pieces, one quad each
+    uint32_t floor_triangles;   // Floors and ceilings together
+    uint32_t sprite_quads;
+    uint32_t texture_binds;     // Level surfaces batched by texture, then sprites in order
+
+    NullRenderStats()
+        : sectors(0)
+        , pieces(0)
+        , wall_quads(0)
+        , floor_triangles(0)
+        , sprite_quads(0)
+        , texture_binds(0) {}
+};
+
+// Renderer that draws nothing and never touches the window or OpenGL. It
+// runs the same visibility as BasicRenderer (the BSP walk when the level
+// has a tree, the portal walk when not) and counts the geometry and texture
+// binds the GPU path would have submitted, so the whole frame pipeline can
+// be benchmarked and soak-tested headless.
+class NullRenderer : public IRenderer {
+public:
+    // Frustum aspect comes from the resolution it pretends to render at
+    explicit NullRenderer(int width = 1920, int height = 1080);
+    ~NullRenderer() override = default;
+
+    void render(const game::Level& level, const game::Camera& camera) override;
+    void render_sprites(const std::vector<Sprite>& sprites, const game::Camera& camera) override;
+    void render_world(const game::LevelStreamer& streamer, const game::Camera& camera) override;
+    void begin_frame() override;
+    void end_frame() override;
+
+    // Counters for the last frame, and frames ended so far
+    const NullRenderStats& get_stats() const { return m_stats; }
+    uint64_t get_frame_count() const { return m_frame_count; }
+
+private:
+    float m_aspect;
+    NullRenderStats m_stats;
+    uint64_t m_frame_count;
+
+    game::VisibilityQuery m_visibility_query;
+    game::PortalVisibility m_portal_visibility;
+
+    // Textures of the frame's level surfaces, to count the distinct ones
+    std::vector<uint32_t> m_textures;
+
+    // Sprites' (distance squared, texture), kept between frames
+    std::vector<std::pair<float, uint32_t>> m_sprite_order;
+
+    // Count what is visible of one level; use_pvs when the camera is in it
+    void count_level(const game::Level& level, const game::Camera& camera, bool use_pvs);
+    void count_piece(const game::Level& level, bool by_subsector, uint32_t piece);
+    void count_binds();
+};
+
+} // namespace rendering
@@ -2,29 +2,26 @@
 
 #include "game/level.h"
 #include "game/camera.h"
+#include "game/bsp.h"
+#include "game/portal_visibility.h"
+#include "game/visibility_query.h"
+#include "rendering/core/renderer_interface.h"
 #include "rendering/textures/texture_manager.h"
 #include "rendering/sprites/sprite.h"
 #include "rendering/core/hud.h"
-#include "rendering/scene/sector_renderer.h"
+#include "rendering/scene/level_mesh.h"
 #include "rendering/sprites/weapon_sprite.h"
 #include "raylib.h"
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
 namespace rendering {
 
-// Pure rendering interface - no game logic
-class IRenderer {
-public:
-    virtual ~IRenderer() = default;
-
-    // Render a frame
-    virtual void render(const game::Level& level, const game::Camera& camera) = 0;
-    virtual void render_sprites(const std::vector<Sprite>& sprites, const game::Camera& camera) = 0;
-
-    // Clear screen
-    virtual void begin_frame() = 0;
-    virtual void end_frame() = 0;
+// How BasicRenderer decides which level geometry to draw
+enum class VisibilityMode {
+    BSP,        // Frustum-culled BSP walk, filtered by the PVS when built
+    PORTALS     // Walk out from the camera sector through portal openings
 };
 
 // Basic 3D renderer using Raylib with BSP traversal and textures
@@ -35,6 +32,11 @@ public:
 
     void render(const game::Level& level, const game::Camera& camera) override;
     void render_sprites(const std::vector<Sprite>& sprites, const game::Camera& camera) override;
+
+    // Each resident chunk has a mesh of its own, with the edges it shares
+    // with resident neighbours left open
+    void render_world(const game::LevelStreamer& streamer, const game::Camera& camera) override;
+
     void begin_frame() override;
     void end_frame() override;
 
@@ -42,16 +44,58 @@ public:
     void trigger_weapon_attack();
     void update_weapon(float delta_time);
 
+    // Visibility path; PORTALS falls back to BSP for frames where the
+    // camera is outside the level or looking almost straight up or down
+    void set_visibility_mode(VisibilityMode mode) { m_visibility_mode = mode; }
+    VisibilityMode get_visibility_mode() const { return m_visibility_mode; }
+
+    // Frustum culling counters from the last BSP-rendered frame
+    const game::BSPCullStats& get_cull_stats() const { return m_visibility_query.get_cull_stats(); }
+
+    // Portal walk counters from the last portal-rendered frame
+    const game::PortalVisibilityStats& get_portal_stats() const { return m_portal_visibility.get_stats(); }
+
+    // Level draw calls, texture binds and triangles from the last frame
+    const LevelMeshStats& get_mesh_stats() const { return m_mesh_stats; }
+
 private:
     std::unique_ptr<TextureManager> m_texture_manager;
     std::unique_ptr<HUD> m_hud;
-    std::unique_ptr<SectorRenderer> m_sector_renderer;
+    std::unique_ptr<LevelMesh> m_level_mesh;
+    LevelMeshStats m_mesh_stats;
+
+    // Meshes of streamed chunks by chunk coordinates; those not seen in a
+    // frame belonged to evicted chunks
+    struct ChunkMesh {
+        std::unique_ptr<LevelMesh> mesh;
+        bool resident;
+    };
+    std::unordered_map<uint64_t, ChunkMesh> m_chunk_meshes;
     std::unique_ptr<WeaponSprite> m_weapon_sprite;
 
     RenderTexture2D m_render_target;  // Fixed resolution render target
     int m_render_width;                // Target render width
     int m_render_height;               // Target render height
 
+    VisibilityMode m_visibility_mode;
+    game::VisibilityQuery m_visibility_query;
+    game::PortalVisibility m_portal_visibility;
+
+    // Sprite draw order, kept between frames so sorting doesn't allocate
+    struct SpriteDistance {
+        const Sprite* sprite;
+        float distance_sq;
+    };
+    std::vector<SpriteDistance> m_sorted_sprites;
+
+    // Draw a level into its mesh with the chosen visibility path; use_pvs
+    // when the camera is inside it
+    void render_level(const game::Level& level, const game::Camera& camera, LevelMesh& mesh,
+                      bool use_pvs);
+    void render_bsp(const game::Level& level, const game::Camera& camera, LevelMesh& mesh,
+                    bool use_pvs);
+    bool render_portals(const game::Level& level, const game::Camera& camera, LevelMesh& mesh);
+
     void render_sprite(const Sprite& sprite, const game::Camera& camera);
     void update_render_target();       // Update render target on window resize
     void update_ui_scaling();          // Update UI element positions based on render size
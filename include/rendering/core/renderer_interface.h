@@ -0,0 +1,35 @@
+#pragma once
+
+#include "game/level.h"
+#include "game/camera.h"
+#include "game/level_streamer.h"
+#include "rendering/sprites/sprite.h"
+#include <vector>
+
+namespace rendering {
+
+// Pure rendering interface - no game logic
+class IRenderer {
+public:
+    virtual ~IRenderer() = default;
+
+    // Render a frame
+    virtual void render(const game::Level& level, const game::Camera& camera) = 0;
+    virtual void render_sprites(const std::vector<Sprite>& sprites, const game::Camera& camera) = 0;
+
+    // Render a frame of a streamed world, all its resident chunks.
+    // Renderers that only draw one level at a time draw the chunk under
+    // the camera.
+    virtual void render_world(const game::LevelStreamer& streamer, const game::Camera& camera) {
+        const Vector3& eye = camera.get_position();
+        if (const game::Level* chunk = streamer.get_chunk_at(eye.x, eye.z)) {
+            render(*chunk, camera);
+        }
+    }
+
+    // Clear screen
+    virtual void begin_frame() = 0;
+    virtual void end_frame() = 0;
+};
+
+} // namespace rendering
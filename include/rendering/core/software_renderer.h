@@ -0,0 +1,200 @@
+#pragma once
+
+#include "rendering/core/renderer_interface.h"
+#include "core/span.h"
+#include "game/portal_visibility.h"
+#include "game/visibility_query.h"
+#include "raylib.h"
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace platform {
+class ThreadPool;
+}
+
+namespace rendering {
+
+// Settings for a SoftwareRenderer
+struct SoftwareRendererConfig {
+    int width;                      // Framebuffer size in pixels
+    int height;
+    int strip_width;                // Screen columns per thread pool task
+    platform::ThreadPool* pool;     // Worker pool; nullptr uses the shared pool
+
+    SoftwareRendererConfig()
+        : width(640)
+        , height(360)
+        , strip_width(32)
+        , pool(nullptr) {}
+};
+
+// Counters for the last SoftwareRenderer frame
+struct SoftwareRenderStats {
+    uint32_t pieces;            // Sub-sectors (or sectors) walked
+    uint32_t walls;             // Wall pieces facing the camera and on screen
+    uint32_t wall_columns;      // Wall columns drawn, steps included
+    uint32_t visplanes;         // Floor and ceiling planes, over all strips
+    uint32_t spans;             // Horizontal floor and ceiling spans drawn
+    uint32_t sprites;
+
+    SoftwareRenderStats()
+        : pieces(0)
+        , walls(0)
+        , wall_columns(0)
+        , visplanes(0)
+        , spans(0)
+        , sprites(0) {}
+};
+
+// Renders the level on the CPU into a framebuffer, the way Doom does: walls
+// are drawn a screen column at a time, front to back, each column keeping
+// the rows still open above and below what has been drawn. Floors and
+// ceilings are collected into visplanes (rows per column at one height and
+// texture) while the walls are drawn, then filled as horizontal spans.
+//
+// The screen is cut into strips of columns which the thread pool renders
+// independently; every strip walks the same projected walls but only
+// touches its own columns. Spans and clears are filled with SIMD.
+//
+// Nothing here needs a GPU. Textures are generated from their ids, and
+// end_frame() shows the framebuffer through raylib only if a window is
+// open, so it runs headless for tests and benchmarks. Pixels are RGBA8 in
+// memory order, rows top to bottom.
+//
+// Looking up or down shears the view (moves the horizon) rather than
+// rotating it, as Doom does.
+class SoftwareRenderer : public IRenderer {
+public:
+    explicit SoftwareRenderer(const SoftwareRendererConfig& config = SoftwareRendererConfig());
+    ~SoftwareRenderer() override;
+
+    // Disable copy (may own a GPU texture)
+    SoftwareRenderer(const SoftwareRenderer&) = delete;
+    SoftwareRenderer& operator=(const SoftwareRenderer&) = delete;
+
+    void render(const game::Level& level, const game::Camera& camera) override;
+    void render_sprites(const std::vector<Sprite>& sprites, const game::Camera& camera) override;
+    void begin_frame() override;
+    void end_frame() override;
+
+    int get_width() const { return m_width; }
+    int get_height() const { return m_height; }
+
+    // Pixels of the last frame, width * height of them
+    core::Span<const uint32_t> get_framebuffer() const {
+        return core::Span<const uint32_t>(m_pixels.data(), m_pixels.size());
+    }
+
+    // Colour the framebuffer is cleared to
+    static uint32_t get_clear_color();
+
+    const SoftwareRenderStats& get_stats() const { return m_stats; }
+
+    // Texels per side of the generated textures (one texture per world unit)
+    static constexpr int TEXTURE_BITS = 6;
+    static constexpr int TEXTURE_SIZE = 1 << TEXTURE_BITS;
+
+private:
+    // A wall piece projected to the screen, left column first
+    struct ProjectedWall {
+        float x_left;               // Screen x of each end
+        float x_right;
+        float inv_depth_left;       // 1 / depth, linear across the screen
+        float inv_depth_right;
+        float u_left;               // Texture u / depth, likewise
+        float u_right;
+        float floor_height;
+        float ceiling_height;
+        bool portal;
+        float back_floor_height;    // Sector seen through the portal
+        float back_ceiling_height;
+        const uint32_t* texels;
+        const uint32_t* floor_texels;
+        const uint32_t* ceiling_texels;
+    };
+
+    // Rows of a strip's columns showing one floor or ceiling
+    struct Visplane {
+        float height;
+        const uint32_t* texels;
+        int min_x;                  // Strip columns used, inclusive
+        int max_x;
+        std::vector<int> top;       // Rows per column, inclusive
+        std::vector<int> bottom;
+    };
+
+    // Per-strip clipping and planes, kept between frames
+    struct Strip {
+        int x_begin;
+        int x_end;
+        std::vector<int> clip_top;      // First open row per column
+        std::vector<int> clip_bottom;   // One past the last open row
+        std::vector<Visplane> planes;
+        size_t plane_count;
+        std::vector<int> span_start;    // Per row, while making spans
+        uint32_t wall_columns;
+        uint32_t spans;
+    };
+
+    // The camera, as the rasteriser sees it
+    struct View {
+        Vector3 eye;
+        float forward_x;            // Flat forward and right
+        float forward_z;
+        float right_x;
+        float right_z;
+        float focal;                // Pixels per unit at depth 1
+        float center_x;
+        float horizon;              // Screen row level with the eye
+    };
+
+    int m_width;
+    int m_height;
+    platform::ThreadPool* m_pool;
+
+    std::vector<uint32_t> m_pixels;
+    std::vector<float> m_column_depth;     // Depth where each column closed
+    std::vector<Strip> m_strips;
+    std::vector<ProjectedWall> m_walls;
+    View m_view;
+
+    game::VisibilityQuery m_visibility_query;
+    game::PortalVisibility m_portal_visibility;
+
+    // Generated textures by (id, use); sector windings of the level
+    // they were made for
+    std::unordered_map<uint32_t, std::vector<uint32_t>> m_textures;
+    std::vector<int8_t> m_sector_winding;
+    uint64_t m_revision;
+
+    struct SpriteDistance {
+        const Sprite* sprite;
+        float distance_sq;
+    };
+    std::vector<SpriteDistance> m_sorted_sprites;
+
+    SoftwareRenderStats m_stats;
+
+    Texture2D m_texture;        // Framebuffer on the GPU, when there's a window
+    bool m_has_texture;
+
+    void prepare(const game::Level& level);
+    const uint32_t* get_texels(uint32_t texture_id, uint32_t use);
+    void set_view(const game::Camera& camera);
+
+    // Visible sub-sectors, or sectors when there's no tree, front to back
+    core::Span<const uint32_t> find_pieces(const game::Level& level, const game::Camera& camera,
+                                           bool& by_subsector);
+    void project_piece(const game::Level& level, bool by_subsector, uint32_t piece);
+    void project_wall(const game::Level& level, uint32_t sector_index, uint32_t wall,
+                      const game::Vertex& start, const game::Vertex& end, float u_start);
+
+    void render_strip(Strip& strip);
+    size_t find_plane(Strip& strip, float height, const uint32_t* texels, int start, int stop);
+    void draw_planes(Strip& strip);
+    void draw_span(const Visplane& plane, int y, int x1, int x2);
+    void draw_sprite(const Sprite& sprite);
+};
+
+} // namespace rendering
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "core/span.h"
+#include <cstdint>
+#include <vector>
+
+namespace rendering {
+
+// One surface queued for drawing: a sort key and what to draw
+struct DrawItem {
+    uint32_t key;
+    uint32_t item;
+};
+
+// Per-frame list of visible surfaces, sorted by a packed 32-bit key before
+// submission so state changes happen as rarely as possible. Keys order by
+// pass, then state group (texture), then depth, front to back. Sorting is
+// a stable LSD radix sort over the key bytes, skipping bytes every key
+// shares; buffers are reused, so a steady-state frame allocates nothing.
+class DrawList {
+public:
+    // Key field widths
+    static constexpr uint32_t PASS_BITS = 2;
+    static constexpr uint32_t GROUP_BITS = 16;
+    static constexpr uint32_t DEPTH_BITS = 10;
+
+    static constexpr uint32_t MAX_GROUPS = 1u << GROUP_BITS;
+
+    DrawList() = default;
+    ~DrawList() = default;
+
+    // Pack a key. depth is 0 (near) to 1 (far) and clamped.
+    static uint32_t make_key(uint32_t pass, uint32_t group, float depth);
+    static uint32_t get_pass(uint32_t key) { return key >> (GROUP_BITS + DEPTH_BITS); }
+    static uint32_t get_group(uint32_t key) { return (key >> DEPTH_BITS) & (MAX_GROUPS - 1); }
+
+    void clear() { m_items.clear(); }
+    void add(uint32_t key, uint32_t item) { m_items.push_back({key, item}); }
+
+    // Sort by key; equal keys keep the order they were added in
+    void sort();
+
+    core::Span<const DrawItem> get_items() const {
+        return core::Span<const DrawItem>(m_items.data(), m_items.size());
+    }
+    size_t size() const { return m_items.size(); }
+
+private:
+    std::vector<DrawItem> m_items;
+    std::vector<DrawItem> m_scratch;
+};
+
+inline uint32_t DrawList::make_key(uint32_t pass, uint32_t group, float depth) {
+    constexpr uint32_t max_depth = (1u << DEPTH_BITS) - 1;
+    float scaled = depth * static_cast<float>(max_depth);
+    uint32_t quantized = scaled <= 0.0f ? 0u
+                       : scaled >= static_cast<float>(max_depth) ? max_depth
+                       : static_cast<uint32_t>(scaled);
+    return (pass << (GROUP_BITS + DEPTH_BITS)) | ((group & (MAX_GROUPS - 1)) << DEPTH_BITS) |
+           quantized;
+}
+
+} // namespace rendering
@@ -0,0 +1,203 @@
+#pragma once
+
+#include "raylib.h"
+#include "game/level.h"
+#include "game/floor_triangulation.h"
+#include "rendering/scene/draw_list.h"
+#include "rendering/textures/texture_manager.h"
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace rendering {
+
+// Draw counters for the last LevelMesh frame
+struct LevelMeshStats {
+    uint32_t draw_calls;        // One per batch with anything visible
+    uint32_t texture_binds;     // Changes of texture between draw calls
+    uint32_t triangles;
+    uint32_t pieces;            // Sub-sectors (or sectors) drawn
+
+    LevelMeshStats()
+        : draw_calls(0)
+        , texture_binds(0)
+        , triangles(0)
+        , pieces(0) {}
+};
+
+// A level's static geometry, built once into GPU vertex buffers grouped by
+// texture. The level is cut into pieces: its BSP sub-sectors, or whole
+// sectors when it has no tree. Each piece's walls, floor and ceiling are
+// triangles in the batches of their textures; floors and ceilings of any
+// simple outline, convex or not, come from a FloorTriangulation.
+//
+// A frame queues the index ranges of the visible pieces on a DrawList,
+// keyed by batch and distance. Batches are ranked in texture order, so
+// once sorted, each texture is bound once and each batch gets one draw
+// call with its triangles front to back.
+//
+// Batches hold at most 65536 vertices (raylib meshes use 16-bit indices),
+// so a texture used by a lot of geometry gets several.
+//
+// Sector edits don't rebuild it: update() lays out again only the pieces
+// of the sectors the level reports changed, into batches of their own that
+// are re-uploaded as they fill, and leaves the old triangles in place,
+// unused. Everything else keeps its triangles. Once half of what was
+// uploaded is unused the next update() builds from scratch.
+class LevelMesh {
+public:
+    explicit LevelMesh(TextureManager& texture_manager);
+    ~LevelMesh();
+
+    // Disable copy (owns GPU buffers)
+    LevelMesh(const LevelMesh&) = delete;
+    LevelMesh& operator=(const LevelMesh&) = delete;
+
+    // Lay out the level's geometry and upload it, replacing what was there
+    void build(const game::Level& level);
+
+    // Bring the mesh up to the level's revision, patching in changed
+    // sectors when the level can say which, else building from scratch
+    void update(const game::Level& level);
+
+    // Built from the level as it is now (same revision)
+    bool is_built_for(const game::Level& level) const;
+
+    // Leave out solid walls lying on the given game::CHUNK_EDGE_* sides of
+    // a box: the seams of a streamed chunk onto a resident neighbour
+    // (game::LevelStreamer::get_open_seams()), which the player walks
+    // through. A change builds the mesh again at the next update().
+    void set_open_edges(float min_x, float min_z, float max_x, float max_z, uint32_t edges);
+
+    // Free the GPU buffers and geometry
+    void unload();
+
+    // Frame: start a draw list seen from eye, add the visible pieces, draw
+    void begin_frame(const Vector3& eye);
+    void add_subsector(uint32_t subsector);
+    void add_sector(uint32_t sector);
+    void draw();
+
+    const LevelMeshStats& get_stats() const { return m_stats; }
+
+    // Geometry totals
+    uint32_t get_batch_count() const { return static_cast<uint32_t>(m_batches.size()); }
+    size_t get_vertex_count() const;
+    size_t get_triangle_count() const;
+
+private:
+    struct Batch {
+        uint32_t texture;
+
+        // Vertex attributes, dropped once uploaded
+        std::vector<float> positions;           // x, y, z
+        std::vector<float> texcoords;           // u, v
+        std::vector<unsigned char> colors;      // r, g, b, a
+        uint32_t vertex_count;
+
+        // Every triangle of the batch
+        std::vector<uint16_t> indices;
+
+        Mesh mesh;
+        bool uploaded;
+        bool dirty;         // Added to since the last upload
+
+        Batch();
+    };
+
+    enum class SurfaceKind : uint8_t {
+        WALL,
+        FLOOR,
+        CEILING
+    };
+
+    // One wall quad, floor or ceiling of a piece
+    struct Surface {
+        uint32_t texture;
+        SurfaceKind kind;
+        uint32_t index;     // Seg (sub-sector pieces) or wall (sector pieces)
+    };
+
+    // Triangles a piece has in one batch
+    struct Range {
+        uint32_t batch;
+        uint32_t first_index;
+        uint32_t index_count;
+    };
+
+    TextureManager& m_texture_manager;
+    Material m_material;
+    Texture2D m_default_diffuse;            // Material's own texture, put back on unload
+    bool m_has_material;
+    uint64_t m_revision;
+    bool m_by_subsector;        // Pieces are BSP sub-sectors, not sectors
+
+    std::vector<Batch> m_batches;
+
+    // Draw order of each batch (texture order), and the batch per texture
+    // that new geometry goes into; those keep their vertex arrays
+    std::vector<uint32_t> m_batch_ranks;
+    std::unordered_map<uint32_t, uint32_t> m_open_batches;
+
+    // Indices of triangles no piece uses any more
+    size_t m_dead_indices;
+
+    // Box (min x, min z, max x, max z) and sides of it left open
+    float m_open_box[4];
+    uint32_t m_open_edges;
+
+    // Piece p has ranges m_ranges[m_range_offsets[p] .. [p + 1])
+    std::vector<uint32_t> m_range_offsets;
+    std::vector<Range> m_ranges;
+
+    // With sub-sector pieces, sector s is pieces
+    // m_sector_pieces[m_sector_offsets[s] .. [s + 1])
+    std::vector<uint32_t> m_sector_offsets;
+    std::vector<uint32_t> m_sector_pieces;
+
+    // Floor and ceiling triangles of each piece
+    game::FloorTriangulation m_floors;
+
+    // Piece centres (x, y, z) and the level's size, for depth keys
+    std::vector<float> m_piece_centers;
+    float m_inverse_depth_range;
+
+    // Scratch for laying out pieces and patching
+    std::vector<Surface> m_surfaces;
+    std::vector<game::Vertex> m_outline;
+    std::vector<uint32_t> m_floor_triangles;
+    std::vector<uint32_t> m_changed_sectors;
+
+    // This frame's visible ranges, and the indices of the batch being drawn
+    Vector3 m_eye;
+    DrawList m_draw_list;
+    std::vector<uint16_t> m_frame_indices;
+
+    LevelMeshStats m_stats;
+
+    void add_piece(uint32_t piece);
+
+    // Append a piece's surfaces to the open batches and its ranges to
+    // ranges; floor_triangles as from FloorTriangulation, or nullptr to
+    // triangulate here
+    void lay_out_piece(const game::Level& level, uint32_t piece, const uint32_t* floor_triangles,
+                       std::vector<Range>& ranges, float* center);
+
+    // Wall from a to b lies along an open edge
+    bool on_open_edge(const game::Vertex& a, const game::Vertex& b) const;
+
+    // Sector to sub-sector piece lists for the level's tree
+    void index_sector_pieces(const game::Level& level);
+
+    // Rank batches in texture order
+    void rank_batches();
+
+    // Upload batches added to since the last upload
+    void upload_dirty();
+
+    void upload(uint32_t index);
+    void draw_batch(uint32_t batch);
+    void unload_batch(Batch& batch);
+};
+
+} // namespace rendering
@@ -1,5 +1,9 @@
 #include "core/application.h"
 #include "game/level.h"
+#include "game/cooked_level.h"
+#include "game/json_level.h"
+#include "game/level_streamer.h"
+#include "platform/file_system.h"
 #include "raylib.h"
 
 namespace core {
@@ -39,8 +43,40 @@ void Application::initialize() {
 
     m_game_state = std::make_unique<game::GameState>();
 
-    // Load test level and move it into game state
-    m_game_state->initialize(game::Level::create_test_level());
+    // Streamed world: 64x64 chunks of 16x16 arena rooms, starting in the
+    // middle
+    if (m_config.streaming) {
+        game::LevelGeneratorConfig generator;
+        generator.layout = game::LevelLayout::ARENA;
+        generator.seed = 20240611;
+        const uint32_t rooms_per_chunk = 16;
+        const uint32_t world_chunks = 64;
+        auto source = std::make_unique<game::GeneratedChunkSource>(generator, rooms_per_chunk,
+                                                                   world_chunks);
+        float middle = source->get_chunk_size() * static_cast<float>(world_chunks / 2);
+        m_game_state->initialize_streaming(
+            std::make_unique<game::LevelStreamer>(std::move(source)), {middle, 0.0f, middle});
+        m_is_running = true;
+        return;
+    }
+
+    // Load the cooked test level if there is one, else its JSON source,
+    // else build it in code, then move it into game state
+    game::Level level;
+    std::string assets_path = platform::FileSystem::get_assets_path();
+    std::string cooked_path = platform::FileSystem::join_paths(assets_path, "levels", "test_level.ywlevel");
+    std::string json_path = platform::FileSystem::join_paths(assets_path, "levels", "test_level.json");
+    if (!game::CookedLevel::load(cooked_path, level)) {
+        std::string error;
+        if (game::JsonLevel::load(json_path, level, &error)) {
+            level.build_bsp();
+            level.build_pvs();
+        } else {
+            TraceLog(LOG_WARNING, "Level: %s", error.c_str());
+            level = game::Level::create_test_level();
+        }
+    }
+    m_game_state->initialize(std::move(level));
 
     m_is_running = true;
 }
@@ -67,11 +103,23 @@ void Application::update() {
     if (input.pause) {
         m_game_state->set_paused(!m_game_state->is_paused());
     }
+
+    // Switch between BSP and portal visibility for comparison
+    if (input.toggle_visibility) {
+        basic_renderer->set_visibility_mode(
+            basic_renderer->get_visibility_mode() == rendering::VisibilityMode::BSP
+                ? rendering::VisibilityMode::PORTALS
+                : rendering::VisibilityMode::BSP);
+    }
 }
 
 void Application::render() {
     m_renderer->begin_frame();
-    m_renderer->render(m_game_state->get_level(), m_game_state->get_camera());
+    if (const game::LevelStreamer* streamer = m_game_state->get_streamer()) {
+        m_renderer->render_world(*streamer, m_game_state->get_camera());
+    } else {
+        m_renderer->render(m_game_state->get_level(), m_game_state->get_camera());
+    }
     m_renderer->end_frame();
 }
 
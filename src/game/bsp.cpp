@@ -1,97 +1,768 @@
 #include "game/bsp.h"
+#include "platform/thread_pool.h"
+#include "raymath.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
 #include <cmath>
 #include <limits>
 
 namespace game {
 
-BSPTree::BSPTree()
-    : m_root(nullptr) {
+BSPTree::BSPTree() {
 }
 
-void BSPTree::build_from_level(const Level& level) {
-    // Collect all sector indices
-    std::vector<uint32_t> all_sectors;
-    const auto& sectors = level.get_sectors();
+void BSPTree::build_from_level(const Level& level, const BSPBuildConfig& config) {
+    build(level.get_sectors(), level.get_geometry(), config);
+}
+
+void BSPTree::build(const std::vector<Sector>& sectors, const LevelGeometry& geometry,
+                    const BSPBuildConfig& config) {
+    auto start_time = std::chrono::steady_clock::now();
+
+    m_config = config;
+    m_config.max_depth = std::min(std::max(m_config.max_depth, 0), MAX_DEPTH);
+    m_stats = BSPBuildStats();
+
+    // Every sector starts out as one whole fragment
+    std::vector<BuildFragment> fragments;
+    size_t vertex_total = 0;
+    size_t wall_total = 0;
+    fragments.reserve(sectors.size());
     for (size_t i = 0; i < sectors.size(); ++i) {
-        all_sectors.push_back(static_cast<uint32_t>(i));
+        if (sectors[i].vertex_count < 3) {
+            continue;  // No area, nothing to partition
+        }
+        fragments.push_back(make_fragment(geometry, sectors[i], static_cast<uint32_t>(i)));
+        vertex_total += sectors[i].vertex_count;
+        wall_total += sectors[i].wall_count;
+    }
+
+    // Reset flat storage; a balanced tree has about two nodes per sector
+    m_nodes.clear();
+    m_subsectors.clear();
+    m_subsector_vertices.clear();
+    m_segs.clear();
+    m_backing.reset();
+    m_nodes.reserve(fragments.size() * 2 + 1);
+    m_subsectors.reserve(fragments.size());
+    m_subsector_vertices.reserve(vertex_total);
+    m_segs.reserve(wall_total);
+
+    // Build tree recursively (root lands at index 0)
+    build_node(fragments, 0);
+    splice_parts();
+
+    m_stats.node_count = static_cast<uint32_t>(m_nodes.size());
+    m_stats.subsector_count = static_cast<uint32_t>(m_subsectors.size());
+    if (m_stats.leaf_count > 0) {
+        m_stats.average_leaf_size = static_cast<float>(m_subsectors.size()) /
+                                    static_cast<float>(m_stats.leaf_count);
+    }
+    m_stats.build_time_ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start_time).count();
+}
+
+void BSPTree::attach(std::shared_ptr<const void> backing, const BSPFlatData& data,
+                     const BSPBuildStats& stats) {
+    m_backing = std::move(backing);
+    m_nodes.borrow(data.nodes, data.node_count);
+    m_subsectors.borrow(data.subsectors, data.subsector_count);
+    m_subsector_vertices.borrow(data.subsector_vertices, data.subsector_vertex_count);
+    m_segs.borrow(data.segs, data.seg_count);
+    m_stats = stats;
+}
+
+void BSPTree::rebuild_from(const BSPTree& previous, const BSPRebuildInput& input) {
+    if (!previous.is_built()) {
+        build(input.sectors, input.geometry, previous.m_config);
+        return;
+    }
+
+    auto start_time = std::chrono::steady_clock::now();
+
+    m_config = previous.m_config;
+    m_stats = BSPBuildStats();
+
+    RebuildContext context;
+    context.previous = &previous;
+    context.input = &input;
+    context.changed.assign(input.sector_count, 0);
+    for (uint32_t sector : input.changed) {
+        if (sector < input.sector_count) {
+            context.changed[sector] = 1;
+        }
+    }
+
+    // Subtrees own contiguous sub-sector ranges, so a prefix count says in
+    // O(1) whether a subtree holds any piece of a changed sector
+    const auto& old_subsectors = previous.m_subsectors;
+    context.changed_prefix.assign(old_subsectors.size() + 1, 0);
+    for (size_t i = 0; i < old_subsectors.size(); ++i) {
+        uint32_t sector = old_subsectors[i].sector;
+        bool changed = sector >= input.sector_count || context.changed[sector];
+        context.changed_prefix[i + 1] = context.changed_prefix[i] + (changed ? 1 : 0);
+    }
+
+    // New shapes of the changed sectors enter at the root and are
+    // partitioned down the old splitters
+    std::vector<BuildFragment> incoming;
+    for (uint32_t index : input.changed) {
+        const Sector* sector = input.find(index);
+        if (sector && index < input.sector_count && sector->vertex_count >= 3) {
+            incoming.push_back(make_fragment(input.geometry, *sector, index));
+        }
+    }
+
+    m_nodes.clear();
+    m_subsectors.clear();
+    m_subsector_vertices.clear();
+    m_segs.clear();
+    m_backing.reset();
+    m_nodes.reserve(previous.m_nodes.size() + incoming.size() * 2);
+    m_subsectors.reserve(previous.m_subsectors.size() + incoming.size());
+    m_subsector_vertices.reserve(previous.m_subsector_vertices.size());
+    m_segs.reserve(previous.m_segs.size());
+
+    rebuild_node(context, 0, incoming, 0);
+    splice_parts();
+
+    m_stats.node_count = static_cast<uint32_t>(m_nodes.size());
+    m_stats.subsector_count = static_cast<uint32_t>(m_subsectors.size());
+
+    // Every cut adds one fragment, so splits change with the fragment count
+    // less the sectors gained
+    int64_t split_count = static_cast<int64_t>(previous.m_stats.split_count) +
+                          static_cast<int64_t>(m_stats.subsector_count) -
+                          static_cast<int64_t>(previous.m_subsectors.size()) -
+                          input.area_sector_change;
+    m_stats.split_count = static_cast<uint32_t>(std::max<int64_t>(split_count, 0));
+    if (m_stats.leaf_count > 0) {
+        m_stats.average_leaf_size = static_cast<float>(m_subsectors.size()) /
+                                    static_cast<float>(m_stats.leaf_count);
+    }
+    m_stats.build_time_ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start_time).count();
+}
+
+uint32_t BSPTree::rebuild_node(RebuildContext& context, uint32_t old_index,
+                               std::vector<BuildFragment>& incoming, int depth) {
+    const BSPTree& previous = *context.previous;
+    const BSPNode& old_node = previous.m_nodes[old_index];
+
+    uint32_t range_end = old_node.first_subsector + old_node.subsector_count;
+    bool touched = context.changed_prefix[range_end] != context.changed_prefix[old_node.first_subsector];
+    if (!touched && incoming.empty()) {
+        return copy_subtree(previous, old_index, depth);
     }
 
-    // Build tree recursively
-    m_root = build_node(all_sectors, level, 0);
+    if (old_node.is_leaf()) {
+        // Re-cut the leaf's unchanged sectors the way the first build did
+        // and build a fresh subtree from them plus the new pieces
+        std::vector<BuildFragment> fragments = std::move(incoming);
+        for (uint32_t i = 0; i < old_node.subsector_count; ++i) {
+            uint32_t sector = previous.m_subsectors[old_node.first_subsector + i].sector;
+            const Sector* unchanged = context.input->find(sector);
+            if (sector >= context.input->sector_count || context.changed[sector] || !unchanged) {
+                continue;
+            }
+
+            BuildFragment fragment = make_fragment(context.input->geometry, *unchanged, sector);
+            if (clip_to_path(context, fragment)) {
+                fragments.push_back(std::move(fragment));
+            }
+        }
+
+        if (fragments.empty() && depth > 0) {
+            return BSP_NULL_NODE;
+        }
+        return build_node(fragments, depth);
+    }
+
+    // Keep the old splitter; claim this node's slot before the children
+    uint32_t node_index = static_cast<uint32_t>(m_nodes.size());
+    m_nodes.emplace_back();
+    m_nodes[node_index].splitter = old_node.splitter;
+    m_stats.max_depth = std::max(m_stats.max_depth, static_cast<uint32_t>(depth));
+
+    std::vector<BuildFragment> front_incoming;
+    std::vector<BuildFragment> back_incoming;
+    partition_fragments(old_node.splitter, incoming, front_incoming, back_incoming);
+    std::vector<BuildFragment>().swap(incoming);
+
+    size_t splice_count = m_splices.size();
+    uint32_t children[2] = {BSP_NULL_NODE, BSP_NULL_NODE};
+    uint32_t old_children[2] = {old_node.front, old_node.back};
+    std::vector<BuildFragment>* child_incoming[2] = {&front_incoming, &back_incoming};
+    for (int side = 0; side < 2; ++side) {
+        if (old_children[side] != BSP_NULL_NODE) {
+            context.path.emplace_back(old_node.splitter, side == 0 ? 1 : -1);
+            children[side] = rebuild_node(context, old_children[side], *child_incoming[side], depth + 1);
+            context.path.pop_back();
+        } else if (!child_incoming[side]->empty()) {
+            children[side] = build_node(*child_incoming[side], depth + 1);
+        }
+    }
+
+    if (children[0] == BSP_NULL_NODE && children[1] == BSP_NULL_NODE) {
+        if (node_index > 0) {
+            // Nothing is left under this node; it is still the last one
+            m_nodes.edit().pop_back();
+            return BSP_NULL_NODE;
+        }
+        emit_subsectors(std::vector<BuildFragment>(), m_nodes[node_index]);
+        m_stats.leaf_count++;
+        return node_index;
+    }
+
+    m_nodes[node_index].front = children[0];
+    m_nodes[node_index].back = children[1];
+    merge_child_bounds(m_nodes[node_index]);
+    if (m_splices.size() != splice_count) {
+        m_merge_again.push_back(node_index);
+    }
+    return node_index;
 }
 
-std::unique_ptr<BSPNode> BSPTree::build_node(const std::vector<uint32_t>& sector_indices,
-                                              const Level& level, int depth) {
-    // Create new node
-    auto node = std::make_unique<BSPNode>();
+uint32_t BSPTree::copy_subtree(const BSPTree& source, uint32_t source_index, int depth) {
+    uint32_t node_index = static_cast<uint32_t>(m_nodes.size());
+    m_nodes.push_back(source.m_nodes[source_index]);
+    m_stats.max_depth = std::max(m_stats.max_depth, static_cast<uint32_t>(depth));
+
+    const BSPNode& source_node = source.m_nodes[source_index];
+    if (source_node.is_leaf()) {
+        // Same sub-sectors, moved to the end of this tree's arrays
+        m_nodes[node_index].first_subsector = static_cast<uint32_t>(m_subsectors.size());
+        for (uint32_t i = 0; i < source_node.subsector_count; ++i) {
+            BSPSubSector subsector = source.m_subsectors[source_node.first_subsector + i];
+            const Vertex* vertices = source.m_subsector_vertices.data() + subsector.first_vertex;
+            const BSPSeg* segs = source.m_segs.data() + subsector.first_seg;
+
+            subsector.first_vertex = static_cast<uint32_t>(m_subsector_vertices.size());
+            subsector.first_seg = static_cast<uint32_t>(m_segs.size());
+            m_subsector_vertices.append(vertices, vertices + subsector.vertex_count);
+            m_segs.append(segs, segs + subsector.seg_count);
+            m_subsectors.push_back(subsector);
+        }
+
+        m_stats.leaf_count++;
+        m_stats.max_leaf_size = std::max(m_stats.max_leaf_size, source_node.subsector_count);
+        return node_index;
+    }
 
-    // Base case: single sector or max depth reached
-    if (sector_indices.size() <= 1 || depth > 16) {
-        // Leaf node - store all sectors
-        node->sector_indices = sector_indices;
-        return node;
+    uint32_t front = BSP_NULL_NODE;
+    uint32_t back = BSP_NULL_NODE;
+    if (source_node.front != BSP_NULL_NODE) {
+        front = copy_subtree(source, source_node.front, depth + 1);
+    }
+    if (source_node.back != BSP_NULL_NODE) {
+        back = copy_subtree(source, source_node.back, depth + 1);
     }
 
-    // Choose a splitter line from the sectors' walls
-    node->splitter = choose_splitter(sector_indices, level);
+    m_nodes[node_index].front = front;
+    m_nodes[node_index].back = back;
+    merge_child_bounds(m_nodes[node_index]);
+    return node_index;
+}
+
+bool BSPTree::clip_to_path(const RebuildContext& context, BuildFragment& fragment) const {
+    // Same decisions partition_fragments made on the way down
+    for (const auto& step : context.path) {
+        const BSPSplitter& splitter = step.first;
+        int side = classify_fragment(splitter, fragment);
+        if (side != 0) {
+            if (side != step.second) {
+                return false;
+            }
+            continue;
+        }
 
-    // Partition sectors
-    std::vector<uint32_t> front_sectors;
-    std::vector<uint32_t> back_sectors;
-    std::vector<uint32_t> spanning_sectors;
+        BuildFragment front;
+        BuildFragment back;
+        split_fragment(splitter, fragment, front, back);
+        fragment = std::move(step.second > 0 ? front : back);
+        if (fragment.points.size() < 3) {
+            return false;
+        }
+    }
+    return true;
+}
 
-    partition_sectors(node->splitter, sector_indices, level,
-                     front_sectors, back_sectors, spanning_sectors);
+BSPTree::BuildFragment BSPTree::make_fragment(const LevelGeometry& geometry,
+                                              const Sector& sector,
+                                              uint32_t sector_index) const {
+    BuildFragment fragment;
+    fragment.sector = sector_index;
+    fragment.floor_height = sector.floor_height;
+    fragment.ceiling_height = sector.ceiling_height;
 
-    // Add spanning sectors to both sides
-    for (uint32_t idx : spanning_sectors) {
-        front_sectors.push_back(idx);
-        back_sectors.push_back(idx);
+    uint32_t count = sector.vertex_count;
+    fragment.points.resize(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        fragment.points[i] = geometry.get_vertex(sector, i);
+    }
+
+    // Attach each wall to the outline edge it runs along
+    fragment.edges.assign(count, FragmentEdge{-1, false, Vertex()});
+    for (uint32_t w = 0; w < sector.wall_count; ++w) {
+        uint32_t vertex_a = geometry.wall_vertex_a[sector.first_wall + w];
+        uint32_t vertex_b = geometry.wall_vertex_b[sector.first_wall + w];
+        if (vertex_a >= count || vertex_b >= count) {
+            continue;
+        }
+
+        FragmentEdge edge{static_cast<int32_t>(w), false, fragment.points[vertex_a]};
+        if (vertex_b == (vertex_a + 1) % count) {
+            fragment.edges[vertex_a] = edge;
+        } else if (vertex_a == (vertex_b + 1) % count) {
+            edge.reversed = true;
+            fragment.edges[vertex_b] = edge;
+        }
+    }
+
+    return fragment;
+}
+
+uint32_t BSPTree::build_node(std::vector<BuildFragment>& fragments, int depth) {
+    // Claim a slot for this node; children are appended after it, so
+    // always go through the index since push_back may reallocate
+    uint32_t node_index = static_cast<uint32_t>(m_nodes.size());
+    m_nodes.emplace_back();
+
+    m_stats.max_depth = std::max(m_stats.max_depth, static_cast<uint32_t>(depth));
+
+    // Choose a splitter line from the fragments' walls. Stop at a single
+    // fragment, at max depth, or when no wall separates the fragments.
+    BSPSplitter splitter;
+    if (fragments.size() <= 1 || depth >= m_config.max_depth ||
+        !choose_splitter(fragments, splitter)) {
+        // Leaf node - the fragments become its sub-sectors
+        emit_subsectors(fragments, m_nodes[node_index]);
+
+        m_stats.leaf_count++;
+        m_stats.max_leaf_size = std::max(m_stats.max_leaf_size,
+                                         m_nodes[node_index].subsector_count);
+        return node_index;
+    }
+
+    m_nodes[node_index].splitter = splitter;
+
+    // Partition fragments, cutting the ones that span the splitter so
+    // each piece ends up on exactly one side
+    std::vector<BuildFragment> front_fragments;
+    std::vector<BuildFragment> back_fragments;
+    partition_fragments(splitter, fragments, front_fragments, back_fragments);
+
+    // This level's list is no longer needed; free it before recursing
+    std::vector<BuildFragment>().swap(fragments);
+
+    // Big subtrees are independent enough to build side by side
+    if (m_config.task_cutoff > 0 &&
+        front_fragments.size() + back_fragments.size() >= m_config.task_cutoff &&
+        !front_fragments.empty() && !back_fragments.empty()) {
+        build_children_parallel(front_fragments, back_fragments, depth + 1, node_index);
+        m_merge_again.push_back(node_index);
+        return node_index;
     }
 
     // Recursively build child nodes
-    if (!front_sectors.empty()) {
-        node->front = build_node(front_sectors, level, depth + 1);
+    size_t splice_count = m_splices.size();
+    if (!front_fragments.empty()) {
+        uint32_t front = build_node(front_fragments, depth + 1);
+        m_nodes[node_index].front = front;
     }
 
-    if (!back_sectors.empty()) {
-        node->back = build_node(back_sectors, level, depth + 1);
+    if (!back_fragments.empty()) {
+        uint32_t back = build_node(back_fragments, depth + 1);
+        m_nodes[node_index].back = back;
     }
 
-    return node;
+    merge_child_bounds(m_nodes[node_index]);
+    if (m_splices.size() != splice_count) {
+        m_merge_again.push_back(node_index);
+    }
+    return node_index;
 }
 
-BSPSplitter BSPTree::choose_splitter(const std::vector<uint32_t>& sector_indices,
-                                      const Level& level) const {
-    // Simple heuristic: use the first wall of the first sector
-    // More sophisticated: evaluate all walls and choose best split
-    if (sector_indices.empty()) {
-        return BSPSplitter();
+platform::ThreadPool& BSPTree::get_pool() const {
+    return m_config.pool ? *m_config.pool : platform::ThreadPool::get_shared();
+}
+
+void BSPTree::build_children_parallel(std::vector<BuildFragment>& front_fragments,
+                                      std::vector<BuildFragment>& back_fragments,
+                                      int depth, uint32_t node_index) {
+    // Each side gets a private tree so the tasks share nothing; their root
+    // lands at index 0 and depths stay absolute
+    Splice splice;
+    splice.node = node_index;
+    splice.cut = {m_nodes.size(), m_subsectors.size(), m_subsector_vertices.size(), m_segs.size()};
+    splice.before = {0, 0, 0, 0};
+    if (!m_splices.empty()) {
+        const Splice& last = m_splices.back();
+        splice.before = last.before + last.front_sizes + last.back_sizes;
     }
+    splice.front = std::make_unique<BSPTree>();
+    splice.back = std::make_unique<BSPTree>();
+    BSPTree& front_tree = *splice.front;
+    BSPTree& back_tree = *splice.back;
+    front_tree.m_config = m_config;
+    back_tree.m_config = m_config;
 
-    const auto& sectors = level.get_sectors();
-    const Sector& first_sector = sectors[sector_indices[0]];
+    get_pool().fork_join(
+        [&]() { front_tree.build_node(front_fragments, depth); },
+        [&]() { back_tree.build_node(back_fragments, depth); });
+
+    splice.front_sizes = front_tree.get_spliced_sizes();
+    splice.back_sizes = back_tree.get_spliced_sizes();
+    for (const BSPTree* part : {&front_tree, &back_tree}) {
+        m_stats.split_count += part->m_stats.split_count;
+        m_stats.leaf_count += part->m_stats.leaf_count;
+        m_stats.max_depth = std::max(m_stats.max_depth, part->m_stats.max_depth);
+        m_stats.max_leaf_size = std::max(m_stats.max_leaf_size, part->m_stats.max_leaf_size);
+    }
+    m_splices.push_back(std::move(splice));
+}
+
+BSPTree::BuildSizes BSPTree::get_spliced_sizes() const {
+    BuildSizes sizes = {m_nodes.size(), m_subsectors.size(), m_subsector_vertices.size(),
+                        m_segs.size()};
+    if (!m_splices.empty()) {
+        const Splice& last = m_splices.back();
+        sizes = sizes + last.before + last.front_sizes + last.back_sizes;
+    }
+    return sizes;
+}
 
-    if (first_sector.walls.empty() || first_sector.vertices.size() < 2) {
-        return BSPSplitter();
+void BSPTree::place_parts(const BuildSizes& base, std::vector<PartPlacement>& out) const {
+    // Each splice's parts go right after what this tree built before them
+    out.push_back({this, base});
+    for (const Splice& splice : m_splices) {
+        BuildSizes front_base = base + splice.cut + splice.before;
+        splice.front->place_parts(front_base, out);
+        splice.back->place_parts(front_base + splice.front_sizes, out);
     }
+}
 
-    // Use first wall as splitter
-    const Wall& wall = first_sector.walls[0];
-    const Vertex& v1 = first_sector.vertices[wall.vertex_a];
-    const Vertex& v2 = first_sector.vertices[wall.vertex_b];
+uint32_t BSPTree::get_spliced_index(const BuildSizes& base, size_t BuildSizes::*field,
+                                    size_t index) const {
+    // Moved along by the parts of every splice made at or before it
+    auto after = std::upper_bound(m_splices.begin(), m_splices.end(), index,
+        [field](size_t value, const Splice& splice) { return value < splice.cut.*field; });
+    size_t shift = 0;
+    if (after != m_splices.begin()) {
+        const Splice& splice = *(after - 1);
+        shift = splice.before.*field + splice.front_sizes.*field + splice.back_sizes.*field;
+    }
+    return static_cast<uint32_t>(base.*field + index + shift);
+}
 
-    // Calculate direction and normalize
-    float dx = v2.x - v1.x;
-    float dz = v2.z - v1.z;
-    float length = sqrtf(dx * dx + dz * dz);
+void BSPTree::copy_to_splice(const BuildSizes& base, BSPNode* nodes, BSPSubSector* subsectors,
+                             Vertex* vertices, BSPSeg* segs) const {
+    for (size_t i = 0; i < m_nodes.size(); ++i) {
+        BSPNode node = m_nodes[i];
+        if (node.front != BSP_NULL_NODE) {
+            node.front = get_spliced_index(base, &BuildSizes::nodes, node.front);
+        }
+        if (node.back != BSP_NULL_NODE) {
+            node.back = get_spliced_index(base, &BuildSizes::nodes, node.back);
+        }
+        node.first_subsector = get_spliced_index(base, &BuildSizes::subsectors, node.first_subsector);
+        nodes[get_spliced_index(base, &BuildSizes::nodes, i)] = node;
+    }
 
-    if (length > 0.0f) {
-        dx /= length;
-        dz /= length;
+    // Splice nodes get the parts' roots as children
+    for (const Splice& splice : m_splices) {
+        uint32_t index = get_spliced_index(base, &BuildSizes::nodes, splice.node);
+        nodes[index].front = index + 1;
+        nodes[index].back = index + 1 + static_cast<uint32_t>(splice.front_sizes.nodes);
     }
 
-    return BSPSplitter(v1.x, v1.z, dx, dz);
+    for (size_t i = 0; i < m_subsectors.size(); ++i) {
+        BSPSubSector subsector = m_subsectors[i];
+        subsector.first_vertex = get_spliced_index(base, &BuildSizes::vertices, subsector.first_vertex);
+        subsector.first_seg = get_spliced_index(base, &BuildSizes::segs, subsector.first_seg);
+        subsectors[get_spliced_index(base, &BuildSizes::subsectors, i)] = subsector;
+    }
+
+    // Vertices and segs hold no indices; copy them a stretch between
+    // splices at a time
+    size_t vertex_start = 0;
+    size_t seg_start = 0;
+    for (size_t k = 0; k <= m_splices.size(); ++k) {
+        size_t vertex_end = k < m_splices.size() ? m_splices[k].cut.vertices : m_subsector_vertices.size();
+        size_t seg_end = k < m_splices.size() ? m_splices[k].cut.segs : m_segs.size();
+        std::copy(m_subsector_vertices.begin() + vertex_start, m_subsector_vertices.begin() + vertex_end,
+                  vertices + get_spliced_index(base, &BuildSizes::vertices, vertex_start));
+        std::copy(m_segs.begin() + seg_start, m_segs.begin() + seg_end,
+                  segs + get_spliced_index(base, &BuildSizes::segs, seg_start));
+        vertex_start = vertex_end;
+        seg_start = seg_end;
+    }
+}
+
+void BSPTree::splice_parts() {
+    if (m_splices.empty()) {
+        m_merge_again.clear();
+        return;
+    }
+
+    // Every tree's place is known from the part sizes alone, so the
+    // copies don't depend on each other
+    std::vector<PartPlacement> placements;
+    place_parts(BuildSizes{0, 0, 0, 0}, placements);
+    BuildSizes sizes = get_spliced_sizes();
+
+    core::FlatArray<BSPNode> nodes;
+    core::FlatArray<BSPSubSector> subsectors;
+    core::FlatArray<Vertex> vertices;
+    core::FlatArray<BSPSeg> segs;
+    nodes.assign(sizes.nodes, BSPNode());
+    subsectors.assign(sizes.subsectors, BSPSubSector());
+    vertices.assign(sizes.vertices, Vertex());
+    segs.assign(sizes.segs, BSPSeg());
+    BSPNode* node_data = nodes.edit().data();
+    BSPSubSector* subsector_data = subsectors.edit().data();
+    Vertex* vertex_data = vertices.edit().data();
+    BSPSeg* seg_data = segs.edit().data();
+    get_pool().parallel_for(placements.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            placements[i].tree->copy_to_splice(placements[i].base, node_data, subsector_data,
+                                               vertex_data, seg_data);
+        }
+    });
+
+    // Nodes over a splice merged their children before the parts were in
+    // place; merge them again, parts before the trees they hang from
+    std::vector<uint32_t> merge_again;
+    for (auto it = placements.rbegin(); it != placements.rend(); ++it) {
+        for (uint32_t node : it->tree->m_merge_again) {
+            merge_again.push_back(it->tree->get_spliced_index(it->base, &BuildSizes::nodes, node));
+        }
+    }
+
+    m_nodes = std::move(nodes);
+    m_subsectors = std::move(subsectors);
+    m_subsector_vertices = std::move(vertices);
+    m_segs = std::move(segs);
+    m_splices.clear();
+    m_merge_again.clear();
+    for (uint32_t index : merge_again) {
+        merge_child_bounds(m_nodes[index]);
+    }
+}
+
+void BSPTree::merge_child_bounds(BSPNode& node) const {
+    bool first = true;
+    uint32_t subtree_end = 0;
+
+    for (uint32_t child_index : {node.front, node.back}) {
+        if (child_index == BSP_NULL_NODE) {
+            continue;
+        }
+
+        const BSPNode& child = m_nodes[child_index];
+        if (first) {
+            node.bounds = child.bounds;
+            node.first_subsector = child.first_subsector;
+            first = false;
+        } else {
+            node.bounds.min = Vector3Min(node.bounds.min, child.bounds.min);
+            node.bounds.max = Vector3Max(node.bounds.max, child.bounds.max);
+        }
+        subtree_end = std::max(subtree_end, child.first_subsector + child.subsector_count);
+    }
+
+    node.subsector_count = subtree_end - node.first_subsector;
+}
+
+void BSPTree::emit_subsectors(const std::vector<BuildFragment>& fragments, BSPNode& leaf) {
+    leaf.first_subsector = static_cast<uint32_t>(m_subsectors.size());
+    leaf.subsector_count = static_cast<uint32_t>(fragments.size());
+
+    // Start inverted so an empty leaf never passes a frustum test
+    const float inf = std::numeric_limits<float>::infinity();
+    leaf.bounds.min = {inf, inf, inf};
+    leaf.bounds.max = {-inf, -inf, -inf};
+
+    for (const BuildFragment& fragment : fragments) {
+        for (const Vertex& v : fragment.points) {
+            leaf.bounds.min.x = std::min(leaf.bounds.min.x, v.x);
+            leaf.bounds.min.z = std::min(leaf.bounds.min.z, v.z);
+            leaf.bounds.max.x = std::max(leaf.bounds.max.x, v.x);
+            leaf.bounds.max.z = std::max(leaf.bounds.max.z, v.z);
+        }
+        leaf.bounds.min.y = std::min(leaf.bounds.min.y, fragment.floor_height);
+        leaf.bounds.max.y = std::max(leaf.bounds.max.y, fragment.ceiling_height);
+
+        BSPSubSector subsector;
+        subsector.sector = fragment.sector;
+        subsector.first_vertex = static_cast<uint32_t>(m_subsector_vertices.size());
+        subsector.vertex_count = static_cast<uint32_t>(fragment.points.size());
+        subsector.first_seg = static_cast<uint32_t>(m_segs.size());
+
+        m_subsector_vertices.append(fragment.points.begin(), fragment.points.end());
+
+        // Wall-backed edges become segs; splitter edges are open space
+        size_t count = fragment.points.size();
+        for (size_t i = 0; i < count; ++i) {
+            const FragmentEdge& edge = fragment.edges[i];
+            if (edge.wall < 0) {
+                continue;
+            }
+
+            const Vertex& a = fragment.points[i];
+            const Vertex& b = fragment.points[(i + 1) % count];
+
+            BSPSeg seg;
+            seg.start = edge.reversed ? b : a;
+            seg.end = edge.reversed ? a : b;
+            seg.wall = static_cast<uint32_t>(edge.wall);
+            float dx = seg.start.x - edge.wall_start.x;
+            float dz = seg.start.z - edge.wall_start.z;
+            seg.offset = sqrtf(dx * dx + dz * dz);
+            m_segs.push_back(seg);
+        }
+
+        subsector.seg_count = static_cast<uint32_t>(m_segs.size()) - subsector.first_seg;
+        m_subsectors.push_back(subsector);
+    }
+}
+
+bool BSPTree::choose_splitter(const std::vector<BuildFragment>& fragments,
+                              BSPSplitter& splitter) const {
+    // Every non-degenerate wall edge in the set is a candidate line
+    std::vector<BSPSplitter> candidates;
+    for (const BuildFragment& fragment : fragments) {
+        size_t count = fragment.points.size();
+        for (size_t i = 0; i < count; ++i) {
+            if (fragment.edges[i].wall < 0) {
+                continue;
+            }
+
+            const Vertex& v1 = fragment.points[i];
+            const Vertex& v2 = fragment.points[(i + 1) % count];
+
+            // Calculate direction and normalize
+            float dx = v2.x - v1.x;
+            float dz = v2.z - v1.z;
+            float length = sqrtf(dx * dx + dz * dz);
+            if (length <= 0.0f) {
+                continue;
+            }
+
+            candidates.emplace_back(v1.x, v1.z, dx / length, dz / length);
+        }
+    }
+
+    if (candidates.empty()) {
+        return false;
+    }
+
+    // Sampling mode: score a strided subset of the candidates. The offset
+    // walks within each stride so the sample does not keep landing on the
+    // same wall of every sector.
+    std::vector<BSPSplitter> sampled;
+    const std::vector<BSPSplitter>* scored = &candidates;
+    if (m_config.max_candidates > 0 && candidates.size() > m_config.max_candidates) {
+        size_t stride = candidates.size() / m_config.max_candidates;
+        sampled.reserve(m_config.max_candidates);
+        for (size_t i = 0; i < m_config.max_candidates; ++i) {
+            sampled.push_back(candidates[i * stride + i % stride]);
+        }
+        scored = &sampled;
+    }
+
+    // Score one candidate; a line that leaves either side empty makes no
+    // progress and is rejected
+    const float rejected = std::numeric_limits<float>::max();
+    auto score = [&](const BSPSplitter& candidate) {
+        int front_count = 0;
+        int back_count = 0;
+        int spanning_count = 0;
+
+        for (const BuildFragment& fragment : fragments) {
+            int side = classify_fragment(candidate, fragment);
+            if (side > 0) {
+                front_count++;
+            } else if (side < 0) {
+                back_count++;
+            } else {
+                spanning_count++;
+            }
+        }
+
+        if (front_count + spanning_count == 0 || back_count + spanning_count == 0) {
+            return rejected;
+        }
+
+        return m_config.balance_weight * static_cast<float>(std::abs(front_count - back_count)) +
+               m_config.split_weight * static_cast<float>(spanning_count);
+    };
+
+    // Cost of every candidate in a list, in parallel for large sets
+    std::vector<float> costs;
+    auto score_all = [&](const std::vector<BSPSplitter>& list) {
+        costs.assign(list.size(), rejected);
+        size_t work = list.size() * fragments.size();
+
+        if (work >= m_config.parallel_threshold) {
+            get_pool().parallel_for(list.size(), 4,
+                [&](size_t begin, size_t end) {
+                    for (size_t i = begin; i < end; ++i) {
+                        costs[i] = score(list[i]);
+                    }
+                });
+        } else {
+            for (size_t i = 0; i < list.size(); ++i) {
+                costs[i] = score(list[i]);
+            }
+        }
+
+        // Lowest cost wins; ties go to the earliest candidate so builds are
+        // identical regardless of thread count
+        return static_cast<size_t>(
+            std::min_element(costs.begin(), costs.end()) - costs.begin());
+    };
+
+    size_t best = score_all(*scored);
+
+    // Nothing in the sample separates the set; fall back to every wall
+    // before giving up and making a leaf
+    if (costs[best] == rejected && scored != &candidates) {
+        scored = &candidates;
+        best = score_all(candidates);
+    }
+
+    if (costs[best] == rejected) {
+        return false;
+    }
+
+    splitter = (*scored)[best];
+    return true;
+}
+
+int BSPTree::classify_fragment(const BSPSplitter& splitter,
+                               const BuildFragment& fragment) const {
+    // Classify all vertices of the fragment
+    int front_count = 0;
+    int back_count = 0;
+
+    for (const Vertex& v : fragment.points) {
+        int classification = classify_point(splitter, v.x, v.z);
+        if (classification > 0) {
+            front_count++;
+        } else if (classification < 0) {
+            back_count++;
+        }
+    }
+
+    // Vertices on the line go with whichever side the rest are on
+    if (back_count == 0) {
+        return 1;
+    } else if (front_count == 0) {
+        return -1;
+    }
+    return 0;
 }
 
 int BSPTree::classify_point(const BSPSplitter& splitter, float x, float z) const {
@@ -101,90 +772,335 @@ int BSPTree::classify_point(const BSPSplitter& splitter, float x, float z) const
     float dz = z - splitter.z;
     float cross = dx * splitter.dz - dz * splitter.dx;
 
-    const float epsilon = 0.001f;
-
-    if (cross > epsilon) {
+    if (cross > CLASSIFY_EPSILON) {
         return 1;  // Front
-    } else if (cross < -epsilon) {
+    } else if (cross < -CLASSIFY_EPSILON) {
         return -1; // Back
     }
     return 0; // On line
 }
 
-void BSPTree::partition_sectors(const BSPSplitter& splitter,
-                                const std::vector<uint32_t>& sector_indices,
-                                const Level& level,
-                                std::vector<uint32_t>& front_sectors,
-                                std::vector<uint32_t>& back_sectors,
-                                std::vector<uint32_t>& spanning_sectors) const {
-    const auto& sectors = level.get_sectors();
+void BSPTree::split_fragment(const BSPSplitter& splitter, const BuildFragment& fragment,
+                             BuildFragment& front, BuildFragment& back) const {
+    size_t count = fragment.points.size();
 
-    for (uint32_t idx : sector_indices) {
-        const Sector& sector = sectors[idx];
+    std::vector<int> sides(count);
+    std::vector<float> distances(count);
+    for (size_t i = 0; i < count; ++i) {
+        const Vertex& v = fragment.points[i];
+        sides[i] = classify_point(splitter, v.x, v.z);
+        distances[i] = (v.x - splitter.x) * splitter.dz - (v.z - splitter.z) * splitter.dx;
+    }
 
-        // Classify all vertices of the sector
-        int front_count = 0;
-        int back_count = 0;
+    const FragmentEdge splitter_edge{-1, false, Vertex()};
 
-        for (const Vertex& v : sector.vertices) {
-            int classification = classify_point(splitter, v.x, v.z);
-            if (classification > 0) {
-                front_count++;
-            } else if (classification < 0) {
-                back_count++;
+    // Sutherland-Hodgman against one half-plane. Each output point carries
+    // the edge leaving it: the original wall while the outline stays on
+    // this side, the splitter once it crosses over.
+    auto clip = [&](int keep, BuildFragment& out) {
+        out.sector = fragment.sector;
+        out.points.clear();
+        out.edges.clear();
+
+        for (size_t i = 0; i < count; ++i) {
+            size_t j = (i + 1) % count;
+            int side_i = sides[i] * keep;
+            int side_j = sides[j] * keep;
+            const FragmentEdge& edge = fragment.edges[i];
+
+            if (side_i >= 0) {
+                out.points.push_back(fragment.points[i]);
+                out.edges.push_back((side_i == 0 && side_j < 0) ? splitter_edge : edge);
+            }
+
+            if (side_i * side_j < 0) {
+                // Edge crosses the line; cut it where it does
+                const Vertex& a = fragment.points[i];
+                const Vertex& b = fragment.points[j];
+                float t = distances[i] / (distances[i] - distances[j]);
+                out.points.emplace_back(a.x + (b.x - a.x) * t, a.z + (b.z - a.z) * t);
+                out.edges.push_back(side_i > 0 ? splitter_edge : edge);
             }
         }
+    };
+
+    clip(1, front);
+    clip(-1, back);
+}
 
-        // Determine which side the sector belongs to
-        if (back_count == 0) {
-            // All vertices in front or on line
-            front_sectors.push_back(idx);
-        } else if (front_count == 0) {
-            // All vertices in back or on line
-            back_sectors.push_back(idx);
+void BSPTree::partition_fragments(const BSPSplitter& splitter,
+                                  std::vector<BuildFragment>& fragments,
+                                  std::vector<BuildFragment>& front_fragments,
+                                  std::vector<BuildFragment>& back_fragments) {
+    for (BuildFragment& fragment : fragments) {
+        // Determine which side the fragment belongs to
+        int side = classify_fragment(splitter, fragment);
+        if (side > 0) {
+            front_fragments.push_back(std::move(fragment));
+        } else if (side < 0) {
+            back_fragments.push_back(std::move(fragment));
         } else {
-            // Sector spans the partition line
-            spanning_sectors.push_back(idx);
+            // Fragment spans the partition line - cut it in two
+            BuildFragment front;
+            BuildFragment back;
+            split_fragment(splitter, fragment, front, back);
+            m_stats.split_count++;
+
+            if (front.points.size() >= 3) {
+                front_fragments.push_back(std::move(front));
+            }
+            if (back.points.size() >= 3) {
+                back_fragments.push_back(std::move(back));
+            }
         }
     }
 }
 
+template <typename Visitor>
+void BSPTree::walk_front_to_back(const Vector3& camera_pos, const Frustum* frustum,
+                                 BSPCullStats* stats, Visitor&& visit) const {
+    if (m_nodes.empty()) {
+        return;
+    }
+
+    // Explicit-stack walk; the far child is pushed first so the near
+    // child is popped first, giving the same front-to-back order as a
+    // recursive traversal. Depth is capped at build time so a fixed
+    // array is enough.
+    std::array<uint32_t, MAX_STACK> stack;
+    size_t stack_size = 0;
+    stack[stack_size++] = 0;
+
+    while (stack_size > 0) {
+        const BSPNode& node = m_nodes[stack[--stack_size]];
+
+        if (frustum) {
+            if (stats) {
+                stats->nodes_visited++;
+            }
+
+            // Whole subtree is out of view
+            if (!frustum->intersects_box(node.bounds)) {
+                if (stats) {
+                    stats->nodes_culled++;
+                    stats->subsectors_culled += node.subsector_count;
+                }
+                continue;
+            }
+        }
+
+        if (node.is_leaf()) {
+            if (stats) {
+                stats->subsectors_visible += node.subsector_count;
+            }
+            visit(node);
+            continue;
+        }
+
+        // Classify camera position relative to splitter
+        int side = classify_point(node.splitter, camera_pos.x, camera_pos.z);
+        uint32_t near_child = (side >= 0) ? node.front : node.back;
+        uint32_t far_child = (side >= 0) ? node.back : node.front;
+
+        if (far_child != BSP_NULL_NODE) {
+            stack[stack_size++] = far_child;
+        }
+        if (near_child != BSP_NULL_NODE) {
+            stack[stack_size++] = near_child;
+        }
+    }
+}
+
+bool BSPTree::cast_ray(const Level& level, const Vector3& origin, const Vector3& direction,
+                       float max_distance, RayHit& hit) const {
+    float length = sqrtf(direction.x * direction.x + direction.y * direction.y +
+                         direction.z * direction.z);
+    if (m_nodes.empty() || length <= 0.0f || !(max_distance > 0.0f)) {
+        return false;
+    }
+
+    // Unit direction, so ray parameters are distances
+    float dx = direction.x / length;
+    float dy = direction.y / length;
+    float dz = direction.z / length;
+
+    const auto& sectors = level.get_sectors();
+    const auto& wall_portals = level.get_geometry().wall_portal;
+    const auto& portals = level.get_portals();
+
+    // Stretch of the ray still to be tested inside a subtree. The far
+    // child is pushed before the near one, so stretches pop in order.
+    struct Span {
+        uint32_t node;
+        float t_min;
+        float t_max;
+    };
+    std::array<Span, MAX_STACK> stack;
+    size_t stack_size = 0;
+    stack[stack_size++] = {0, 0.0f, max_distance};
+
+    float best = max_distance;
+    bool found = false;
+
+    while (stack_size > 0) {
+        Span span = stack[--stack_size];
+
+        // Everything left is further away than the nearest hit so far
+        if (span.t_min > best) {
+            break;
+        }
+
+        const BSPNode& node = m_nodes[span.node];
+        if (node.is_leaf()) {
+            // Sub-sectors are cut with a tolerance, so accept a hit past
+            // this leaf's stretch too; the closest one still wins
+            for (uint32_t s = 0; s < node.subsector_count; ++s) {
+                const BSPSubSector& subsector = m_subsectors[node.first_subsector + s];
+                const Sector& sector = sectors[subsector.sector];
+
+                for (uint32_t i = 0; i < subsector.seg_count; ++i) {
+                    const BSPSeg& seg = m_segs[subsector.first_seg + i];
+                    float ex = seg.end.x - seg.start.x;
+                    float ez = seg.end.z - seg.start.z;
+                    float denom = dx * ez - dz * ex;
+                    if (denom == 0.0f) {
+                        continue;   // Parallel, grazing at most
+                    }
+
+                    // Range checks on the numerators (sign-flipped to a
+                    // positive denominator) so misses cost no division
+                    float ox = seg.start.x - origin.x;
+                    float oz = seg.start.z - origin.z;
+                    float t_num = ox * ez - oz * ex;
+                    float u_num = ox * dz - oz * dx;
+                    if (denom < 0.0f) {
+                        denom = -denom;
+                        t_num = -t_num;
+                        u_num = -u_num;
+                    }
+                    if (t_num < 0.0f || t_num >= best * denom || u_num < 0.0f || u_num > denom) {
+                        continue;
+                    }
+                    float t = t_num / denom;
+
+                    float y = origin.y + dy * t;
+                    int32_t portal_id = wall_portals[sector.first_wall + seg.wall];
+                    if (portal_id >= 0 && static_cast<size_t>(portal_id) < portals.size()) {
+                        const Portal& portal = portals[portal_id];
+                        if (y >= portal.floor_height && y <= portal.ceiling_height) {
+                            continue;
+                        }
+                    }
+
+                    best = t;
+                    found = true;
+                    hit.sector = subsector.sector;
+                    hit.wall = seg.wall;
+                    hit.distance = t;
+                    hit.point = {origin.x + dx * t, y, origin.z + dz * t};
+                }
+            }
+            continue;
+        }
+
+        // Side of the splitter at the start of the stretch, and where (if
+        // anywhere inside the stretch) the ray crosses it
+        const BSPSplitter& splitter = node.splitter;
+        float start_x = origin.x + dx * span.t_min;
+        float start_z = origin.z + dz * span.t_min;
+        float cross = (start_x - splitter.x) * splitter.dz - (start_z - splitter.z) * splitter.dx;
+        float rate = dx * splitter.dz - dz * splitter.dx;
+
+        bool front_first = (cross > 0.0f) || (cross == 0.0f && rate >= 0.0f);
+        uint32_t near_child = front_first ? node.front : node.back;
+        uint32_t far_child = front_first ? node.back : node.front;
+
+        float t_cross = std::numeric_limits<float>::infinity();
+        if ((cross > 0.0f && rate < 0.0f) || (cross < 0.0f && rate > 0.0f)) {
+            t_cross = span.t_min - cross / rate;
+        }
+
+        if (t_cross < span.t_max) {
+            if (far_child != BSP_NULL_NODE) {
+                stack[stack_size++] = {far_child, t_cross, span.t_max};
+            }
+            if (near_child != BSP_NULL_NODE) {
+                stack[stack_size++] = {near_child, span.t_min, t_cross};
+            }
+        } else if (near_child != BSP_NULL_NODE) {
+            stack[stack_size++] = {near_child, span.t_min, span.t_max};
+        }
+    }
+
+    return found;
+}
+
+uint32_t BSPTree::find_leaf(float x, float z) const {
+    if (m_nodes.empty()) {
+        return BSP_NULL_NODE;
+    }
+
+    uint32_t index = 0;
+    while (!m_nodes[index].is_leaf()) {
+        const BSPNode& node = m_nodes[index];
+        index = (classify_point(node.splitter, x, z) >= 0) ? node.front : node.back;
+        if (index == BSP_NULL_NODE) {
+            return BSP_NULL_NODE;
+        }
+    }
+    return index;
+}
+
 void BSPTree::get_visible_sectors(const Vector3& camera_pos,
                                   std::vector<uint32_t>& visible_sectors) const {
     visible_sectors.clear();
 
-    if (m_root) {
-        traverse_node(m_root.get(), camera_pos, visible_sectors);
-    }
+    walk_front_to_back(camera_pos, nullptr, nullptr, [&](const BSPNode& leaf) {
+        for (uint32_t i = 0; i < leaf.subsector_count; ++i) {
+            visible_sectors.push_back(m_subsectors[leaf.first_subsector + i].sector);
+        }
+    });
 }
 
-void BSPTree::traverse_node(const BSPNode* node, const Vector3& camera_pos,
-                           std::vector<uint32_t>& visible_sectors) const {
-    if (!node) {
-        return;
-    }
+void BSPTree::get_visible_subsectors(const Vector3& camera_pos,
+                                     std::vector<uint32_t>& visible_subsectors) const {
+    visible_subsectors.clear();
 
-    // If leaf node, add all sectors
-    if (node->is_leaf()) {
-        for (uint32_t idx : node->sector_indices) {
-            visible_sectors.push_back(idx);
+    walk_front_to_back(camera_pos, nullptr, nullptr, [&](const BSPNode& leaf) {
+        for (uint32_t i = 0; i < leaf.subsector_count; ++i) {
+            visible_subsectors.push_back(leaf.first_subsector + i);
         }
-        return;
+    });
+}
+
+void BSPTree::get_visible_sectors(const Frustum& frustum,
+                                  std::vector<uint32_t>& visible_sectors,
+                                  BSPCullStats* stats) const {
+    visible_sectors.clear();
+    if (stats) {
+        *stats = BSPCullStats();
     }
 
-    // Classify camera position relative to splitter
-    int side = classify_point(node->splitter, camera_pos.x, camera_pos.z);
+    walk_front_to_back(frustum.get_position(), &frustum, stats, [&](const BSPNode& leaf) {
+        for (uint32_t i = 0; i < leaf.subsector_count; ++i) {
+            visible_sectors.push_back(m_subsectors[leaf.first_subsector + i].sector);
+        }
+    });
+}
 
-    // Traverse front-to-back for proper rendering order
-    if (side >= 0) {
-        // Camera is on front side
-        traverse_node(node->front.get(), camera_pos, visible_sectors);
-        traverse_node(node->back.get(), camera_pos, visible_sectors);
-    } else {
-        // Camera is on back side
-        traverse_node(node->back.get(), camera_pos, visible_sectors);
-        traverse_node(node->front.get(), camera_pos, visible_sectors);
+void BSPTree::get_visible_subsectors(const Frustum& frustum,
+                                     std::vector<uint32_t>& visible_subsectors,
+                                     BSPCullStats* stats) const {
+    visible_subsectors.clear();
+    if (stats) {
+        *stats = BSPCullStats();
     }
+
+    walk_front_to_back(frustum.get_position(), &frustum, stats, [&](const BSPNode& leaf) {
+        for (uint32_t i = 0; i < leaf.subsector_count; ++i) {
+            visible_subsectors.push_back(leaf.first_subsector + i);
+        }
+    });
 }
 
 } // namespace game
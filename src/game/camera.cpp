@@ -117,6 +117,12 @@ Vector3 Camera::get_forward() const {
     return Vector3Normalize(Vector3Subtract(m_target, m_position));
 }
 
+Frustum Camera::get_frustum(float aspect, float far_distance) const {
+    // Near distance matches rlgl's default near clip plane
+    const float near_distance = 0.01f;
+    return Frustum(m_position, get_forward(), m_fov, aspect, near_distance, far_distance);
+}
+
 void Camera::update_target_from_angles() {
     // Calculate direction vector from yaw and pitch
     Vector3 direction;
@@ -0,0 +1,259 @@
+#include "game/collision.h"
+#include "game/spatial_grid.h"
+#include <algorithm>
+#include <cmath>
+
+namespace game {
+
+namespace {
+
+// Gap kept between the body and a wall after a contact, so the next sweep
+// doesn't start touching
+constexpr float SKIN = 0.001f;
+
+bool has_grid(const Level& level) {
+    const SpatialGrid* grid = level.get_spatial_grid();
+    return grid && grid->is_built();
+}
+
+} // namespace
+
+PlayerCollision::PlayerCollision(const CollisionConfig& config)
+    : m_config(config) {
+}
+
+Vector3 PlayerCollision::move(const Level& level, const Vector3& eye_position,
+                              const Vector3& delta) {
+    // One chunk with no seams
+    ChunkLevel chunk;
+    chunk.level = &level;
+    return move(core::Span<const ChunkLevel>(&chunk, 1), eye_position, delta);
+}
+
+Vector3 PlayerCollision::move(core::Span<const ChunkLevel> chunks, const Vector3& eye_position,
+                              const Vector3& delta) {
+    bool any_grid = false;
+    for (const ChunkLevel& chunk : chunks) {
+        any_grid = any_grid || has_grid(*chunk.level);
+    }
+    if (!any_grid) {
+        return {eye_position.x + delta.x, eye_position.y, eye_position.z + delta.z};
+    }
+
+    float x = eye_position.x;
+    float z = eye_position.z;
+    float feet_y = eye_position.y - m_config.eye_height;
+
+    // Slides never travel further than the move itself, so one gather
+    // within that distance covers all of them
+    float reach = sqrtf(delta.x * delta.x + delta.z * delta.z) + m_config.radius + SKIN;
+    gather_walls(chunks, feet_y, x - reach, z - reach, x + reach, z + reach);
+
+    depenetrate(x, z);
+
+    float move_x = delta.x;
+    float move_z = delta.z;
+    for (int slide = 0; slide <= m_config.max_slides; ++slide) {
+        float length = sqrtf(move_x * move_x + move_z * move_z);
+        if (length < 1e-6f) {
+            break;
+        }
+
+        float normal_x = 0.0f;
+        float normal_z = 0.0f;
+        float t = sweep(x, z, move_x, move_z, normal_x, normal_z);
+        if (t > 1.0f) {
+            x += move_x;
+            z += move_z;
+            break;
+        }
+
+        // Stop just short of the contact
+        float safe_t = std::max(t - SKIN / length, 0.0f);
+        x += move_x * safe_t;
+        z += move_z * safe_t;
+
+        // The last contact ends the move; otherwise slide along the wall
+        // with what is left of the motion
+        if (slide == m_config.max_slides) {
+            break;
+        }
+        float rest = 1.0f - safe_t;
+        move_x *= rest;
+        move_z *= rest;
+        float into = move_x * normal_x + move_z * normal_z;
+        if (into < 0.0f) {
+            move_x -= into * normal_x;
+            move_z -= into * normal_z;
+        }
+    }
+
+    // Walk up or down to the floor of wherever the body ended up
+    float eye_y = eye_position.y;
+    for (const ChunkLevel& chunk : chunks) {
+        int32_t sector = chunk.level->find_sector_at_point(x, z);
+        if (sector >= 0) {
+            eye_y = chunk.level->get_sector(static_cast<uint32_t>(sector)).floor_height + m_config.eye_height;
+            break;
+        }
+    }
+    return {x, eye_y, z};
+}
+
+void PlayerCollision::gather_walls(core::Span<const ChunkLevel> chunks, float feet_y,
+                                   float min_x, float min_z, float max_x, float max_z) {
+    m_walls.clear();
+
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        const Level& level = *chunks[i].level;
+        if (!has_grid(level)) {
+            continue;
+        }
+        const auto& sectors = level.get_sectors();
+        const LevelGeometry& geometry = level.get_geometry();
+        const auto& portals = level.get_portals();
+
+        level.get_spatial_grid()->for_each_wall_in_box(level, min_x, min_z, max_x, max_z,
+            [&](uint32_t sector_index, uint32_t wall) {
+                // Portals let the body through if it can step up into the
+                // opening and fits under its top
+                int32_t portal_id = geometry.wall_portal[wall];
+                if (portal_id >= 0 && static_cast<size_t>(portal_id) < portals.size()) {
+                    const Portal& portal = portals[portal_id];
+                    if (fits(feet_y, portal.floor_height, portal.ceiling_height)) {
+                        return;
+                    }
+                }
+
+                const Sector& sector = sectors[sector_index];
+                Vertex a = geometry.get_vertex(sector, geometry.wall_vertex_a[wall]);
+                Vertex b = geometry.get_vertex(sector, geometry.wall_vertex_b[wall]);
+
+                // So do seams into another chunk, like a portal between
+                // the sectors on either side
+                if (portal_id < 0 && chunks[i].seams != 0) {
+                    const Sector* across = find_sector_across(chunks, i, a, b);
+                    if (across && fits(feet_y, std::max(sector.floor_height, across->floor_height),
+                                       std::min(sector.ceiling_height, across->ceiling_height))) {
+                        return;
+                    }
+                }
+                m_walls.push_back({a, b});
+            });
+    }
+}
+
+bool PlayerCollision::fits(float feet_y, float floor_y, float ceiling_y) const {
+    float stand_y = std::max(feet_y, floor_y);
+    return floor_y <= feet_y + m_config.step_height && stand_y + m_config.height <= ceiling_y;
+}
+
+void PlayerCollision::depenetrate(float& x, float& z) const {
+    float radius = m_config.radius;
+    for (const WallSegment& wall : m_walls) {
+        float ex = wall.b.x - wall.a.x;
+        float ez = wall.b.z - wall.a.z;
+        float length_sq = ex * ex + ez * ez;
+        if (length_sq <= 0.0f) {
+            continue;
+        }
+
+        // Closest point on the wall
+        float s = std::clamp(((x - wall.a.x) * ex + (z - wall.a.z) * ez) / length_sq, 0.0f, 1.0f);
+        float cx = wall.a.x + ex * s;
+        float cz = wall.a.z + ez * s;
+        float dx = x - cx;
+        float dz = z - cz;
+        float distance = sqrtf(dx * dx + dz * dz);
+        if (distance >= radius) {
+            continue;
+        }
+
+        // Right on the wall: push out to the left of it
+        float normal_x = -ez;
+        float normal_z = ex;
+        float normal_length = sqrtf(length_sq);
+        if (distance > 1e-6f) {
+            normal_x = dx;
+            normal_z = dz;
+            normal_length = distance;
+        }
+        float push = radius - distance + SKIN;
+        x += normal_x / normal_length * push;
+        z += normal_z / normal_length * push;
+    }
+}
+
+float PlayerCollision::sweep(float x, float z, float dx, float dz,
+                             float& normal_x, float& normal_z) const {
+    float radius = m_config.radius;
+    float best = 2.0f;
+
+    for (const WallSegment& wall : m_walls) {
+        float ex = wall.b.x - wall.a.x;
+        float ez = wall.b.z - wall.a.z;
+        float length_sq = ex * ex + ez * ez;
+        if (length_sq <= 0.0f) {
+            continue;
+        }
+
+        // Flat side: reach the line at radius distance, on the side the
+        // circle starts from, with the contact inside the segment
+        float length = sqrtf(length_sq);
+        float nx = -ez / length;
+        float nz = ex / length;
+        float distance = (x - wall.a.x) * nx + (z - wall.a.z) * nz;
+        if (distance < 0.0f) {
+            nx = -nx;
+            nz = -nz;
+            distance = -distance;
+        }
+        float approach = dx * nx + dz * nz;
+        if (approach < 0.0f) {
+            // Already within radius (rounding after a slide): contact now
+            float t = std::max((distance - radius) / -approach, 0.0f);
+            if (t < best) {
+                float cx = x + dx * t;
+                float cz = z + dz * t;
+                float s = ((cx - wall.a.x) * ex + (cz - wall.a.z) * ez) / length_sq;
+                if (s >= 0.0f && s <= 1.0f) {
+                    best = t;
+                    normal_x = nx;
+                    normal_z = nz;
+                }
+            }
+        }
+
+        // Rounded ends: first time the center comes within radius of each
+        const Vertex* ends[2] = {&wall.a, &wall.b};
+        for (const Vertex* end : ends) {
+            float mx = x - end->x;
+            float mz = z - end->z;
+            float a = dx * dx + dz * dz;
+            float b = mx * dx + mz * dz;
+            float c = mx * mx + mz * mz - radius * radius;
+            if (b >= 0.0f) {
+                continue;   // Moving away
+            }
+            float discriminant = b * b - a * c;
+            if (discriminant < 0.0f) {
+                continue;
+            }
+            float t = std::max((-b - sqrtf(discriminant)) / a, 0.0f);
+            if (t >= 0.0f && t < best) {
+                float hit_x = mx + dx * t;
+                float hit_z = mz + dz * t;
+                float hit_length = sqrtf(hit_x * hit_x + hit_z * hit_z);
+                if (hit_length > 1e-6f) {
+                    best = t;
+                    normal_x = hit_x / hit_length;
+                    normal_z = hit_z / hit_length;
+                }
+            }
+        }
+    }
+
+    return best;
+}
+
+} // namespace game
@@ -0,0 +1,504 @@
+#include "game/cooked_level.h"
+#include "game/bsp.h"
+#include "game/pvs.h"
+#include "platform/mapped_file.h"
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace game {
+
+namespace {
+
+const char COOKED_MAGIC[8] = {'Y', 'W', 'C', 'O', 'O', 'K', 'E', 'D'};
+constexpr uint32_t BYTE_ORDER_MARK = 0x01020304u;
+
+// Sections start on this boundary so every array can be used in place
+constexpr size_t SECTION_ALIGNMENT = 16;
+
+enum SectionId : uint32_t {
+    SECTION_SECTORS = 1,
+    SECTION_VERTEX_X,
+    SECTION_VERTEX_Z,
+    SECTION_VERTEX_INDICES,
+    SECTION_WALL_VERTEX_A,
+    SECTION_WALL_VERTEX_B,
+    SECTION_WALL_TEXTURES,
+    SECTION_WALL_PORTALS,
+    SECTION_PORTALS,
+    SECTION_SPAWNS,
+    SECTION_BSP_NODES,
+    SECTION_BSP_SUBSECTORS,
+    SECTION_BSP_VERTICES,
+    SECTION_BSP_SEGS,
+    SECTION_BSP_STATS,
+    SECTION_PVS_ROWS,
+    SECTION_PVS_OFFSETS,
+    SECTION_PVS_STATS
+};
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t section_count;
+    uint32_t reserved;
+    uint64_t file_size;
+    uint64_t checksum;          // Of every byte after the header
+};
+
+struct SectionEntry {
+    uint32_t id;
+    uint32_t element_size;      // sizeof the stored struct, checked on load
+    uint64_t offset;            // From the start of the file
+    uint64_t count;
+};
+
+// Sector fields, with its outline and walls as ranges of the geometry arrays
+struct CookedSector {
+    uint32_t first_vertex;
+    uint32_t vertex_count;
+    uint32_t first_wall;
+    uint32_t wall_count;
+    float floor_height;
+    float ceiling_height;
+    uint32_t floor_texture;
+    uint32_t ceiling_texture;
+    float light_level;
+    uint32_t reserved;
+};
+
+static_assert(std::is_trivially_copyable<Vertex>::value, "cooked arrays must be plain data");
+static_assert(std::is_trivially_copyable<Portal>::value, "cooked arrays must be plain data");
+static_assert(std::is_trivially_copyable<EntitySpawn>::value, "cooked arrays must be plain data");
+static_assert(std::is_trivially_copyable<BSPNode>::value, "cooked arrays must be plain data");
+static_assert(std::is_trivially_copyable<BSPSubSector>::value, "cooked arrays must be plain data");
+static_assert(std::is_trivially_copyable<BSPSeg>::value, "cooked arrays must be plain data");
+static_assert(std::is_trivially_copyable<BSPBuildStats>::value, "cooked arrays must be plain data");
+static_assert(std::is_trivially_copyable<PVSBuildStats>::value, "cooked arrays must be plain data");
+
+// FNV-1a over 64-bit words (bytes for the tail); fast enough to check a
+// whole file on load
+uint64_t checksum(const unsigned char* data, size_t size) {
+    uint64_t hash = 14695981039346656037ull;
+    const uint64_t prime = 1099511628211ull;
+
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        memcpy(&word, data + i, sizeof(word));
+        hash = (hash ^ word) * prime;
+    }
+    for (; i < size; ++i) {
+        hash = (hash ^ data[i]) * prime;
+    }
+    return hash;
+}
+
+// Array queued for writing
+struct PendingSection {
+    uint32_t id;
+    uint32_t element_size;
+    const void* data;
+    uint64_t count;
+};
+
+template <typename T>
+PendingSection make_section(uint32_t id, const T* data, size_t count) {
+    return PendingSection{id, static_cast<uint32_t>(sizeof(T)), data, count};
+}
+
+size_t align_up(size_t value) {
+    return (value + SECTION_ALIGNMENT - 1) & ~(SECTION_ALIGNMENT - 1);
+}
+
+void set_error(std::string* error, const char* message) {
+    if (error) {
+        *error = message;
+    }
+}
+
+// Validated view of one section's array in the mapped file
+template <typename T>
+bool find_section(const platform::MappedFile& file, const SectionEntry* table,
+                  uint32_t section_count, uint32_t id, bool required,
+                  const T*& data, size_t& count) {
+    data = nullptr;
+    count = 0;
+
+    for (uint32_t i = 0; i < section_count; ++i) {
+        const SectionEntry& entry = table[i];
+        if (entry.id != id) {
+            continue;
+        }
+        if (entry.element_size != sizeof(T) || entry.offset % alignof(T) != 0 ||
+            entry.offset > file.get_size() ||
+            entry.count > (file.get_size() - entry.offset) / sizeof(T)) {
+            return false;
+        }
+        data = reinterpret_cast<const T*>(file.get_data() + entry.offset);
+        count = static_cast<size_t>(entry.count);
+        return true;
+    }
+    return !required;
+}
+
+// Indices inside the BSP arrays stay within them; cheap next to a rebuild
+// and keeps a bad file from sending the traversal out of bounds. Nodes are
+// stored in pre-order, so a child always comes after its parent: that rules
+// out cycles, and lets depths be filled in one pass and held to MAX_DEPTH,
+// which the traversal stacks are sized for.
+bool bsp_ranges_valid(const BSPNode* nodes, size_t node_count,
+                      const BSPSubSector* subsectors, size_t subsector_count,
+                      size_t sector_count, size_t vertex_count, size_t seg_count) {
+    std::vector<int> depth(node_count, -1);
+    if (node_count > 0) {
+        depth[0] = 0;
+    }
+    for (size_t i = 0; i < node_count; ++i) {
+        const BSPNode& node = nodes[i];
+        if (depth[i] < 0 ||
+            node.first_subsector > subsector_count ||
+            node.subsector_count > subsector_count - node.first_subsector) {
+            return false;   // Unreachable from the root, or range out of bounds
+        }
+        for (uint32_t child : {node.front, node.back}) {
+            if (child == BSP_NULL_NODE) {
+                continue;
+            }
+            if (child <= i || child >= node_count || depth[child] >= 0 ||
+                depth[i] >= BSPTree::MAX_DEPTH) {
+                return false;
+            }
+            depth[child] = depth[i] + 1;
+        }
+    }
+    for (size_t i = 0; i < subsector_count; ++i) {
+        const BSPSubSector& subsector = subsectors[i];
+        if (subsector.sector >= sector_count ||
+            subsector.first_vertex > vertex_count ||
+            subsector.vertex_count > vertex_count - subsector.first_vertex ||
+            subsector.first_seg > seg_count ||
+            subsector.seg_count > seg_count - subsector.first_seg) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+bool CookedLevel::write(const Level& level, const std::string& path, std::string* error) {
+    const BSPTree* bsp_tree = level.get_bsp_tree();
+    if (!bsp_tree || !bsp_tree->is_built()) {
+        set_error(error, "level has no built BSP tree");
+        return false;
+    }
+
+    // Geometry arrays go out as they are; sectors keep their ranges
+    const auto& sectors = level.get_sectors();
+    const LevelGeometry& geometry = level.get_geometry();
+    std::vector<CookedSector> cooked_sectors;
+    cooked_sectors.reserve(sectors.size());
+    for (const Sector& sector : sectors) {
+        CookedSector cooked;
+        cooked.first_vertex = sector.first_vertex;
+        cooked.vertex_count = sector.vertex_count;
+        cooked.first_wall = sector.first_wall;
+        cooked.wall_count = sector.wall_count;
+        cooked.floor_height = sector.floor_height;
+        cooked.ceiling_height = sector.ceiling_height;
+        cooked.floor_texture = sector.floor_texture;
+        cooked.ceiling_texture = sector.ceiling_texture;
+        cooked.light_level = sector.light_level;
+        cooked.reserved = 0;
+        cooked_sectors.push_back(cooked);
+    }
+
+    const auto& portals = level.get_portals();
+    const auto& spawns = level.get_spawns();
+    const BSPBuildStats& bsp_stats = bsp_tree->get_build_stats();
+
+    std::vector<PendingSection> sections;
+    sections.push_back(make_section(SECTION_SECTORS, cooked_sectors.data(), cooked_sectors.size()));
+    sections.push_back(make_section(SECTION_VERTEX_X, geometry.vertex_x.data(), geometry.vertex_x.size()));
+    sections.push_back(make_section(SECTION_VERTEX_Z, geometry.vertex_z.data(), geometry.vertex_z.size()));
+    sections.push_back(make_section(SECTION_VERTEX_INDICES, geometry.vertex_indices.data(),
+                                    geometry.vertex_indices.size()));
+    sections.push_back(make_section(SECTION_WALL_VERTEX_A, geometry.wall_vertex_a.data(),
+                                    geometry.wall_vertex_a.size()));
+    sections.push_back(make_section(SECTION_WALL_VERTEX_B, geometry.wall_vertex_b.data(),
+                                    geometry.wall_vertex_b.size()));
+    sections.push_back(make_section(SECTION_WALL_TEXTURES, geometry.wall_texture.data(),
+                                    geometry.wall_texture.size()));
+    sections.push_back(make_section(SECTION_WALL_PORTALS, geometry.wall_portal.data(),
+                                    geometry.wall_portal.size()));
+    sections.push_back(make_section(SECTION_PORTALS, portals.data(), portals.size()));
+    sections.push_back(make_section(SECTION_SPAWNS, spawns.data(), spawns.size()));
+    sections.push_back(make_section(SECTION_BSP_NODES, bsp_tree->get_nodes().data(),
+                                    bsp_tree->get_nodes().size()));
+    sections.push_back(make_section(SECTION_BSP_SUBSECTORS, bsp_tree->get_subsectors().data(),
+                                    bsp_tree->get_subsectors().size()));
+    sections.push_back(make_section(SECTION_BSP_VERTICES, bsp_tree->get_subsector_vertices().data(),
+                                    bsp_tree->get_subsector_vertices().size()));
+    sections.push_back(make_section(SECTION_BSP_SEGS, bsp_tree->get_segs().data(),
+                                    bsp_tree->get_segs().size()));
+    sections.push_back(make_section(SECTION_BSP_STATS, &bsp_stats, 1));
+
+    const PotentiallyVisibleSet* pvs = level.get_pvs();
+    if (pvs && pvs->is_built()) {
+        sections.push_back(make_section(SECTION_PVS_ROWS, pvs->get_rows().data(),
+                                        pvs->get_rows().size()));
+        sections.push_back(make_section(SECTION_PVS_OFFSETS, pvs->get_row_offsets().data(),
+                                        pvs->get_row_offsets().size()));
+        sections.push_back(make_section(SECTION_PVS_STATS, &pvs->get_build_stats(), 1));
+    }
+
+    // Lay out header, section table, then each array on an aligned offset
+    size_t offset = align_up(sizeof(FileHeader) + sections.size() * sizeof(SectionEntry));
+    std::vector<SectionEntry> table;
+    table.reserve(sections.size());
+    for (const PendingSection& section : sections) {
+        table.push_back(SectionEntry{section.id, section.element_size, offset, section.count});
+        offset = align_up(offset + section.element_size * section.count);
+    }
+
+    std::vector<unsigned char> buffer(offset, 0);
+    memcpy(buffer.data() + sizeof(FileHeader), table.data(), table.size() * sizeof(SectionEntry));
+    for (size_t i = 0; i < sections.size(); ++i) {
+        size_t bytes = sections[i].element_size * sections[i].count;
+        if (bytes > 0) {
+            memcpy(buffer.data() + table[i].offset, sections[i].data, bytes);
+        }
+    }
+
+    FileHeader header;
+    memcpy(header.magic, COOKED_MAGIC, sizeof(header.magic));
+    header.version = VERSION;
+    header.byte_order = BYTE_ORDER_MARK;
+    header.section_count = static_cast<uint32_t>(sections.size());
+    header.reserved = 0;
+    header.file_size = buffer.size();
+    header.checksum = checksum(buffer.data() + sizeof(FileHeader), buffer.size() - sizeof(FileHeader));
+    memcpy(buffer.data(), &header, sizeof(header));
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        set_error(error, "cannot open file for writing");
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+    if (!file) {
+        set_error(error, "write failed");
+        return false;
+    }
+    return true;
+}
+
+bool CookedLevel::load(const std::string& path, Level& level, std::string* error) {
+    // Shared so the BSP tree and PVS can keep borrowing from the mapping
+    auto file = std::make_shared<platform::MappedFile>();
+    if (!file->open(path)) {
+        set_error(error, "cannot map file");
+        return false;
+    }
+
+    FileHeader header;
+    if (file->get_size() < sizeof(header)) {
+        set_error(error, "file too small");
+        return false;
+    }
+    memcpy(&header, file->get_data(), sizeof(header));
+
+    if (memcmp(header.magic, COOKED_MAGIC, sizeof(header.magic)) != 0) {
+        set_error(error, "not a cooked level");
+        return false;
+    }
+    if (header.version != VERSION) {
+        set_error(error, "cooked level version mismatch");
+        return false;
+    }
+    if (header.byte_order != BYTE_ORDER_MARK) {
+        set_error(error, "cooked level byte order mismatch");
+        return false;
+    }
+    if (header.file_size != file->get_size() ||
+        header.section_count > (file->get_size() - sizeof(header)) / sizeof(SectionEntry)) {
+        set_error(error, "cooked level truncated");
+        return false;
+    }
+    if (checksum(file->get_data() + sizeof(header), file->get_size() - sizeof(header)) != header.checksum) {
+        set_error(error, "cooked level checksum mismatch");
+        return false;
+    }
+
+    const SectionEntry* table = reinterpret_cast<const SectionEntry*>(file->get_data() + sizeof(header));
+    uint32_t section_count = header.section_count;
+
+    const CookedSector* cooked_sectors;
+    const float* vertex_x;
+    const float* vertex_z;
+    const uint32_t* vertex_indices;
+    const uint32_t* wall_vertex_a;
+    const uint32_t* wall_vertex_b;
+    const uint32_t* wall_textures;
+    const int32_t* wall_portals;
+    const Portal* portals;
+    const EntitySpawn* spawns;
+    const BSPNode* nodes;
+    const BSPSubSector* subsectors;
+    const Vertex* subsector_vertices;
+    const BSPSeg* segs;
+    const BSPBuildStats* bsp_stats;
+    const uint8_t* pvs_rows;
+    const uint32_t* pvs_offsets;
+    const PVSBuildStats* pvs_stats;
+    size_t sector_count, vertex_count, vertex_z_count, index_count, portal_count, spawn_count;
+    size_t wall_count, wall_b_count, wall_texture_count, wall_portal_count;
+    size_t node_count, subsector_count, subsector_vertex_count, seg_count, bsp_stats_count;
+    size_t pvs_row_bytes, pvs_offset_count, pvs_stats_count;
+
+    bool valid =
+        find_section(*file, table, section_count, SECTION_SECTORS, true, cooked_sectors, sector_count) &&
+        find_section(*file, table, section_count, SECTION_VERTEX_X, true, vertex_x, vertex_count) &&
+        find_section(*file, table, section_count, SECTION_VERTEX_Z, true, vertex_z, vertex_z_count) &&
+        find_section(*file, table, section_count, SECTION_VERTEX_INDICES, true, vertex_indices, index_count) &&
+        find_section(*file, table, section_count, SECTION_WALL_VERTEX_A, true, wall_vertex_a, wall_count) &&
+        find_section(*file, table, section_count, SECTION_WALL_VERTEX_B, true, wall_vertex_b, wall_b_count) &&
+        find_section(*file, table, section_count, SECTION_WALL_TEXTURES, true,
+                     wall_textures, wall_texture_count) &&
+        find_section(*file, table, section_count, SECTION_WALL_PORTALS, true,
+                     wall_portals, wall_portal_count) &&
+        vertex_z_count == vertex_count && wall_b_count == wall_count &&
+        wall_texture_count == wall_count && wall_portal_count == wall_count &&
+        find_section(*file, table, section_count, SECTION_PORTALS, true, portals, portal_count) &&
+        find_section(*file, table, section_count, SECTION_SPAWNS, true, spawns, spawn_count) &&
+        find_section(*file, table, section_count, SECTION_BSP_NODES, true, nodes, node_count) &&
+        find_section(*file, table, section_count, SECTION_BSP_SUBSECTORS, true, subsectors, subsector_count) &&
+        find_section(*file, table, section_count, SECTION_BSP_VERTICES, true,
+                     subsector_vertices, subsector_vertex_count) &&
+        find_section(*file, table, section_count, SECTION_BSP_SEGS, true, segs, seg_count) &&
+        find_section(*file, table, section_count, SECTION_BSP_STATS, true, bsp_stats, bsp_stats_count) &&
+        find_section(*file, table, section_count, SECTION_PVS_ROWS, false, pvs_rows, pvs_row_bytes) &&
+        find_section(*file, table, section_count, SECTION_PVS_OFFSETS, false, pvs_offsets, pvs_offset_count) &&
+        find_section(*file, table, section_count, SECTION_PVS_STATS, false, pvs_stats, pvs_stats_count) &&
+        bsp_stats_count == 1 && node_count > 0 &&
+        bsp_ranges_valid(nodes, node_count, subsectors, subsector_count,
+                         sector_count, subsector_vertex_count, seg_count);
+    if (!valid) {
+        set_error(error, "cooked level sections malformed");
+        return false;
+    }
+
+    for (size_t i = 0; i < index_count; ++i) {
+        if (vertex_indices[i] >= vertex_count) {
+            set_error(error, "cooked vertex index out of range");
+            return false;
+        }
+    }
+
+    // Geometry is copied into the level's pools; the BSP and PVS are used
+    // straight from the mapping
+    std::vector<Sector> sectors(sector_count);
+    for (size_t i = 0; i < sector_count; ++i) {
+        const CookedSector& cooked = cooked_sectors[i];
+        if (cooked.first_vertex > index_count || cooked.vertex_count > index_count - cooked.first_vertex ||
+            cooked.first_wall > wall_count || cooked.wall_count > wall_count - cooked.first_wall) {
+            set_error(error, "cooked sector out of range");
+            return false;
+        }
+
+        for (uint32_t w = cooked.first_wall; w < cooked.first_wall + cooked.wall_count; ++w) {
+            if (wall_vertex_a[w] >= cooked.vertex_count || wall_vertex_b[w] >= cooked.vertex_count ||
+                (wall_portals[w] >= 0 && static_cast<size_t>(wall_portals[w]) >= portal_count)) {
+                set_error(error, "cooked wall out of range");
+                return false;
+            }
+        }
+
+        Sector& sector = sectors[i];
+        sector.first_vertex = cooked.first_vertex;
+        sector.vertex_count = cooked.vertex_count;
+        sector.first_wall = cooked.first_wall;
+        sector.wall_count = cooked.wall_count;
+        sector.floor_height = cooked.floor_height;
+        sector.ceiling_height = cooked.ceiling_height;
+        sector.floor_texture = cooked.floor_texture;
+        sector.ceiling_texture = cooked.ceiling_texture;
+        sector.light_level = cooked.light_level;
+    }
+
+    // Segs name walls by their place in the sub-sector's sector, and walls
+    // lead through portals to sectors; both are followed without checks
+    for (size_t i = 0; i < subsector_count; ++i) {
+        const BSPSubSector& subsector = subsectors[i];
+        uint32_t sector_walls = cooked_sectors[subsector.sector].wall_count;
+        for (uint32_t s = subsector.first_seg; s < subsector.first_seg + subsector.seg_count; ++s) {
+            if (segs[s].wall >= sector_walls) {
+                set_error(error, "cooked seg wall out of range");
+                return false;
+            }
+        }
+    }
+    for (size_t i = 0; i < portal_count; ++i) {
+        if (portals[i].target_sector >= sector_count) {
+            set_error(error, "cooked portal target out of range");
+            return false;
+        }
+    }
+
+    LevelGeometry geometry;
+    geometry.vertex_x.assign(vertex_x, vertex_x + vertex_count);
+    geometry.vertex_z.assign(vertex_z, vertex_z + vertex_count);
+    geometry.vertex_indices.assign(vertex_indices, vertex_indices + index_count);
+    geometry.wall_vertex_a.assign(wall_vertex_a, wall_vertex_a + wall_count);
+    geometry.wall_vertex_b.assign(wall_vertex_b, wall_vertex_b + wall_count);
+    geometry.wall_texture.assign(wall_textures, wall_textures + wall_count);
+    geometry.wall_portal.assign(wall_portals, wall_portals + wall_count);
+
+    Level loaded;
+    loaded.reserve(0, portal_count);
+    loaded.set_sectors(std::move(sectors), std::move(geometry));
+    for (size_t i = 0; i < portal_count; ++i) {
+        loaded.add_portal(portals[i]);
+    }
+    for (size_t i = 0; i < spawn_count; ++i) {
+        loaded.add_entity_spawn(spawns[i]);
+    }
+
+    BSPFlatData bsp_data;
+    bsp_data.nodes = nodes;
+    bsp_data.node_count = static_cast<uint32_t>(node_count);
+    bsp_data.subsectors = subsectors;
+    bsp_data.subsector_count = static_cast<uint32_t>(subsector_count);
+    bsp_data.subsector_vertices = subsector_vertices;
+    bsp_data.subsector_vertex_count = static_cast<uint32_t>(subsector_vertex_count);
+    bsp_data.segs = segs;
+    bsp_data.seg_count = static_cast<uint32_t>(seg_count);
+
+    auto bsp_tree = std::make_unique<BSPTree>();
+    bsp_tree->attach(file, bsp_data, *bsp_stats);
+
+    std::unique_ptr<PotentiallyVisibleSet> pvs;
+    bool pvs_valid = pvs_offsets && pvs_offset_count == node_count + 1 && pvs_stats_count == 1;
+    for (size_t i = 0; pvs_valid && i + 1 < pvs_offset_count; ++i) {
+        pvs_valid = pvs_offsets[i] <= pvs_offsets[i + 1] && pvs_offsets[i + 1] <= pvs_row_bytes;
+    }
+    if (pvs_valid) {
+        pvs = std::make_unique<PotentiallyVisibleSet>();
+        pvs->attach(file, pvs_rows, pvs_row_bytes, pvs_offsets, pvs_offset_count,
+                    static_cast<uint32_t>(sector_count), *pvs_stats);
+        if (!pvs->rows_in_range()) {
+            set_error(error, "cooked pvs row out of range");
+            return false;
+        }
+    }
+
+    loaded.set_precomputed(std::move(bsp_tree), std::move(pvs));
+    level = std::move(loaded);
+    return true;
+}
+
+} // namespace game
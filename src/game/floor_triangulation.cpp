@@ -0,0 +1,184 @@
+#include "game/floor_triangulation.h"
+#include "game/bsp.h"
+#include "platform/thread_pool.h"
+#include <algorithm>
+#include <atomic>
+
+namespace game {
+
+namespace {
+
+// Pieces per thread pool task
+constexpr size_t TRIANGULATE_GRAIN = 1024;
+
+// Bend, relative to the outline's size squared, below which a corner the
+// wrong way round still counts as convex
+constexpr float CONVEX_TOLERANCE = 1e-6f;
+
+// Twice the signed area of triangle a, b, c in (x, z)
+float cross(const Vertex& a, const Vertex& b, const Vertex& c) {
+    return (b.x - a.x) * (c.z - a.z) - (c.x - a.x) * (b.z - a.z);
+}
+
+bool same_position(const Vertex& a, const Vertex& b) {
+    return a.x == b.x && a.z == b.z;
+}
+
+} // namespace
+
+FloorTriangulation::FloorTriangulation()
+    : m_revision(0)
+    , m_by_subsector(false)
+    , m_concave_count(0) {
+}
+
+bool FloorTriangulation::is_built_for(const Level& level) const {
+    return m_revision != 0 && m_revision == level.get_revision();
+}
+
+uint32_t FloorTriangulation::get_outline(const Level& level, bool by_subsector, uint32_t piece,
+                                         std::vector<Vertex>& out) {
+    if (by_subsector) {
+        const BSPTree& tree = *level.get_bsp_tree();
+        const BSPSubSector& subsector = tree.get_subsector(piece);
+        const Vertex* vertices = tree.get_subsector_vertices().data() + subsector.first_vertex;
+        out.assign(vertices, vertices + subsector.vertex_count);
+    } else {
+        const Sector& sector = level.get_sector(piece);
+        out.resize(sector.vertex_count);
+        for (uint32_t i = 0; i < sector.vertex_count; ++i) {
+            out[i] = level.get_geometry().get_vertex(sector, i);
+        }
+    }
+    return static_cast<uint32_t>(out.size());
+}
+
+bool FloorTriangulation::triangulate(const Vertex* vertices, uint32_t count, uint32_t* out) {
+    float twice_area = 0.0f;
+    float min_x = vertices[0].x;
+    float min_z = vertices[0].z;
+    float max_x = vertices[0].x;
+    float max_z = vertices[0].z;
+    for (uint32_t i = 0; i < count; ++i) {
+        // Relative to the first vertex, so small pieces far from the
+        // origin don't lose their area to rounding
+        const Vertex& a = vertices[i];
+        const Vertex& b = vertices[(i + 1) % count];
+        twice_area += cross(vertices[0], a, b);
+        min_x = std::min(min_x, a.x);
+        min_z = std::min(min_z, a.z);
+        max_x = std::max(max_x, a.x);
+        max_z = std::max(max_z, a.z);
+    }
+    float sign = twice_area < 0.0f ? -1.0f : 1.0f;
+
+    // Corners bent less than this (rounding in slivers) count as straight
+    float extent = std::max(max_x - min_x, max_z - min_z);
+    float flat = extent * extent * CONVEX_TOLERANCE;
+
+    // Write a triangle with positive area whatever the outline's winding
+    auto emit = [&out, sign](uint32_t a, uint32_t b, uint32_t c) {
+        *out++ = a;
+        *out++ = sign > 0.0f ? b : c;
+        *out++ = sign > 0.0f ? c : b;
+    };
+
+    bool convex = true;
+    for (uint32_t i = 0; i < count && convex; ++i) {
+        const Vertex& previous = vertices[(i + count - 1) % count];
+        const Vertex& next = vertices[(i + 1) % count];
+        convex = cross(previous, vertices[i], next) * sign >= -flat;
+    }
+    if (convex) {
+        for (uint32_t i = 1; i + 1 < count; ++i) {
+            emit(0, i, i + 1);
+        }
+        return true;
+    }
+
+    // Ear clipping over a ring of the vertices left
+    std::vector<uint32_t> previous(count);
+    std::vector<uint32_t> next(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        previous[i] = (i + count - 1) % count;
+        next[i] = (i + 1) % count;
+    }
+
+    auto is_ear = [&](uint32_t corner) {
+        const Vertex& a = vertices[previous[corner]];
+        const Vertex& b = vertices[corner];
+        const Vertex& c = vertices[next[corner]];
+        if (cross(a, b, c) * sign <= 0.0f) {
+            return false;   // Reflex or flat
+        }
+
+        // No other vertex left may lie in the triangle
+        for (uint32_t other = next[next[corner]]; other != previous[corner]; other = next[other]) {
+            const Vertex& p = vertices[other];
+            if (same_position(p, a) || same_position(p, b) || same_position(p, c)) {
+                continue;
+            }
+            if (cross(a, b, p) * sign >= 0.0f && cross(b, c, p) * sign >= 0.0f &&
+                cross(c, a, p) * sign >= 0.0f) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    uint32_t corner = 0;
+    uint32_t remaining = count;
+    uint32_t misses = 0;
+    while (remaining > 3) {
+        // Bad outlines (self-crossing) may run out of ears; clip regardless
+        // so there are always count - 2 triangles
+        if (is_ear(corner) || misses >= remaining) {
+            emit(previous[corner], corner, next[corner]);
+            next[previous[corner]] = next[corner];
+            previous[next[corner]] = previous[corner];
+            corner = previous[corner];
+            remaining--;
+            misses = 0;
+        } else {
+            corner = next[corner];
+            misses++;
+        }
+    }
+    emit(previous[corner], corner, next[corner]);
+    return false;
+}
+
+void FloorTriangulation::build(const Level& level, platform::ThreadPool* pool) {
+    const BSPTree* tree = level.get_bsp_tree();
+    m_by_subsector = tree != nullptr;
+    size_t piece_count = m_by_subsector ? tree->get_subsectors().size() : level.get_sectors().size();
+
+    // A simple polygon of n vertices is always n - 2 triangles, so every
+    // piece's slot is known before triangulating
+    m_offsets.assign(piece_count + 1, 0);
+    for (size_t piece = 0; piece < piece_count; ++piece) {
+        uint32_t count = m_by_subsector ? tree->get_subsector(static_cast<uint32_t>(piece)).vertex_count
+                                        : level.get_sector(static_cast<uint32_t>(piece)).vertex_count;
+        m_offsets[piece + 1] = m_offsets[piece] + (count >= 3 ? (count - 2) * 3 : 0);
+    }
+    m_indices.resize(m_offsets[piece_count]);
+
+    std::atomic<uint32_t> concave(0);
+    platform::ThreadPool& workers = pool ? *pool : platform::ThreadPool::get_shared();
+    workers.parallel_for(piece_count, TRIANGULATE_GRAIN, [&](size_t begin, size_t end) {
+        std::vector<Vertex> outline;
+        uint32_t local_concave = 0;
+        for (size_t piece = begin; piece < end; ++piece) {
+            uint32_t count = get_outline(level, m_by_subsector, static_cast<uint32_t>(piece), outline);
+            if (count >= 3 && !triangulate(outline.data(), count, &m_indices[m_offsets[piece]])) {
+                local_concave++;
+            }
+        }
+        concave.fetch_add(local_concave, std::memory_order_relaxed);
+    });
+
+    m_concave_count = concave.load();
+    m_revision = level.get_revision();
+}
+
+} // namespace game
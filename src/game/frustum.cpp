@@ -0,0 +1,90 @@
+#include "game/frustum.h"
+#include "raymath.h"
+#include <cmath>
+
+namespace game {
+
+Frustum::Frustum()
+    : m_position{0.0f, 0.0f, 0.0f}
+    , m_forward{0.0f, 0.0f, 1.0f}
+    , m_plane_count(0) {
+}
+
+Frustum::Frustum(const Vector3& position, const Vector3& forward,
+                 float fov_y, float aspect, float near_distance, float far_distance)
+    : m_position(position)
+    , m_forward(Vector3Normalize(forward))
+    , m_plane_count(0) {
+
+    // Camera basis (fov is vertical, in degrees, as for Camera3D)
+    Vector3 world_up = {0.0f, 1.0f, 0.0f};
+    Vector3 right = Vector3Normalize(Vector3CrossProduct(m_forward, world_up));
+    Vector3 up = Vector3CrossProduct(right, m_forward);
+
+    float half_height = tanf(fov_y * DEG2RAD * 0.5f);
+    float half_width = half_height * aspect;
+
+    // Directions along the four frustum edges in the middle of each side
+    Vector3 left_edge = Vector3Subtract(m_forward, Vector3Scale(right, half_width));
+    Vector3 right_edge = Vector3Add(m_forward, Vector3Scale(right, half_width));
+    Vector3 bottom_edge = Vector3Subtract(m_forward, Vector3Scale(up, half_height));
+    Vector3 top_edge = Vector3Add(m_forward, Vector3Scale(up, half_height));
+
+    // Side planes pass through the eye; cross products give their normals
+    // and add_plane flips them to face inward
+    add_plane(Vector3CrossProduct(up, left_edge), position);
+    add_plane(Vector3CrossProduct(right_edge, up), position);
+    add_plane(Vector3CrossProduct(bottom_edge, right), position);
+    add_plane(Vector3CrossProduct(right, top_edge), position);
+
+    add_plane(m_forward, Vector3Add(position, Vector3Scale(m_forward, near_distance)));
+    if (far_distance > near_distance) {
+        add_plane(Vector3Negate(m_forward),
+                  Vector3Add(position, Vector3Scale(m_forward, far_distance)));
+    }
+}
+
+void Frustum::add_plane(const Vector3& normal, const Vector3& point) {
+    Vector3 n = Vector3Normalize(normal);
+
+    // Side planes must face the view direction; the near/far planes are
+    // built facing the right way already
+    if (Vector3DotProduct(n, m_forward) < 0.0f && m_plane_count < 4) {
+        n = Vector3Negate(n);
+    }
+
+    FrustumPlane& plane = m_planes[m_plane_count++];
+    plane.normal = n;
+    plane.distance = -Vector3DotProduct(n, point);
+}
+
+bool Frustum::intersects_box(const BoundingBox& box) const {
+    for (int i = 0; i < m_plane_count; ++i) {
+        const FrustumPlane& plane = m_planes[i];
+
+        // Corner furthest along the normal; if even that is behind the
+        // plane, the whole box is
+        Vector3 corner = {
+            plane.normal.x >= 0.0f ? box.max.x : box.min.x,
+            plane.normal.y >= 0.0f ? box.max.y : box.min.y,
+            plane.normal.z >= 0.0f ? box.max.z : box.min.z
+        };
+
+        if (Vector3DotProduct(plane.normal, corner) + plane.distance < 0.0f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Frustum::contains_point(const Vector3& point) const {
+    for (int i = 0; i < m_plane_count; ++i) {
+        const FrustumPlane& plane = m_planes[i];
+        if (Vector3DotProduct(plane.normal, point) + plane.distance < 0.0f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace game
@@ -1,10 +1,13 @@
 #include "game/game_state.h"
 #include "game/bsp.h"
+#include <algorithm>
+#include <cmath>
 
 namespace game {
 
 GameState::GameState()
-    : m_is_paused(false) {
+    : m_is_paused(false)
+    , m_has_shot_hit(false) {
 }
 
 void GameState::initialize(Level&& level) {
@@ -17,17 +20,128 @@ void GameState::initialize(Level&& level) {
     }
 }
 
+void GameState::initialize_streaming(std::unique_ptr<LevelStreamer> streamer,
+                                     const Vector3& position) {
+    m_streamer = std::move(streamer);
+    m_level = Level();
+
+    // Load around the start up front, as a level load would
+    m_streamer->update(position, 0.0f);
+    m_streamer->finish_loads();
+
+    m_camera.set_position(position);
+    const Level* chunk = m_streamer->get_chunk_at(position.x, position.z);
+    if (chunk && !chunk->get_spawns().empty()) {
+        m_camera.set_position(chunk->get_spawns()[0].position);
+    }
+}
+
 void GameState::update(float delta_time, const platform::InputState& input) {
+    // Tick boundary: pick up a level rebuilt in the background for edits,
+    // and chunks streamed in around the player
+    m_level.apply_bsp_rebuild();
+    if (m_streamer) {
+        m_streamer->update(m_camera.get_position(), delta_time);
+    }
+
     if (m_is_paused) {
         return;
     }
 
-    // Update camera
+    // Update camera, then hold its move against the level's walls
+    Vector3 previous_position = m_camera.get_position();
     m_camera.update(input, delta_time);
+    const Vector3& wanted_position = m_camera.get_position();
+    Vector3 move = {wanted_position.x - previous_position.x, 0.0f,
+                    wanted_position.z - previous_position.z};
+    if (m_streamer) {
+        m_camera.set_position(move_streamed(previous_position, move));
+    } else {
+        m_camera.set_position(m_collision.move(m_level, previous_position, move));
+    }
+
+    // Hitscan: trace the shot from the eye along the view direction
+    if (input.shoot) {
+        if (m_streamer) {
+            m_has_shot_hit = cast_streamed(m_camera.get_position(), m_camera.get_forward(), m_last_shot);
+        } else {
+            const BSPTree* bsp_tree = m_level.get_bsp_tree();
+            m_has_shot_hit = bsp_tree &&
+                bsp_tree->cast_ray(m_level, m_camera.get_position(), m_camera.get_forward(),
+                                   HITSCAN_RANGE, m_last_shot);
+        }
+    }
 
     // TODO: Update entities
-    // TODO: Handle collisions
     // TODO: Process game logic
 }
 
+Vector3 GameState::move_streamed(const Vector3& eye_position, const Vector3& delta) {
+    // Hold still while the chunk underfoot is still loading
+    if (!m_streamer->get_chunk_at(eye_position.x, eye_position.z)) {
+        return eye_position;
+    }
+
+    // Chunks the body can reach, and any just across their seams
+    float reach = sqrtf(delta.x * delta.x + delta.z * delta.z) +
+                  m_collision.get_config().radius + 1.0f;
+    m_nearby_chunks.clear();
+    m_streamer->get_chunks_in_box(eye_position.x - reach, eye_position.z - reach,
+                                  eye_position.x + reach, eye_position.z + reach, m_nearby_chunks);
+    core::Span<const ChunkLevel> chunks(m_nearby_chunks.data(), m_nearby_chunks.size());
+    return m_collision.move(chunks, eye_position, delta);
+}
+
+bool GameState::cast_streamed(const Vector3& origin, const Vector3& direction, RayHit& hit) {
+    // Each chunk is walled in, so a shot stops at the wall on its edge;
+    // where that is a seam, carry on from just across it in the next chunk
+    const float step = 0.01f;
+    Vector3 start = origin;
+    float travelled = 0.0f;
+    for (int crossing = 0; crossing < MAX_SEAM_CROSSINGS && travelled < HITSCAN_RANGE; ++crossing) {
+        const Level* chunk = m_streamer->get_chunk_at(start.x, start.z);
+        const BSPTree* bsp_tree = chunk ? chunk->get_bsp_tree() : nullptr;
+        if (!bsp_tree || !bsp_tree->cast_ray(*chunk, start, direction, HITSCAN_RANGE - travelled, hit)) {
+            return false;
+        }
+        hit.distance += travelled;
+
+        const Sector& sector = chunk->get_sector(hit.sector);
+        const LevelGeometry& geometry = chunk->get_geometry();
+        Wall wall = geometry.get_wall(sector, hit.wall);
+        Vertex a = geometry.get_vertex(sector, wall.vertex_a);
+        Vertex b = geometry.get_vertex(sector, wall.vertex_b);
+        m_nearby_chunks.clear();
+        m_streamer->get_chunks_in_box(hit.point.x - step, hit.point.z - step,
+                                      hit.point.x + step, hit.point.z + step, m_nearby_chunks);
+        size_t owner = 0;
+        while (owner < m_nearby_chunks.size() && m_nearby_chunks[owner].level != chunk) {
+            ++owner;
+        }
+        if (owner == m_nearby_chunks.size()) {
+            return true;
+        }
+        core::Span<const ChunkLevel> chunks(m_nearby_chunks.data(), m_nearby_chunks.size());
+        if (!find_sector_across(chunks, owner, a, b)) {
+            return true;
+        }
+
+        // Restart just across the seam, out along its normal rather than
+        // along the shot, so a shot skimming the seam still leaves the
+        // chunk instead of hitting the same wall again
+        const ChunkLevel& from = m_nearby_chunks[owner];
+        float normal_x = 0.0f;
+        float normal_z = 0.0f;
+        get_chunk_edge_normal(find_chunk_edge(from.min_x, from.min_z, from.max_x, from.max_z,
+                                              from.seams, a, b),
+                              normal_x, normal_z);
+        travelled = hit.distance;
+        start = {hit.point.x + normal_x * step, hit.point.y, hit.point.z + normal_z * step};
+        if (m_streamer->get_chunk_at(start.x, start.z) == chunk) {
+            return true;
+        }
+    }
+    return false;
+}
+
 } // namespace game
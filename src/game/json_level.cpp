@@ -0,0 +1,769 @@
+#include "game/json_level.h"
+#include "platform/mapped_file.h"
+#include "platform/thread_pool.h"
+#include <nlohmann/json.hpp>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <vector>
+
+using json = nlohmann::json;
+
+namespace game {
+
+namespace {
+
+constexpr size_t NOT_FOUND = static_cast<size_t>(-1);
+
+// Elements parsed per thread pool task
+constexpr size_t PARSE_GRAIN = 512;
+
+double elapsed_ms(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+void set_error(std::string* error, const std::string& message) {
+    if (error) {
+        *error = message;
+    }
+}
+
+// Byte range [begin, end) of the text
+struct TextRange {
+    size_t begin;
+    size_t end;
+};
+
+bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+size_t skip_space(const char* text, size_t size, size_t pos) {
+    while (pos < size && is_space(text[pos])) {
+        pos++;
+    }
+    return pos;
+}
+
+// Position just past the string whose opening quote is at pos
+size_t skip_string(const char* text, size_t size, size_t pos) {
+    for (pos++; pos < size; ++pos) {
+        if (text[pos] == '\\') {
+            pos++;
+        } else if (text[pos] == '"') {
+            return pos + 1;
+        }
+    }
+    return NOT_FOUND;
+}
+
+// Position just past the value starting at pos, matching brackets but not
+// checking what is between them (the SAX pass does that)
+size_t skip_value(const char* text, size_t size, size_t pos) {
+    if (pos >= size) {
+        return NOT_FOUND;
+    }
+    if (text[pos] == '"') {
+        return skip_string(text, size, pos);
+    }
+    if (text[pos] != '{' && text[pos] != '[') {
+        // Number or literal: runs up to the next delimiter
+        size_t end = pos;
+        while (end < size && !is_space(text[end]) && text[end] != ',' &&
+               text[end] != '}' && text[end] != ']') {
+            end++;
+        }
+        return end > pos ? end : NOT_FOUND;
+    }
+
+    std::string open_brackets;
+    while (pos < size) {
+        char c = text[pos];
+        if (c == '"') {
+            pos = skip_string(text, size, pos);
+            if (pos == NOT_FOUND) {
+                return NOT_FOUND;
+            }
+            continue;
+        }
+        if (c == '{' || c == '[') {
+            open_brackets.push_back(c);
+        } else if (c == '}' || c == ']') {
+            if (open_brackets.empty() || open_brackets.back() != (c == '}' ? '{' : '[')) {
+                return NOT_FOUND;
+            }
+            open_brackets.pop_back();
+            if (open_brackets.empty()) {
+                return pos + 1;
+            }
+        }
+        pos++;
+    }
+    return NOT_FOUND;
+}
+
+// Split the array whose opening bracket is at pos into its elements, and
+// return the position just past its closing bracket
+size_t split_array(const char* text, size_t size, size_t pos, std::vector<TextRange>& elements) {
+    elements.clear();
+    pos = skip_space(text, size, pos + 1);
+    if (pos < size && text[pos] == ']') {
+        return pos + 1;
+    }
+    while (pos < size) {
+        size_t element_end = skip_value(text, size, pos);
+        if (element_end == NOT_FOUND) {
+            return NOT_FOUND;
+        }
+        elements.push_back(TextRange{pos, element_end});
+
+        pos = skip_space(text, size, element_end);
+        if (pos < size && text[pos] == ']') {
+            return pos + 1;
+        }
+        if (pos >= size || text[pos] != ',') {
+            return NOT_FOUND;
+        }
+        pos = skip_space(text, size, pos + 1);   // A trailing comma fails on ']'
+    }
+    return NOT_FOUND;
+}
+
+enum class ElementKind { SECTOR, PORTAL, SPAWN };
+
+const char* element_name(const SectorDesc&) { return "sector"; }
+const char* element_name(const Portal&) { return "portal"; }
+const char* element_name(const EntitySpawn&) { return "spawn"; }
+
+// SAX handler for one element of the sectors, portals or spawns array,
+// filling in the matching struct as values arrive
+class ElementParser : public json::json_sax_t {
+public:
+    ElementParser()
+        : m_kind(ElementKind::SECTOR)
+        , m_sector(nullptr)
+        , m_portal(nullptr)
+        , m_spawn(nullptr)
+        , m_state(State::START)
+        , m_field(Field::UNKNOWN)
+        , m_skip_depth(0)
+        , m_coord_count(0)
+        , m_has_shape(0) {}
+
+    // Parse the element in [begin, end) into out
+    bool parse(const char* begin, const char* end, SectorDesc& out) {
+        m_kind = ElementKind::SECTOR;
+        m_sector = &out;
+        return run(begin, end);
+    }
+
+    bool parse(const char* begin, const char* end, Portal& out) {
+        m_kind = ElementKind::PORTAL;
+        m_portal = &out;
+        return run(begin, end);
+    }
+
+    bool parse(const char* begin, const char* end, EntitySpawn& out) {
+        m_kind = ElementKind::SPAWN;
+        m_spawn = &out;
+        return run(begin, end);
+    }
+
+    const std::string& get_error() const { return m_error; }
+
+    bool null() override { return scalar(); }
+    bool boolean(bool) override { return scalar(); }
+    bool number_integer(number_integer_t value) override { return number(static_cast<double>(value)); }
+    bool number_unsigned(number_unsigned_t value) override { return number(static_cast<double>(value)); }
+    bool number_float(number_float_t value, const string_t&) override { return number(value); }
+    bool string(string_t&) override { return scalar(); }
+    bool binary(binary_t&) override { return scalar(); }
+
+    bool start_object(std::size_t) override {
+        if (m_skip_depth > 0 || skip_unknown()) {
+            m_skip_depth++;
+            return true;
+        }
+        if (m_state == State::START) {
+            m_state = State::ELEMENT;
+            return true;
+        }
+        if (m_state == State::WALLS) {
+            m_wall = Wall();
+            m_state = State::WALL;
+            return true;
+        }
+        return fail("unexpected object");
+    }
+
+    bool key(string_t& name) override {
+        if (m_skip_depth > 0) {
+            return true;
+        }
+        m_field = find_field(name);
+        return true;
+    }
+
+    bool end_object() override {
+        if (m_skip_depth > 0) {
+            m_skip_depth--;
+            return true;
+        }
+        if (m_state == State::WALL) {
+            m_sector->walls.push_back(m_wall);
+            m_state = State::WALLS;
+            return true;
+        }
+
+        // Element complete; check what it can't do without
+        switch (m_kind) {
+        case ElementKind::SECTOR:
+            if (m_has_shape != (HAS_VERTICES | HAS_WALLS)) {
+                return fail("needs \"vertices\" and \"walls\"");
+            }
+            break;
+        case ElementKind::PORTAL:
+            if (!(m_has_shape & HAS_TARGET)) {
+                return fail("needs \"target_sector\"");
+            }
+            break;
+        case ElementKind::SPAWN:
+            if (!(m_has_shape & HAS_POSITION)) {
+                return fail("needs \"position\"");
+            }
+            break;
+        }
+        m_state = State::DONE;
+        return true;
+    }
+
+    bool start_array(std::size_t) override {
+        if (m_skip_depth > 0 || skip_unknown()) {
+            m_skip_depth++;
+            return true;
+        }
+        if (m_state == State::ELEMENT) {
+            if (m_field == Field::VERTICES) {
+                m_has_shape |= HAS_VERTICES;
+                m_state = State::VERTICES;
+                return true;
+            }
+            if (m_field == Field::WALLS) {
+                m_has_shape |= HAS_WALLS;
+                m_state = State::WALLS;
+                return true;
+            }
+            if (m_field == Field::POSITION) {
+                m_coord_count = 0;
+                m_state = State::POSITION;
+                return true;
+            }
+        }
+        if (m_state == State::VERTICES) {
+            m_coord_count = 0;
+            m_state = State::VERTEX;
+            return true;
+        }
+        return fail("unexpected array");
+    }
+
+    bool end_array() override {
+        if (m_skip_depth > 0) {
+            m_skip_depth--;
+            return true;
+        }
+        switch (m_state) {
+        case State::VERTICES:
+        case State::WALLS:
+            m_state = State::ELEMENT;
+            return true;
+        case State::VERTEX:
+            if (m_coord_count != 2) {
+                return fail("a vertex is [x, z]");
+            }
+            m_sector->vertices.push_back(Vertex(m_coords[0], m_coords[1]));
+            m_state = State::VERTICES;
+            return true;
+        case State::POSITION:
+            if (m_coord_count != 3) {
+                return fail("a position is [x, y, z]");
+            }
+            m_spawn->position = {m_coords[0], m_coords[1], m_coords[2]};
+            m_has_shape |= HAS_POSITION;
+            m_state = State::ELEMENT;
+            return true;
+        default:
+            return fail("unexpected end of array");
+        }
+    }
+
+    bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception& ex) override {
+        m_error = ex.what();
+        return false;
+    }
+
+private:
+    enum class State { START, ELEMENT, VERTICES, VERTEX, WALLS, WALL, POSITION, DONE };
+
+    enum class Field {
+        UNKNOWN,
+        FLOOR_HEIGHT, CEILING_HEIGHT, FLOOR_TEXTURE, CEILING_TEXTURE, LIGHT_LEVEL,
+        VERTICES, WALLS,
+        VERTEX_A, VERTEX_B, TEXTURE_ID, PORTAL_ID,
+        TARGET_SECTOR,
+        POSITION, ENTITY_TYPE, ROTATION
+    };
+
+    // Required members seen so far
+    enum : uint8_t {
+        HAS_VERTICES = 1,
+        HAS_WALLS = 2,
+        HAS_TARGET = 4,
+        HAS_POSITION = 8
+    };
+
+    ElementKind m_kind;
+    SectorDesc* m_sector;
+    Portal* m_portal;
+    EntitySpawn* m_spawn;
+
+    State m_state;
+    Field m_field;          // Member the next value belongs to
+    int m_skip_depth;       // Inside an unknown member's object or array
+    Wall m_wall;
+    float m_coords[3];
+    int m_coord_count;
+    uint8_t m_has_shape;
+    std::string m_error;
+
+    bool run(const char* begin, const char* end) {
+        m_state = State::START;
+        m_skip_depth = 0;
+        m_has_shape = 0;
+        m_error.clear();
+        return json::sax_parse(begin, end, this) && m_state == State::DONE;
+    }
+
+    Field find_field(const std::string& name) const {
+        if (m_state == State::WALL) {
+            if (name == "vertex_a") return Field::VERTEX_A;
+            if (name == "vertex_b") return Field::VERTEX_B;
+            if (name == "texture_id") return Field::TEXTURE_ID;
+            if (name == "portal_id") return Field::PORTAL_ID;
+            return Field::UNKNOWN;
+        }
+
+        switch (m_kind) {
+        case ElementKind::SECTOR:
+            if (name == "vertices") return Field::VERTICES;
+            if (name == "walls") return Field::WALLS;
+            if (name == "floor_height") return Field::FLOOR_HEIGHT;
+            if (name == "ceiling_height") return Field::CEILING_HEIGHT;
+            if (name == "floor_texture") return Field::FLOOR_TEXTURE;
+            if (name == "ceiling_texture") return Field::CEILING_TEXTURE;
+            if (name == "light_level") return Field::LIGHT_LEVEL;
+            break;
+        case ElementKind::PORTAL:
+            if (name == "target_sector") return Field::TARGET_SECTOR;
+            if (name == "floor_height") return Field::FLOOR_HEIGHT;
+            if (name == "ceiling_height") return Field::CEILING_HEIGHT;
+            break;
+        case ElementKind::SPAWN:
+            if (name == "position") return Field::POSITION;
+            if (name == "entity_type") return Field::ENTITY_TYPE;
+            if (name == "rotation") return Field::ROTATION;
+            break;
+        }
+        return Field::UNKNOWN;
+    }
+
+    // Objects and arrays under unknown members are skipped whole
+    bool skip_unknown() const {
+        return (m_state == State::ELEMENT || m_state == State::WALL) && m_field == Field::UNKNOWN;
+    }
+
+    bool fail(const char* message) {
+        m_error = message;
+        return false;
+    }
+
+    // Strings, booleans and nulls are only allowed under unknown members
+    bool scalar() {
+        if (m_skip_depth > 0 || skip_unknown()) {
+            return true;
+        }
+        return fail("expected a number");
+    }
+
+    bool number(double value) {
+        if (m_skip_depth > 0) {
+            return true;
+        }
+        if (m_state == State::VERTEX || m_state == State::POSITION) {
+            int limit = m_state == State::VERTEX ? 2 : 3;
+            if (m_coord_count >= limit) {
+                return fail(m_state == State::VERTEX ? "a vertex is [x, z]" : "a position is [x, y, z]");
+            }
+            m_coords[m_coord_count++] = static_cast<float>(value);
+            return true;
+        }
+        if (m_state != State::ELEMENT && m_state != State::WALL) {
+            return fail("unexpected number");
+        }
+
+        float real = static_cast<float>(value);
+        bool is_index = value >= 0.0 && value == std::floor(value) &&
+                        value <= static_cast<double>(std::numeric_limits<uint32_t>::max());
+        uint32_t index = is_index ? static_cast<uint32_t>(value) : 0;
+        switch (m_field) {
+        case Field::UNKNOWN: return true;
+        case Field::FLOOR_HEIGHT:
+            (m_kind == ElementKind::SECTOR ? m_sector->floor_height : m_portal->floor_height) = real;
+            return true;
+        case Field::CEILING_HEIGHT:
+            (m_kind == ElementKind::SECTOR ? m_sector->ceiling_height : m_portal->ceiling_height) = real;
+            return true;
+        case Field::LIGHT_LEVEL: m_sector->light_level = real; return true;
+        case Field::ROTATION: m_spawn->rotation = real; return true;
+        case Field::PORTAL_ID:
+            if (value != std::floor(value) || value < -1.0 ||
+                value > static_cast<double>(std::numeric_limits<int32_t>::max())) {
+                return fail("portal_id must be -1 or a portal index");
+            }
+            m_wall.portal_id = static_cast<int32_t>(value);
+            return true;
+        case Field::VERTICES:
+        case Field::WALLS:
+        case Field::POSITION:
+            return fail("expected an array");
+        default:
+            break;
+        }
+
+        if (!is_index) {
+            return fail("expected a non-negative integer");
+        }
+        switch (m_field) {
+        case Field::FLOOR_TEXTURE: m_sector->floor_texture = index; break;
+        case Field::CEILING_TEXTURE: m_sector->ceiling_texture = index; break;
+        case Field::VERTEX_A: m_wall.vertex_a = index; break;
+        case Field::VERTEX_B: m_wall.vertex_b = index; break;
+        case Field::TEXTURE_ID: m_wall.texture_id = index; break;
+        case Field::ENTITY_TYPE: m_spawn->entity_type = index; break;
+        case Field::TARGET_SECTOR:
+            m_portal->target_sector = index;
+            m_has_shape |= HAS_TARGET;
+            break;
+        default: break;
+        }
+        return true;
+    }
+};
+
+// Parse every element of one array in parallel batches. On failure error
+// describes the first bad element.
+template <typename T>
+bool parse_elements(const char* text, const std::vector<TextRange>& ranges,
+                    std::vector<T>& out, std::string& error, uint32_t& chunk_count) {
+    out.resize(ranges.size());
+    std::mutex error_mutex;
+    size_t error_index = ranges.size();
+
+    platform::ThreadPool::get_shared().parallel_for(ranges.size(), PARSE_GRAIN,
+        [&](size_t begin, size_t end) {
+            ElementParser parser;
+            for (size_t i = begin; i < end; ++i) {
+                if (!parser.parse(text + ranges[i].begin, text + ranges[i].end, out[i])) {
+                    std::lock_guard<std::mutex> lock(error_mutex);
+                    if (i < error_index) {
+                        error_index = i;
+                        error = std::string(element_name(out[i])) + " " + std::to_string(i) +
+                                ": " + parser.get_error();
+                    }
+                    return;
+                }
+            }
+        });
+
+    chunk_count += static_cast<uint32_t>((ranges.size() + PARSE_GRAIN - 1) / PARSE_GRAIN);
+    return error_index == ranges.size();
+}
+
+// Enough digits to read back the same float
+void append_number(std::string& out, float value) {
+    char buffer[32];
+    int length = snprintf(buffer, sizeof(buffer), "%.9g", value);
+    out.append(buffer, static_cast<size_t>(length));
+}
+
+void append_number(std::string& out, int64_t value) {
+    out += std::to_string(value);
+}
+
+} // namespace
+
+bool JsonLevel::load(const std::string& path, Level& level, std::string* error,
+                     JsonLevelStats* stats) {
+    platform::MappedFile file;
+    if (!file.open(path)) {
+        set_error(error, "cannot map file");
+        return false;
+    }
+    return parse(reinterpret_cast<const char*>(file.get_data()), file.get_size(), level, error, stats);
+}
+
+bool JsonLevel::parse(const char* text, size_t size, Level& level, std::string* error,
+                      JsonLevelStats* stats) {
+    auto start_time = std::chrono::steady_clock::now();
+    JsonLevelStats load_stats;
+    load_stats.file_bytes = size;
+
+    // Top level: an object whose arrays are split into elements for the
+    // parallel pass
+    TextRange version{0, 0};
+    const char* array_names[3] = {"sectors", "portals", "spawns"};
+    std::vector<TextRange> elements[3];
+    bool found[3] = {false, false, false};
+
+    size_t pos = skip_space(text, size, 0);
+    if (pos >= size || text[pos] != '{') {
+        set_error(error, "level file must be a JSON object");
+        return false;
+    }
+    pos = skip_space(text, size, pos + 1);
+    bool closed = pos < size && text[pos] == '}';
+    while (!closed) {
+        size_t key_end = pos < size && text[pos] == '"' ? skip_string(text, size, pos) : NOT_FOUND;
+        if (key_end == NOT_FOUND) {
+            set_error(error, "malformed JSON: expected a key");
+            return false;
+        }
+        std::string key(text + pos + 1, key_end - pos - 2);
+
+        pos = skip_space(text, size, key_end);
+        if (pos >= size || text[pos] != ':') {
+            set_error(error, "malformed JSON: expected ':' after \"" + key + "\"");
+            return false;
+        }
+        pos = skip_space(text, size, pos + 1);
+
+        // The element arrays are split while skipping them
+        int array = -1;
+        for (int i = 0; i < 3; ++i) {
+            if (key == array_names[i]) {
+                array = i;
+            }
+        }
+        if (array >= 0 && (pos >= size || text[pos] != '[')) {
+            set_error(error, "\"" + key + "\" must be an array");
+            return false;
+        }
+        size_t value_end = array >= 0 ? split_array(text, size, pos, elements[array])
+                                      : skip_value(text, size, pos);
+        if (value_end == NOT_FOUND) {
+            set_error(error, "malformed JSON in \"" + key + "\"");
+            return false;
+        }
+
+        if (key == "version") {
+            version = TextRange{pos, value_end};
+        }
+        if (array >= 0) {
+            found[array] = true;
+        }
+
+        pos = skip_space(text, size, value_end);
+        if (pos < size && text[pos] == ',') {
+            pos = skip_space(text, size, pos + 1);
+        } else if (pos < size && text[pos] == '}') {
+            closed = true;
+        } else {
+            set_error(error, "malformed JSON: expected ',' or '}'");
+            return false;
+        }
+    }
+    if (skip_space(text, size, pos + 1) != size) {
+        set_error(error, "malformed JSON: text after the level object");
+        return false;
+    }
+
+    if (version.end > version.begin) {
+        std::string value(text + version.begin, version.end - version.begin);
+        char* end = nullptr;
+        unsigned long number = strtoul(value.c_str(), &end, 10);
+        if (*end != '\0' || number != VERSION) {
+            set_error(error, "unsupported level version " + value);
+            return false;
+        }
+    }
+    if (!found[0]) {
+        set_error(error, "level has no \"sectors\"");
+        return false;
+    }
+    load_stats.scan_ms = elapsed_ms(start_time);
+
+    // Elements straight into sector descriptions, portals and spawns
+    auto parse_start = std::chrono::steady_clock::now();
+    std::vector<SectorDesc> sectors;
+    std::vector<Portal> portals;
+    std::vector<EntitySpawn> spawns;
+    std::string message;
+    if (!parse_elements(text, elements[0], sectors, message, load_stats.chunk_count) ||
+        !parse_elements(text, elements[1], portals, message, load_stats.chunk_count) ||
+        !parse_elements(text, elements[2], spawns, message, load_stats.chunk_count)) {
+        set_error(error, message);
+        return false;
+    }
+    load_stats.parse_ms = elapsed_ms(parse_start);
+
+    // Cross references, so a loaded level never indexes out of range
+    size_t wall_total = 0;
+    for (size_t i = 0; i < sectors.size(); ++i) {
+        const SectorDesc& sector = sectors[i];
+        for (const Wall& wall : sector.walls) {
+            if (wall.vertex_a >= sector.vertices.size() || wall.vertex_b >= sector.vertices.size()) {
+                set_error(error, "sector " + std::to_string(i) + ": wall vertex out of range");
+                return false;
+            }
+            if (wall.portal_id >= 0 && static_cast<size_t>(wall.portal_id) >= portals.size()) {
+                set_error(error, "sector " + std::to_string(i) + ": wall portal out of range");
+                return false;
+            }
+        }
+        wall_total += sector.walls.size();
+    }
+    for (size_t i = 0; i < portals.size(); ++i) {
+        if (portals[i].target_sector >= sectors.size()) {
+            set_error(error, "portal " + std::to_string(i) + ": target sector out of range");
+            return false;
+        }
+    }
+
+    auto build_start = std::chrono::steady_clock::now();
+    Level loaded;
+    loaded.reserve(sectors.size(), portals.size(), wall_total);
+    for (const SectorDesc& sector : sectors) {
+        loaded.add_sector(sector);
+    }
+    for (const Portal& portal : portals) {
+        loaded.add_portal(portal);
+    }
+    for (const EntitySpawn& spawn : spawns) {
+        loaded.add_entity_spawn(spawn);
+    }
+    level = std::move(loaded);
+    load_stats.build_ms = elapsed_ms(build_start);
+
+    load_stats.sector_count = static_cast<uint32_t>(sectors.size());
+    load_stats.total_ms = elapsed_ms(start_time);
+    if (stats) {
+        *stats = load_stats;
+    }
+    return true;
+}
+
+bool JsonLevel::write(const Level& level, const std::string& path, std::string* error) {
+    const auto& sectors = level.get_sectors();
+    const LevelGeometry& geometry = level.get_geometry();
+    const auto& portals = level.get_portals();
+    const auto& spawns = level.get_spawns();
+
+    // One sector, portal or spawn per line; wall members left at their
+    // defaults are not written
+    std::string out;
+    out += "{\n  \"version\": ";
+    append_number(out, static_cast<int64_t>(VERSION));
+    out += ",\n  \"sectors\": [";
+    for (size_t i = 0; i < sectors.size(); ++i) {
+        const Sector& sector = sectors[i];
+        out += i == 0 ? "\n    " : ",\n    ";
+        out += "{\"floor_height\": ";
+        append_number(out, sector.floor_height);
+        out += ", \"ceiling_height\": ";
+        append_number(out, sector.ceiling_height);
+        out += ", \"floor_texture\": ";
+        append_number(out, static_cast<int64_t>(sector.floor_texture));
+        out += ", \"ceiling_texture\": ";
+        append_number(out, static_cast<int64_t>(sector.ceiling_texture));
+        out += ", \"light_level\": ";
+        append_number(out, sector.light_level);
+
+        out += ", \"vertices\": [";
+        for (uint32_t v = 0; v < sector.vertex_count; ++v) {
+            Vertex vertex = geometry.get_vertex(sector, v);
+            out += v == 0 ? "[" : ", [";
+            append_number(out, vertex.x);
+            out += ", ";
+            append_number(out, vertex.z);
+            out += "]";
+        }
+
+        out += "], \"walls\": [";
+        for (uint32_t w = 0; w < sector.wall_count; ++w) {
+            Wall wall = geometry.get_wall(sector, w);
+            out += w == 0 ? "{\"vertex_a\": " : ", {\"vertex_a\": ";
+            append_number(out, static_cast<int64_t>(wall.vertex_a));
+            out += ", \"vertex_b\": ";
+            append_number(out, static_cast<int64_t>(wall.vertex_b));
+            if (wall.texture_id != 0) {
+                out += ", \"texture_id\": ";
+                append_number(out, static_cast<int64_t>(wall.texture_id));
+            }
+            if (wall.portal_id >= 0) {
+                out += ", \"portal_id\": ";
+                append_number(out, static_cast<int64_t>(wall.portal_id));
+            }
+            out += "}";
+        }
+        out += "]}";
+    }
+
+    out += "\n  ],\n  \"portals\": [";
+    for (size_t i = 0; i < portals.size(); ++i) {
+        out += i == 0 ? "\n    " : ",\n    ";
+        out += "{\"target_sector\": ";
+        append_number(out, static_cast<int64_t>(portals[i].target_sector));
+        out += ", \"floor_height\": ";
+        append_number(out, portals[i].floor_height);
+        out += ", \"ceiling_height\": ";
+        append_number(out, portals[i].ceiling_height);
+        out += "}";
+    }
+
+    out += "\n  ],\n  \"spawns\": [";
+    for (size_t i = 0; i < spawns.size(); ++i) {
+        const EntitySpawn& spawn = spawns[i];
+        out += i == 0 ? "\n    " : ",\n    ";
+        out += "{\"position\": [";
+        append_number(out, spawn.position.x);
+        out += ", ";
+        append_number(out, spawn.position.y);
+        out += ", ";
+        append_number(out, spawn.position.z);
+        out += "], \"entity_type\": ";
+        append_number(out, static_cast<int64_t>(spawn.entity_type));
+        out += ", \"rotation\": ";
+        append_number(out, spawn.rotation);
+        out += "}";
+    }
+    out += "\n  ]\n}\n";
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        set_error(error, "cannot open file for writing");
+        return false;
+    }
+    file.write(out.data(), static_cast<std::streamsize>(out.size()));
+    if (!file) {
+        set_error(error, "write failed");
+        return false;
+    }
+    return true;
+}
+
+} // namespace game
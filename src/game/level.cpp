@@ -1,18 +1,251 @@
 #include "game/level.h"
 #include "game/bsp.h"
+#include "game/pvs.h"
+#include "game/spatial_grid.h"
+#include "platform/thread_pool.h"
+#include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
 
 namespace game {
 
+namespace {
+
+// Append a sector's outline and walls to the pools; pool_vertex(v) gives
+// the pool index to use for outline vertex v
+template <typename PoolVertex>
+Sector append_sector(LevelGeometry& geometry, const SectorDesc& desc, PoolVertex pool_vertex) {
+    Sector sector;
+    sector.first_vertex = static_cast<uint32_t>(geometry.vertex_indices.size());
+    sector.vertex_count = static_cast<uint32_t>(desc.vertices.size());
+    sector.first_wall = static_cast<uint32_t>(geometry.wall_vertex_a.size());
+    sector.wall_count = static_cast<uint32_t>(desc.walls.size());
+    sector.floor_height = desc.floor_height;
+    sector.ceiling_height = desc.ceiling_height;
+    sector.floor_texture = desc.floor_texture;
+    sector.ceiling_texture = desc.ceiling_texture;
+    sector.light_level = desc.light_level;
+
+    for (const Vertex& vertex : desc.vertices) {
+        geometry.vertex_indices.push_back(pool_vertex(vertex));
+    }
+    for (const Wall& wall : desc.walls) {
+        geometry.wall_vertex_a.push_back(wall.vertex_a);
+        geometry.wall_vertex_b.push_back(wall.vertex_b);
+        geometry.wall_texture.push_back(wall.texture_id);
+        geometry.wall_portal.push_back(wall.portal_id);
+    }
+    return sector;
+}
+
+// New pool vertex, not shared with any other
+uint32_t push_vertex(LevelGeometry& geometry, const Vertex& vertex) {
+    geometry.vertex_x.push_back(vertex.x);
+    geometry.vertex_z.push_back(vertex.z);
+    return static_cast<uint32_t>(geometry.vertex_x.size() - 1);
+}
+
+// Append a sector's walls to another set of pools
+void copy_walls(const LevelGeometry& from, const Sector& sector, LevelGeometry& to) {
+    uint32_t first = sector.first_wall;
+    uint32_t end = sector.first_wall + sector.wall_count;
+    to.wall_vertex_a.insert(to.wall_vertex_a.end(), from.wall_vertex_a.begin() + first,
+                            from.wall_vertex_a.begin() + end);
+    to.wall_vertex_b.insert(to.wall_vertex_b.end(), from.wall_vertex_b.begin() + first,
+                            from.wall_vertex_b.begin() + end);
+    to.wall_texture.insert(to.wall_texture.end(), from.wall_texture.begin() + first,
+                           from.wall_texture.begin() + end);
+    to.wall_portal.insert(to.wall_portal.end(), from.wall_portal.begin() + first,
+                          from.wall_portal.begin() + end);
+}
+
+// Copy a sector's outline and walls to the end of another set of pools,
+// with a pool vertex per corner
+Sector copy_sector(const LevelGeometry& from, const Sector& sector, LevelGeometry& to) {
+    Sector copy = sector;
+    copy.first_vertex = static_cast<uint32_t>(to.vertex_indices.size());
+    copy.first_wall = static_cast<uint32_t>(to.wall_vertex_a.size());
+    for (uint32_t i = 0; i < sector.vertex_count; ++i) {
+        to.vertex_indices.push_back(push_vertex(to, from.get_vertex(sector, i)));
+    }
+    copy_walls(from, sector, to);
+    return copy;
+}
+
+uint64_t vertex_key(float x, float z) {
+    // Adding zero turns -0 into +0 so both weld together
+    x += 0.0f;
+    z += 0.0f;
+    uint32_t x_bits;
+    uint32_t z_bits;
+    memcpy(&x_bits, &x, sizeof(x_bits));
+    memcpy(&z_bits, &z, sizeof(z_bits));
+    return (static_cast<uint64_t>(x_bits) << 32) | z_bits;
+}
+
+// Source of Level revisions, shared by all levels
+std::atomic<uint64_t> g_next_revision(1);
+
+// Changed sectors kept for get_sectors_changed_since() before the history
+// is dropped; past this, patching a cache costs about as much as a rebuild
+constexpr size_t MAX_CHANGE_HISTORY = 1u << 16;
+
+size_t vertex_hash(uint64_t key) {
+    key ^= key >> 31;
+    key *= 0x9E3779B97F4A7C15ull;
+    return static_cast<size_t>(key ^ (key >> 29));
+}
+
+} // namespace
+
+// Work run on the thread pool. It owns everything it reads, so the level
+// may change, move or be destroyed meanwhile; the level polls done and
+// takes the result on its own thread.
+struct BackgroundJob {
+    std::atomic<bool> done;
+    std::mutex mutex;
+    std::condition_variable finished;
+
+    BackgroundJob() : done(false) {}
+
+    void finish() {
+        std::lock_guard<std::mutex> lock(mutex);
+        done.store(true, std::memory_order_release);
+        finished.notify_all();
+    }
+
+    void wait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [this]() { return done.load(std::memory_order_acquire); });
+    }
+};
+
+// Background BSP rebuild for a batch of sector edits
+struct BSPRebuildJob : BackgroundJob {
+    std::shared_ptr<const BSPTree> base;            // Tree the edits are applied to
+    std::vector<std::pair<uint32_t, SectorDesc>> edits;
+    BSPRebuildInput input;                          // Edited sectors and their neighbours
+    std::shared_ptr<BSPTree> result;
+};
+
+// Background PVS build for a tree swapped in by a rebuild
+struct PVSRebuildJob : BackgroundJob {
+    std::shared_ptr<const BSPTree> tree;
+    PVSPortals portals;
+    std::unique_ptr<PotentiallyVisibleSet> result;
+};
+
 Level::Level()
-    : m_bsp_tree(nullptr) {
+    : m_bsp_tree(nullptr)
+    , m_pvs(nullptr)
+    , m_spatial_grid(nullptr)
+    , m_bsp_sector_count(0)
+    , m_revision(g_next_revision.fetch_add(1, std::memory_order_relaxed))
+    , m_pvs_wanted(false)
+    , m_dead_geometry(0)
+    , m_change_base_revision(m_revision)
+    , m_weld_count(0) {
 }
 
 Level::~Level() = default;
 
-uint32_t Level::add_sector(const Sector& sector) {
-    m_sectors.push_back(sector);
-    return static_cast<uint32_t>(m_sectors.size() - 1);
+Level::Level(Level&&) = default;
+Level& Level::operator=(Level&&) = default;
+
+uint32_t Level::add_sector(const SectorDesc& sector) {
+    m_sectors.push_back(append_sector(m_geometry, sector,
+        [this](const Vertex& vertex) { return weld_vertex(vertex); }));
+    uint32_t index = static_cast<uint32_t>(m_sectors.size() - 1);
+    if (m_spatial_grid) {
+        m_spatial_grid->update_sector(*this, index);
+    }
+    bump_revision();
+    return index;
+}
+
+void Level::set_sectors(std::vector<Sector>&& sectors, LevelGeometry&& geometry) {
+    m_sectors = std::move(sectors);
+    m_geometry = std::move(geometry);
+    m_spatial_grid.reset();
+    m_dead_geometry = 0;
+    bump_revision();
+
+    // The table indexes the old pool
+    std::vector<WeldSlot>().swap(m_weld_table);
+    m_weld_count = 0;
+}
+
+uint32_t Level::weld_vertex(const Vertex& vertex) {
+    // Keep the table at most half full
+    if ((m_weld_count + 1) * 2 > m_weld_table.size()) {
+        std::vector<WeldSlot> old_table;
+        old_table.swap(m_weld_table);
+        m_weld_table.assign(std::max<size_t>(old_table.size() * 2, 1024), WeldSlot{0, 0});
+        size_t mask = m_weld_table.size() - 1;
+        for (const WeldSlot& entry : old_table) {
+            if (entry.index == 0) {
+                continue;
+            }
+            size_t slot = vertex_hash(entry.key) & mask;
+            while (m_weld_table[slot].index != 0) {
+                slot = (slot + 1) & mask;
+            }
+            m_weld_table[slot] = entry;
+        }
+    }
+
+    // The key is kept in the slot, so a probe touches only the table
+    uint64_t key = vertex_key(vertex.x, vertex.z);
+    size_t mask = m_weld_table.size() - 1;
+    size_t slot = vertex_hash(key) & mask;
+    while (m_weld_table[slot].index != 0) {
+        if (m_weld_table[slot].key == key) {
+            return m_weld_table[slot].index - 1;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    uint32_t index = push_vertex(m_geometry, vertex);
+    m_weld_table[slot] = WeldSlot{key, index + 1};
+    m_weld_count++;
+    return index;
+}
+
+void Level::bump_revision() {
+    m_revision = g_next_revision.fetch_add(1, std::memory_order_relaxed);
+    m_change_base_revision = m_revision;
+    m_changes.clear();
+    m_changed_sectors.clear();
+}
+
+void Level::bump_revision(const std::vector<uint32_t>& changed_sectors) {
+    if (m_changed_sectors.size() + changed_sectors.size() > MAX_CHANGE_HISTORY) {
+        bump_revision();
+        return;
+    }
+    m_revision = g_next_revision.fetch_add(1, std::memory_order_relaxed);
+    m_changes.push_back(ChangeEntry{m_revision, static_cast<uint32_t>(m_changed_sectors.size())});
+    m_changed_sectors.insert(m_changed_sectors.end(), changed_sectors.begin(), changed_sectors.end());
+}
+
+bool Level::get_sectors_changed_since(uint64_t revision, std::vector<uint32_t>& sectors) const {
+    sectors.clear();
+    size_t first = 0;
+    if (revision != m_change_base_revision) {
+        auto it = std::find_if(m_changes.begin(), m_changes.end(),
+                               [revision](const ChangeEntry& entry) { return entry.revision == revision; });
+        if (it == m_changes.end()) {
+            return false;
+        }
+        first = ++it == m_changes.end() ? m_changed_sectors.size() : it->first_sector;
+    }
+    sectors.assign(m_changed_sectors.begin() + first, m_changed_sectors.end());
+    std::sort(sectors.begin(), sectors.end());
+    sectors.erase(std::unique(sectors.begin(), sectors.end()), sectors.end());
+    return true;
 }
 
 uint32_t Level::add_portal(const Portal& portal) {
@@ -25,12 +258,385 @@ void Level::add_entity_spawn(const EntitySpawn& spawn) {
 }
 
 void Level::build_bsp() {
-    m_bsp_tree = std::make_unique<BSPTree>();
+    m_bsp_tree = std::make_shared<BSPTree>();
     m_bsp_tree->build_from_level(*this);
+    m_bsp_sector_count = m_sectors.size();
+
+    // Leaf numbering changed; any old PVS no longer applies
+    m_pvs.reset();
+    m_pvs_job.reset();
+    m_pvs_wanted = false;
+    build_spatial_grid();
+    bump_revision();
+
+    // Building is done; later sectors weld only among themselves
+    std::vector<WeldSlot>().swap(m_weld_table);
+    m_weld_count = 0;
+}
+
+void Level::build_pvs() {
+    if (!m_bsp_tree) {
+        return;
+    }
+    m_pvs = std::make_unique<PotentiallyVisibleSet>();
+    m_pvs->build(*this, *m_bsp_tree);
+    m_pvs_job.reset();
+    m_pvs_wanted = true;
+}
+
+void Level::build_spatial_grid() {
+    m_spatial_grid = std::make_unique<SpatialGrid>();
+    m_spatial_grid->build(*this);
+}
+
+void Level::set_precomputed(std::unique_ptr<BSPTree> bsp_tree,
+                            std::unique_ptr<PotentiallyVisibleSet> pvs) {
+    m_bsp_tree = std::move(bsp_tree);
+    m_pvs = std::move(pvs);
+    m_pvs_job.reset();
+    m_pvs_wanted = m_pvs != nullptr;
+    m_bsp_sector_count = m_bsp_tree ? m_sectors.size() : 0;
+    build_spatial_grid();
+    bump_revision();
+
+    std::vector<WeldSlot>().swap(m_weld_table);
+    m_weld_count = 0;
+}
+
+void Level::update_sector(uint32_t index, const SectorDesc& sector) {
+    if (index >= m_sectors.size()) {
+        return;
+    }
+
+    // Nothing to keep in sync without a tree
+    if (!m_bsp_tree) {
+        replace_sector(index, sector);
+        if (m_spatial_grid) {
+            m_spatial_grid->update_sector(*this, index);
+        }
+        bump_revision(std::vector<uint32_t>(1, index));
+        if (m_dead_geometry * 2 > m_geometry.vertex_indices.size() + m_geometry.wall_vertex_a.size()) {
+            compact_geometry();
+        }
+        return;
+    }
+
+    // A later edit of the same sector replaces the queued one
+    bool queued = false;
+    for (auto& edit : m_pending_edits) {
+        if (edit.first == index) {
+            edit.second = sector;
+            queued = true;
+            break;
+        }
+    }
+    if (!queued) {
+        m_pending_edits.emplace_back(index, sector);
+    }
+
+    if (!m_rebuild_job) {
+        start_bsp_rebuild();
+    }
+}
+
+void Level::replace_sector(uint32_t index, const SectorDesc& sector) {
+    // The new shape goes at the end of the pools; the old ranges are left
+    // for compact_geometry()
+    m_dead_geometry += m_sectors[index].vertex_count + m_sectors[index].wall_count;
+    m_sectors[index] = append_sector(m_geometry, sector,
+        [this](const Vertex& vertex) { return push_vertex(m_geometry, vertex); });
+}
+
+void Level::start_bsp_rebuild() {
+    if (m_pending_edits.empty() || !m_bsp_tree) {
+        return;
+    }
+
+    auto job = std::make_shared<BSPRebuildJob>();
+    job->base = m_bsp_tree;
+    job->edits.swap(m_pending_edits);
+    std::sort(job->edits.begin(), job->edits.end(),
+              [](const std::pair<uint32_t, SectorDesc>& a, const std::pair<uint32_t, SectorDesc>& b) {
+                  return a.first < b.first;
+              });
+
+    // The rebuild re-cuts only the leaves the edited sectors reach, old
+    // shape or new, so it needs just those sectors and the others sharing
+    // those leaves. A tree that was never built needs every sector.
+    BSPRebuildInput& input = job->input;
+    input.sector_count = static_cast<uint32_t>(m_sectors.size());
+    std::vector<uint32_t>& indices = input.indices;
+    if (!m_bsp_tree->is_built()) {
+        for (uint32_t i = 0; i < input.sector_count; ++i) {
+            indices.push_back(i);
+        }
+    }
+    for (const auto& edit : job->edits) {
+        const Sector& old_sector = m_sectors[edit.first];
+        float min_x = INFINITY;
+        float min_z = INFINITY;
+        float max_x = -INFINITY;
+        float max_z = -INFINITY;
+        auto grow = [&](const Vertex& vertex) {
+            min_x = std::min(min_x, vertex.x);
+            min_z = std::min(min_z, vertex.z);
+            max_x = std::max(max_x, vertex.x);
+            max_z = std::max(max_z, vertex.z);
+        };
+        for (uint32_t i = 0; i < old_sector.vertex_count; ++i) {
+            grow(m_geometry.get_vertex(old_sector, i));
+        }
+        for (const Vertex& vertex : edit.second.vertices) {
+            grow(vertex);
+        }
+        if (min_x <= max_x) {
+            m_bsp_tree->for_each_sector_reached(min_x, min_z, max_x, max_z,
+                [&indices](uint32_t sector) { indices.push_back(sector); });
+        }
+
+        indices.push_back(edit.first);
+        input.changed.push_back(edit.first);
+        input.area_sector_change += (edit.second.vertices.size() >= 3 ? 1 : 0) -
+                                    (old_sector.vertex_count >= 3 ? 1 : 0);
+    }
+    std::sort(indices.begin(), indices.end());
+    indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+
+    // Edited sectors take their new shape, the rest are copied as they are
+    input.sectors.reserve(indices.size());
+    LevelGeometry& geometry = input.geometry;
+    auto edit = job->edits.begin();
+    for (uint32_t index : indices) {
+        while (edit != job->edits.end() && edit->first < index) {
+            ++edit;
+        }
+        if (edit != job->edits.end() && edit->first == index) {
+            input.sectors.push_back(append_sector(geometry, edit->second,
+                [&geometry](const Vertex& vertex) { return push_vertex(geometry, vertex); }));
+        } else if (index < m_sectors.size()) {
+            input.sectors.push_back(copy_sector(m_geometry, m_sectors[index], geometry));
+        } else {
+            input.sectors.emplace_back();   // Tree refers to a sector no longer there
+        }
+    }
+    m_rebuild_job = job;
+
+    platform::ThreadPool::get_shared().submit([job]() {
+        auto tree = std::make_shared<BSPTree>();
+        tree->rebuild_from(*job->base, job->input);
+        job->result = tree;
+        job->finish();
+    });
+}
+
+bool Level::apply_bsp_rebuild() {
+    apply_pvs_rebuild();
+    if (!m_rebuild_job || !m_rebuild_job->done.load(std::memory_order_acquire)) {
+        return false;
+    }
+
+    std::shared_ptr<BSPRebuildJob> job = std::move(m_rebuild_job);
+
+    // The tree was replaced or sectors were added meanwhile; redo the
+    // edits against the current level (newer queued edits still win)
+    if (job->base != m_bsp_tree || job->input.sector_count != m_sectors.size()) {
+        for (auto& edit : job->edits) {
+            bool superseded = false;
+            for (const auto& pending : m_pending_edits) {
+                superseded |= pending.first == edit.first;
+            }
+            if (!superseded) {
+                m_pending_edits.push_back(std::move(edit));
+            }
+        }
+        start_bsp_rebuild();
+        return false;
+    }
+
+    // Sectors and tree change together
+    for (const auto& edit : job->edits) {
+        replace_sector(edit.first, edit.second);
+    }
+    m_bsp_tree = job->result;
+    m_pvs.reset();
+    if (m_spatial_grid) {
+        for (const auto& edit : job->edits) {
+            m_spatial_grid->update_sector(*this, edit.first);
+        }
+    }
+
+    // The edited sectors and every sector re-cut with them have new
+    // sub-sectors; the rest were copied over unchanged
+    bump_revision(job->input.indices);
+    if (m_dead_geometry * 2 > m_geometry.vertex_indices.size() + m_geometry.wall_vertex_a.size()) {
+        compact_geometry();
+    }
+
+    start_bsp_rebuild();
+    start_pvs_rebuild();
+    return true;
+}
+
+void Level::start_pvs_rebuild() {
+    // Wait for the edits to settle; a PVS for a tree about to be replaced
+    // would be thrown away
+    if (!m_pvs_wanted || m_pvs || m_pvs_job || m_rebuild_job || !m_pending_edits.empty() ||
+        !m_bsp_tree || !m_bsp_tree->is_built()) {
+        return;
+    }
+
+    auto job = std::make_shared<PVSRebuildJob>();
+    job->tree = m_bsp_tree;
+    PotentiallyVisibleSet::gather_portals(*this, job->portals);
+    m_pvs_job = job;
+
+    platform::ThreadPool::get_shared().submit([job]() {
+        auto pvs = std::make_unique<PotentiallyVisibleSet>();
+        pvs->build(job->portals, *job->tree);
+        job->result = std::move(pvs);
+        job->finish();
+    });
+}
+
+bool Level::apply_pvs_rebuild() {
+    if (!m_pvs_job || !m_pvs_job->done.load(std::memory_order_acquire)) {
+        return false;
+    }
+
+    std::shared_ptr<PVSRebuildJob> job = std::move(m_pvs_job);
+    if (job->tree != m_bsp_tree || job->portals.sector_count != m_sectors.size()) {
+        start_pvs_rebuild();
+        return false;
+    }
+    m_pvs = std::move(job->result);
+    return true;
+}
+
+void Level::finish_bsp_rebuild() {
+    while (m_rebuild_job || m_pvs_job) {
+        if (m_rebuild_job) {
+            m_rebuild_job->wait();
+        } else {
+            m_pvs_job->wait();
+        }
+        apply_bsp_rebuild();
+    }
+}
+
+bool Level::has_pending_edits() const {
+    return m_rebuild_job || !m_pending_edits.empty();
+}
+
+bool Level::has_pending_pvs() const {
+    return m_pvs_wanted && !m_pvs;
+}
+
+void Level::compact_geometry() {
+    // Copy the live ranges in sector order; pool vertices keep being shared
+    // by the sectors that shared them
+    LevelGeometry compact;
+    size_t live = m_geometry.vertex_indices.size() + m_geometry.wall_vertex_a.size() - m_dead_geometry;
+    compact.vertex_indices.reserve(live / 2);
+    compact.wall_vertex_a.reserve(live / 2);
+    compact.wall_vertex_b.reserve(live / 2);
+    compact.wall_texture.reserve(live / 2);
+    compact.wall_portal.reserve(live / 2);
+
+    const uint32_t unmapped = 0xFFFFFFFFu;
+    std::vector<uint32_t> remap(m_geometry.vertex_x.size(), unmapped);
+    for (Sector& sector : m_sectors) {
+        uint32_t first_vertex = static_cast<uint32_t>(compact.vertex_indices.size());
+        for (uint32_t i = 0; i < sector.vertex_count; ++i) {
+            uint32_t vertex = m_geometry.vertex_indices[sector.first_vertex + i];
+            if (remap[vertex] == unmapped) {
+                remap[vertex] = push_vertex(compact, Vertex(m_geometry.vertex_x[vertex],
+                                                            m_geometry.vertex_z[vertex]));
+            }
+            compact.vertex_indices.push_back(remap[vertex]);
+        }
+
+        uint32_t first_wall = static_cast<uint32_t>(compact.wall_vertex_a.size());
+        copy_walls(m_geometry, sector, compact);
+        sector.first_vertex = first_vertex;
+        sector.first_wall = first_wall;
+    }
+    m_geometry = std::move(compact);
+    m_dead_geometry = 0;
+
+    // The weld table indexes the old pool, the grid the old wall arrays
+    std::vector<WeldSlot>().swap(m_weld_table);
+    m_weld_count = 0;
+    if (m_spatial_grid) {
+        build_spatial_grid();
+    }
+
+    // Only the layout of the pools changed, no sector's shape
+    bump_revision(std::vector<uint32_t>());
+}
+
+void Level::reserve(size_t sector_count, size_t portal_count, size_t wall_count) {
+    m_sectors.reserve(sector_count);
+    m_portals.reserve(portal_count);
+
+    // A closed outline has as many corners as walls
+    m_geometry.vertex_indices.reserve(wall_count);
+    m_geometry.wall_vertex_a.reserve(wall_count);
+    m_geometry.wall_vertex_b.reserve(wall_count);
+    m_geometry.wall_texture.reserve(wall_count);
+    m_geometry.wall_portal.reserve(wall_count);
 }
 
 int32_t Level::find_sector_at_point(float x, float z) const {
-    for (size_t i = 0; i < m_sectors.size(); ++i) {
+    if (!m_bsp_tree || !m_bsp_tree->is_built()) {
+        if (!m_spatial_grid) {
+            return find_sector_linear(x, z, 0);
+        }
+        int32_t best = -1;
+        m_spatial_grid->for_each_sector_at_point(*this, x, z, [&best](uint32_t sector) {
+            if (best < 0 || static_cast<int32_t>(sector) < best) {
+                best = static_cast<int32_t>(sector);
+            }
+        });
+        return best;
+    }
+
+    // Only the sectors in leaves near the point can contain it. Testing
+    // their full outlines and keeping the lowest index gives exactly what
+    // the linear scan would.
+    const BSPTree& tree = *m_bsp_tree;
+    size_t covered = std::min(m_bsp_sector_count, m_sectors.size());
+    size_t best = covered;
+    tree.for_each_leaf_near(x, z, [&](uint32_t leaf_index) {
+        const BSPNode& leaf = tree.get_node(leaf_index);
+        for (uint32_t i = 0; i < leaf.subsector_count; ++i) {
+            uint32_t sector = tree.get_subsector(leaf.first_subsector + i).sector;
+            if (sector < best && point_in_sector(m_sectors[sector], x, z)) {
+                best = sector;
+            }
+        }
+    });
+    if (best < covered) {
+        return static_cast<int32_t>(best);
+    }
+
+    // Sectors added after the tree was built aren't in it
+    return find_sector_linear(x, z, covered);
+}
+
+void Level::find_sectors_at_points(const float* x, const float* z, size_t count,
+                                   int32_t* sectors) const {
+    // Queries are independent and read-only
+    const size_t grain_size = 4096;
+    platform::ThreadPool::get_shared().parallel_for(count, grain_size,
+        [this, x, z, sectors](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                sectors[i] = find_sector_at_point(x[i], z[i]);
+            }
+        });
+}
+
+int32_t Level::find_sector_linear(float x, float z, size_t first) const {
+    for (size_t i = first; i < m_sectors.size(); ++i) {
         if (point_in_sector(m_sectors[i], x, z)) {
             return static_cast<int32_t>(i);
         }
@@ -38,16 +644,20 @@ int32_t Level::find_sector_at_point(float x, float z) const {
     return -1;
 }
 
+bool Level::sector_contains_point(uint32_t index, float x, float z) const {
+    return point_in_sector(m_sectors[index], x, z);
+}
+
 bool Level::point_in_sector(const Sector& sector, float x, float z) const {
     // Simple ray casting algorithm to check if point is inside polygon
     // Cast a ray from the point to the right and count intersections
     int intersections = 0;
-    size_t vertex_count = sector.vertices.size();
+    uint32_t vertex_count = sector.vertex_count;
 
-    for (size_t i = 0; i < vertex_count; ++i) {
-        size_t next = (i + 1) % vertex_count;
-        const Vertex& v1 = sector.vertices[i];
-        const Vertex& v2 = sector.vertices[next];
+    for (uint32_t i = 0; i < vertex_count; ++i) {
+        uint32_t next = (i + 1) % vertex_count;
+        Vertex v1 = m_geometry.get_vertex(sector, i);
+        Vertex v2 = m_geometry.get_vertex(sector, next);
 
         // Check if ray intersects this edge
         if ((v1.z > z) != (v2.z > z)) {
@@ -65,7 +675,7 @@ Level Level::create_test_level() {
     Level level;
 
     // Create first room (starting room)
-    Sector room1;
+    SectorDesc room1;
     room1.floor_height = 0.0f;
     room1.ceiling_height = 3.0f;
     room1.floor_texture = 0;
@@ -92,7 +702,7 @@ Level Level::create_test_level() {
     level.add_sector(room1);
 
     // Create second room (connected via portal)
-    Sector room2;
+    SectorDesc room2;
     room2.floor_height = 0.0f;
     room2.ceiling_height = 3.0f;
     room2.floor_texture = 0;
@@ -138,8 +748,9 @@ Level Level::create_test_level() {
     player_spawn.rotation = 0.0f;
     level.add_entity_spawn(player_spawn);
 
-    // Build BSP tree
+    // Build BSP tree and visibility
     level.build_bsp();
+    level.build_pvs();
 
     return level;
 }
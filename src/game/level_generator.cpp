@@ -0,0 +1,320 @@
+#include "game/level_generator.h"
+#include "platform/thread_pool.h"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace game {
+
+namespace {
+
+// Rooms or corners per thread pool task
+constexpr size_t GENERATE_GRAIN = 4096;
+
+// Player spawn height above the floor (camera at eye level)
+constexpr float PLAYER_EYE_HEIGHT = 1.7f;
+
+// Independent random choices made for each room or corner
+enum RandomStream : uint64_t {
+    STREAM_PRESENT,
+    STREAM_DOOR_EAST,
+    STREAM_DOOR_NORTH,
+    STREAM_FLOOR,
+    STREAM_ROOM_HEIGHT,
+    STREAM_LIGHT,
+    STREAM_FLOOR_TEXTURE,
+    STREAM_CEILING_TEXTURE,
+    STREAM_WALL_TEXTURE,
+    STREAM_SPAWN,
+    STREAM_SPAWN_TYPE,
+    STREAM_SPAWN_ROTATION,
+    STREAM_CORNER_X,
+    STREAM_CORNER_Z,
+};
+
+// splitmix64 finalizer
+uint64_t mix(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+// Random bits for one choice about one room or corner
+uint64_t random_bits(uint32_t seed, RandomStream stream, uint64_t index) {
+    return mix(mix((static_cast<uint64_t>(seed) << 8) | stream) ^ index);
+}
+
+// Uniform in [0, 1)
+float random_unit(uint32_t seed, RandomStream stream, uint64_t index) {
+    return static_cast<float>(random_bits(seed, stream, index) >> 40) * (1.0f / 16777216.0f);
+}
+
+uint32_t random_below(uint32_t seed, RandomStream stream, uint64_t index, uint32_t count) {
+    return count > 1 ? static_cast<uint32_t>(random_bits(seed, stream, index) % count) : 0;
+}
+
+struct Room {
+    float floor_height;
+    float ceiling_height;
+    uint8_t present;
+    uint8_t open_east;          // Joined to the +x neighbour
+    uint8_t open_north;         // Joined to the +z neighbour
+    uint8_t spawn;
+};
+
+// Randomized depth-first walk from the first room; opens one wall per step
+void carve_maze(std::vector<Room>& rooms, uint32_t width, uint32_t height, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::vector<uint8_t> visited(rooms.size(), 0);
+    std::vector<uint32_t> stack;
+    stack.push_back(0);
+    visited[0] = 1;
+
+    while (!stack.empty()) {
+        uint32_t cell = stack.back();
+        uint32_t x = cell % width;
+        uint32_t z = cell / width;
+
+        // Unvisited neighbours: -x, +x, -z, +z
+        uint32_t options[4];
+        int option_count = 0;
+        if (x > 0 && !visited[cell - 1]) options[option_count++] = cell - 1;
+        if (x + 1 < width && !visited[cell + 1]) options[option_count++] = cell + 1;
+        if (z > 0 && !visited[cell - width]) options[option_count++] = cell - width;
+        if (z + 1 < height && !visited[cell + width]) options[option_count++] = cell + width;
+
+        if (option_count == 0) {
+            stack.pop_back();
+            continue;
+        }
+
+        uint32_t next = options[rng() % option_count];
+        uint32_t low = std::min(cell, next);
+        if (next == cell + 1 || next + 1 == cell) {
+            rooms[low].open_east = 1;
+        } else {
+            rooms[low].open_north = 1;
+        }
+        visited[next] = 1;
+        stack.push_back(next);
+    }
+}
+
+// Two rooms are joined if the layout opens the wall between them and
+// their floor-to-ceiling spans overlap
+bool joins(const Room& a, const Room& b) {
+    return a.present && b.present &&
+           std::max(a.floor_height, b.floor_height) < std::min(a.ceiling_height, b.ceiling_height);
+}
+
+} // namespace
+
+Level LevelGenerator::generate(const LevelGeneratorConfig& config) {
+    platform::ThreadPool& pool = config.pool ? *config.pool : platform::ThreadPool::get_shared();
+    const uint32_t width = std::max(config.width, 1u);
+    const uint32_t height = std::max(config.height, 1u);
+    const uint32_t seed = config.seed;
+    const size_t room_count = static_cast<size_t>(width) * height;
+
+    // Rooms: presence, heights, doorways. Everything but the maze walk is
+    // a hash of the room index, so it runs in parallel.
+    std::vector<Room> rooms(room_count);
+    pool.parallel_for(room_count, GENERATE_GRAIN, [&](size_t begin, size_t end) {
+        for (size_t cell = begin; cell < end; ++cell) {
+            uint32_t x = static_cast<uint32_t>(cell % width);
+            uint32_t z = static_cast<uint32_t>(cell / width);
+            Room& room = rooms[cell];
+
+            uint32_t level = random_below(seed, STREAM_FLOOR, cell, config.floor_levels);
+            float room_height = config.min_room_height +
+                (config.max_room_height - config.min_room_height) *
+                random_unit(seed, STREAM_ROOM_HEIGHT, cell);
+            room.floor_height = config.floor_step * static_cast<float>(level);
+            room.ceiling_height = room.floor_height + room_height;
+            room.present = 1;
+            room.open_east = 0;
+            room.open_north = 0;
+            room.spawn = random_unit(seed, STREAM_SPAWN, cell) < config.spawn_chance;
+
+            switch (config.layout) {
+            case LevelLayout::GRID:
+                room.open_east = x + 1 < width &&
+                    random_unit(seed, STREAM_DOOR_EAST, cell) < config.door_chance;
+                room.open_north = z + 1 < height &&
+                    random_unit(seed, STREAM_DOOR_NORTH, cell) < config.door_chance;
+                break;
+            case LevelLayout::ARENA:
+                room.present = cell == 0 ||
+                    random_unit(seed, STREAM_PRESENT, cell) >= config.pillar_chance;
+                room.open_east = x + 1 < width;
+                room.open_north = z + 1 < height;
+                break;
+            case LevelLayout::MAZE:
+                break;
+            }
+        }
+    });
+    if (config.layout == LevelLayout::MAZE) {
+        carve_maze(rooms, width, height, seed);
+    }
+
+    // Number the sectors and portals in room order. Each doorway is two
+    // portals, both numbered with the room on its -x / -z side.
+    std::vector<uint32_t> sector_of(room_count, 0);
+    std::vector<uint32_t> first_portal(room_count, 0);
+    uint32_t sector_count = 0;
+    uint32_t portal_count = 0;
+    for (size_t cell = 0; cell < room_count; ++cell) {
+        Room& room = rooms[cell];
+        room.open_east = room.open_east && joins(room, rooms[cell + 1]);
+        room.open_north = room.open_north && joins(room, rooms[cell + width]);
+        sector_of[cell] = sector_count;
+        first_portal[cell] = portal_count;
+        sector_count += room.present;
+        portal_count += 2 * (room.open_east + room.open_north);
+    }
+
+    // Corner lattice, shared by the rooms around each corner
+    const uint32_t corner_width = width + 1;
+    const size_t corner_count = static_cast<size_t>(corner_width) * (height + 1);
+    const float jitter = std::clamp(config.corner_jitter, 0.0f, 0.25f) * config.cell_size;
+
+    LevelGeometry geometry;
+    geometry.vertex_x.resize(corner_count);
+    geometry.vertex_z.resize(corner_count);
+    pool.parallel_for(corner_count, GENERATE_GRAIN, [&](size_t begin, size_t end) {
+        for (size_t corner = begin; corner < end; ++corner) {
+            float x = config.origin_x + static_cast<float>(corner % corner_width) * config.cell_size;
+            float z = config.origin_z + static_cast<float>(corner / corner_width) * config.cell_size;
+            if (jitter > 0.0f) {
+                x += jitter * (2.0f * random_unit(seed, STREAM_CORNER_X, corner) - 1.0f);
+                z += jitter * (2.0f * random_unit(seed, STREAM_CORNER_Z, corner) - 1.0f);
+            }
+            geometry.vertex_x[corner] = x;
+            geometry.vertex_z[corner] = z;
+        }
+    });
+
+    // Sectors, walls and portals. Each room writes only its own sector,
+    // walls and portals, reading its -x / -z neighbours' portal numbers.
+    // Walls 1 and 3 face +x / -x, walls 2 and 0 face +z / -z.
+    std::vector<Sector> sectors(sector_count);
+    std::vector<Portal> portals(portal_count);
+    geometry.vertex_indices.resize(static_cast<size_t>(sector_count) * 4);
+    geometry.wall_vertex_a.resize(static_cast<size_t>(sector_count) * 4);
+    geometry.wall_vertex_b.resize(static_cast<size_t>(sector_count) * 4);
+    geometry.wall_texture.resize(static_cast<size_t>(sector_count) * 4);
+    geometry.wall_portal.resize(static_cast<size_t>(sector_count) * 4);
+    pool.parallel_for(room_count, GENERATE_GRAIN, [&](size_t begin, size_t end) {
+        for (size_t cell = begin; cell < end; ++cell) {
+            const Room& room = rooms[cell];
+            if (!room.present) {
+                continue;
+            }
+            uint32_t x = static_cast<uint32_t>(cell % width);
+            uint32_t z = static_cast<uint32_t>(cell / width);
+            uint32_t index = sector_of[cell];
+
+            Sector& sector = sectors[index];
+            sector.first_vertex = index * 4;
+            sector.vertex_count = 4;
+            sector.first_wall = index * 4;
+            sector.wall_count = 4;
+            sector.floor_height = room.floor_height;
+            sector.ceiling_height = room.ceiling_height;
+            sector.floor_texture = random_below(seed, STREAM_FLOOR_TEXTURE, cell, config.texture_count);
+            sector.ceiling_texture = random_below(seed, STREAM_CEILING_TEXTURE, cell, config.texture_count);
+            sector.light_level = 0.5f + 0.5f * random_unit(seed, STREAM_LIGHT, cell);
+
+            uint32_t corner = z * corner_width + x;
+            uint32_t* outline = &geometry.vertex_indices[sector.first_vertex];
+            outline[0] = corner;
+            outline[1] = corner + 1;
+            outline[2] = corner + corner_width + 1;
+            outline[3] = corner + corner_width;
+
+            // A doorway's opening runs from the higher floor to the lower
+            // ceiling of its two rooms
+            int32_t wall_portals[4] = {-1, -1, -1, -1};
+            uint32_t portal = first_portal[cell];
+            auto open_doorway = [&](size_t neighbour_cell, uint32_t wall) {
+                const Room& neighbour = rooms[neighbour_cell];
+                Portal opening;
+                opening.floor_height = std::max(room.floor_height, neighbour.floor_height);
+                opening.ceiling_height = std::min(room.ceiling_height, neighbour.ceiling_height);
+                opening.target_sector = sector_of[neighbour_cell];
+                portals[portal] = opening;
+                opening.target_sector = index;
+                portals[portal + 1] = opening;
+                wall_portals[wall] = static_cast<int32_t>(portal);
+                portal += 2;
+            };
+            if (room.open_east) {
+                open_doorway(cell + 1, 1);
+            }
+            if (room.open_north) {
+                open_doorway(cell + width, 2);
+            }
+            if (x > 0 && rooms[cell - 1].open_east) {
+                wall_portals[3] = static_cast<int32_t>(first_portal[cell - 1] + 1);
+            }
+            if (z > 0 && rooms[cell - width].open_north) {
+                const Room& south = rooms[cell - width];
+                wall_portals[0] = static_cast<int32_t>(first_portal[cell - width] + 1 +
+                                                       (south.open_east ? 2 : 0));
+            }
+
+            for (uint32_t i = 0; i < 4; ++i) {
+                uint32_t wall = sector.first_wall + i;
+                geometry.wall_vertex_a[wall] = i;
+                geometry.wall_vertex_b[wall] = (i + 1) % 4;
+                geometry.wall_texture[wall] = random_below(seed, STREAM_WALL_TEXTURE,
+                                                           cell * 4 + i, config.texture_count);
+                geometry.wall_portal[wall] = wall_portals[i];
+            }
+        }
+    });
+
+    Level level;
+    level.reserve(0, portal_count);
+    for (const Portal& portal : portals) {
+        level.add_portal(portal);
+    }
+
+    // Player in the first room, then the rooms' entities in room order
+    bool player_placed = false;
+    for (size_t cell = 0; cell < room_count; ++cell) {
+        const Room& room = rooms[cell];
+        if (!room.present || (player_placed && !room.spawn)) {
+            continue;
+        }
+        const Sector& sector = sectors[sector_of[cell]];
+        float x = 0.0f;
+        float z = 0.0f;
+        for (uint32_t i = 0; i < 4; ++i) {
+            Vertex corner = geometry.get_vertex(sector, i);
+            x += corner.x * 0.25f;
+            z += corner.z * 0.25f;
+        }
+
+        EntitySpawn spawn;
+        if (!player_placed) {
+            spawn.position = {x, room.floor_height + PLAYER_EYE_HEIGHT, z};
+            level.add_entity_spawn(spawn);
+            player_placed = true;
+            if (!room.spawn) {
+                continue;
+            }
+        }
+        spawn.position = {x, room.floor_height, z};
+        spawn.entity_type = 1 + random_below(seed, STREAM_SPAWN_TYPE, cell, config.entity_types);
+        spawn.rotation = 6.2831853f * random_unit(seed, STREAM_SPAWN_ROTATION, cell);
+        level.add_entity_spawn(spawn);
+    }
+
+    level.set_sectors(std::move(sectors), std::move(geometry));
+    return level;
+}
+
+} // namespace game
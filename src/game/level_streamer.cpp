@@ -0,0 +1,498 @@
+#include "game/level_streamer.h"
+#include "game/bsp.h"
+#include "game/cooked_level.h"
+#include "game/json_level.h"
+#include "game/spatial_grid.h"
+#include "platform/file_system.h"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace game {
+
+namespace {
+
+// How far off a chunk border a wall's ends can be and still lie on it
+constexpr float EDGE_EPSILON = 1e-3f;
+
+// How far across a seam find_sector_across looks for floor
+constexpr float SEAM_PROBE = 0.01f;
+
+uint64_t chunk_key(int32_t x, int32_t z) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32) | static_cast<uint32_t>(z);
+}
+
+// Distance from (x, z) to the segment from..to in XZ
+float distance_to_segment(float x, float z, const Vector3& from, const Vector3& to) {
+    float dx = to.x - from.x;
+    float dz = to.z - from.z;
+    float length_sq = dx * dx + dz * dz;
+    float t = 0.0f;
+    if (length_sq > 0.0f) {
+        t = std::clamp(((x - from.x) * dx + (z - from.z) * dz) / length_sq, 0.0f, 1.0f);
+    }
+    float px = from.x + dx * t - x;
+    float pz = from.z + dz * t - z;
+    return sqrtf(px * px + pz * pz);
+}
+
+template <typename T>
+size_t vector_bytes(const std::vector<T>& values) {
+    return values.capacity() * sizeof(T);
+}
+
+// Heap held by a loaded chunk, roughly: its arrays, BSP tree and grid
+size_t level_bytes(const Level& level) {
+    const LevelGeometry& geometry = level.get_geometry();
+    size_t bytes = sizeof(Level) +
+        vector_bytes(level.get_sectors()) + vector_bytes(level.get_portals()) +
+        vector_bytes(level.get_spawns()) +
+        vector_bytes(geometry.vertex_x) + vector_bytes(geometry.vertex_z) +
+        vector_bytes(geometry.vertex_indices) + vector_bytes(geometry.wall_vertex_a) +
+        vector_bytes(geometry.wall_vertex_b) + vector_bytes(geometry.wall_texture) +
+        vector_bytes(geometry.wall_portal);
+    if (const BSPTree* tree = level.get_bsp_tree()) {
+        bytes += sizeof(BSPTree) +
+            tree->get_nodes().size() * sizeof(BSPNode) +
+            tree->get_subsectors().size() * sizeof(BSPSubSector) +
+            tree->get_segs().size() * sizeof(BSPSeg);
+    }
+    if (const SpatialGrid* grid = level.get_spatial_grid()) {
+        bytes += sizeof(SpatialGrid) + grid->get_memory_bytes();
+    }
+    return bytes;
+}
+
+} // namespace
+
+uint32_t find_chunk_edge(float min_x, float min_z, float max_x, float max_z, uint32_t edges,
+                         const Vertex& a, const Vertex& b) {
+    auto on = [](float first, float second, float line) {
+        return fabsf(first - line) <= EDGE_EPSILON && fabsf(second - line) <= EDGE_EPSILON;
+    };
+    if ((edges & CHUNK_EDGE_MIN_X) && on(a.x, b.x, min_x)) {
+        return CHUNK_EDGE_MIN_X;
+    }
+    if ((edges & CHUNK_EDGE_MAX_X) && on(a.x, b.x, max_x)) {
+        return CHUNK_EDGE_MAX_X;
+    }
+    if ((edges & CHUNK_EDGE_MIN_Z) && on(a.z, b.z, min_z)) {
+        return CHUNK_EDGE_MIN_Z;
+    }
+    if ((edges & CHUNK_EDGE_MAX_Z) && on(a.z, b.z, max_z)) {
+        return CHUNK_EDGE_MAX_Z;
+    }
+    return 0;
+}
+
+void get_chunk_edge_normal(uint32_t edge, float& normal_x, float& normal_z) {
+    normal_x = edge == CHUNK_EDGE_MIN_X ? -1.0f : edge == CHUNK_EDGE_MAX_X ? 1.0f : 0.0f;
+    normal_z = edge == CHUNK_EDGE_MIN_Z ? -1.0f : edge == CHUNK_EDGE_MAX_Z ? 1.0f : 0.0f;
+}
+
+const Sector* find_sector_across(core::Span<const ChunkLevel> chunks, size_t owner,
+                                 const Vertex& a, const Vertex& b) {
+    const ChunkLevel& chunk = chunks[owner];
+    uint32_t edge = find_chunk_edge(chunk.min_x, chunk.min_z, chunk.max_x, chunk.max_z,
+                                    chunk.seams, a, b);
+    if (edge == 0) {
+        return nullptr;
+    }
+
+    // Just past the middle of the wall, out through the seam
+    float normal_x = 0.0f;
+    float normal_z = 0.0f;
+    get_chunk_edge_normal(edge, normal_x, normal_z);
+    float x = (a.x + b.x) * 0.5f + normal_x * SEAM_PROBE;
+    float z = (a.z + b.z) * 0.5f + normal_z * SEAM_PROBE;
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        if (i == owner) {
+            continue;
+        }
+        int32_t sector = chunks[i].level->find_sector_at_point(x, z);
+        if (sector >= 0) {
+            return &chunks[i].level->get_sector(static_cast<uint32_t>(sector));
+        }
+    }
+    return nullptr;
+}
+
+GeneratedChunkSource::GeneratedChunkSource(const LevelGeneratorConfig& config,
+                                           uint32_t rooms_per_chunk, uint32_t world_chunks)
+    : m_config(config)
+    , m_rooms_per_chunk(std::max(rooms_per_chunk, 1u))
+    , m_world_chunks(world_chunks) {
+}
+
+float GeneratedChunkSource::get_chunk_size() const {
+    return m_config.cell_size * static_cast<float>(m_rooms_per_chunk);
+}
+
+bool GeneratedChunkSource::load_chunk(int32_t x, int32_t z, Level& level, std::string* error) {
+    if (x < 0 || z < 0 || static_cast<uint32_t>(x) >= m_world_chunks ||
+        static_cast<uint32_t>(z) >= m_world_chunks) {
+        if (error) {
+            *error = "chunk outside the world";
+        }
+        return false;
+    }
+
+    LevelGeneratorConfig config = m_config;
+    config.width = m_rooms_per_chunk;
+    config.height = m_rooms_per_chunk;
+    config.origin_x = static_cast<float>(x) * get_chunk_size();
+    config.origin_z = static_cast<float>(z) * get_chunk_size();
+    config.seed = m_config.seed ^ (static_cast<uint32_t>(z) * m_world_chunks + static_cast<uint32_t>(x)) *
+                                  0x9E3779B9u;
+    level = LevelGenerator::generate(config);
+    return true;
+}
+
+uint32_t GeneratedChunkSource::get_seams(int32_t x, int32_t z) const {
+    int64_t last = static_cast<int64_t>(m_world_chunks) - 1;
+    return (x > 0 ? CHUNK_EDGE_MIN_X : 0) | (x < last ? CHUNK_EDGE_MAX_X : 0) |
+           (z > 0 ? CHUNK_EDGE_MIN_Z : 0) | (z < last ? CHUNK_EDGE_MAX_Z : 0);
+}
+
+FileChunkSource::FileChunkSource(const std::string& directory, float chunk_size, uint32_t seams)
+    : m_directory(directory)
+    , m_chunk_size(chunk_size)
+    , m_seams(seams) {
+}
+
+bool FileChunkSource::load_chunk(int32_t x, int32_t z, Level& level, std::string* error) {
+    std::string name = "chunk_" + std::to_string(x) + "_" + std::to_string(z);
+    std::string cooked_path = platform::FileSystem::join_path(m_directory, name + ".ywlevel");
+    if (platform::FileSystem::file_exists(cooked_path)) {
+        return CookedLevel::load(cooked_path, level, error);
+    }
+    std::string json_path = platform::FileSystem::join_path(m_directory, name + ".json");
+    if (platform::FileSystem::file_exists(json_path)) {
+        return JsonLevel::load(json_path, level, error);
+    }
+    if (error) {
+        *error = "no file for " + name;
+    }
+    return false;
+}
+
+LevelStreamer::LevelStreamer(std::unique_ptr<ChunkSource> source, const LevelStreamerConfig& config)
+    : m_loading(false)
+    , m_loading_key(0)
+    , m_stopping(false)
+    , m_source(std::move(source))
+    , m_config(config)
+    , m_chunk_size(m_source->get_chunk_size())
+    , m_start_time(std::chrono::steady_clock::now())
+    , m_last_position{0.0f, 0.0f, 0.0f}
+    , m_velocity{0.0f, 0.0f, 0.0f}
+    , m_has_position(false)
+    , m_load_time_total(0.0) {
+    m_loader = std::thread([this]() { loader_main(); });
+}
+
+LevelStreamer::~LevelStreamer() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    m_loader.join();
+}
+
+double LevelStreamer::now_ms() const {
+    return std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - m_start_time).count();
+}
+
+void LevelStreamer::loader_main() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_wake.wait(lock, [this]() {
+            return m_stopping || !m_queue.empty() || !m_retired.empty();
+        });
+        if (m_stopping) {
+            return;
+        }
+
+        std::vector<std::unique_ptr<Level>> retired;
+        retired.swap(m_retired);
+        bool has_request = !m_queue.empty();
+        LoadRequest request{0, 0, 0.0};
+        if (has_request) {
+            request = m_queue.back();
+            m_queue.pop_back();
+            m_loading = true;
+            m_loading_key = chunk_key(request.x, request.z);
+        }
+        lock.unlock();
+
+        // Evicted chunks are freed here rather than on the main thread
+        retired.clear();
+
+        Chunk chunk{request.x, request.z, nullptr, 0, 0};
+        if (has_request) {
+            auto level = std::make_unique<Level>();
+            if (m_source->load_chunk(request.x, request.z, *level, nullptr)) {
+                const BSPTree* tree = level->get_bsp_tree();
+                if (!tree || !tree->is_built()) {
+                    level->build_bsp();
+                }
+                const SpatialGrid* grid = level->get_spatial_grid();
+                if (!grid || !grid->is_built()) {
+                    level->build_spatial_grid();
+                }
+                chunk.bytes = level_bytes(*level);
+                chunk.level = std::move(level);
+                chunk.seams = m_source->get_seams(request.x, request.z);
+            }
+        }
+
+        lock.lock();
+        if (has_request) {
+            m_loaded.push_back(std::move(chunk));
+            m_load_times.push_back(now_ms() - request.requested_ms);
+            m_loading = false;
+        }
+        if (m_queue.empty() && !m_loading) {
+            m_idle.notify_all();
+        }
+    }
+}
+
+void LevelStreamer::update(const Vector3& camera_position, float delta_time) {
+    double start_ms = now_ms();
+
+    // Velocity from the last two positions, smoothed so a single odd frame
+    // doesn't swing the prefetch around
+    if (m_has_position && delta_time > 0.0f) {
+        Vector3 step = {(camera_position.x - m_last_position.x) / delta_time, 0.0f,
+                        (camera_position.z - m_last_position.z) / delta_time};
+        m_velocity.x = 0.5f * (m_velocity.x + step.x);
+        m_velocity.z = 0.5f * (m_velocity.z + step.z);
+    }
+    m_last_position = camera_position;
+    m_has_position = true;
+    Vector3 predicted = {camera_position.x + m_velocity.x * m_config.prefetch_seconds,
+                         camera_position.y,
+                         camera_position.z + m_velocity.z * m_config.prefetch_seconds};
+
+    // Trade with the loader if it isn't holding the lock; otherwise next
+    // frame. Finished chunks come in first so the eviction sees them.
+    std::unique_lock<std::mutex> lock(m_mutex, std::try_to_lock);
+    if (lock.owns_lock()) {
+        std::vector<Chunk> loaded;
+        std::vector<double> load_times;
+        loaded.swap(m_loaded);
+        load_times.swap(m_load_times);
+        add_loaded(loaded, load_times);
+    }
+
+    float furthest = evict(camera_position, predicted);
+
+    if (lock.owns_lock()) {
+        queue_loads(camera_position, predicted, furthest);
+        for (auto& level : m_to_retire) {
+            m_retired.push_back(std::move(level));
+        }
+        m_to_retire.clear();
+        lock.unlock();
+        m_wake.notify_one();
+    }
+
+    int32_t camera_x = static_cast<int32_t>(floorf(camera_position.x / m_chunk_size));
+    int32_t camera_z = static_cast<int32_t>(floorf(camera_position.z / m_chunk_size));
+    if (!m_chunks.count(chunk_key(camera_x, camera_z))) {
+        m_stats.misses++;
+    }
+
+    m_stats.updates++;
+    m_stats.last_update_ms = now_ms() - start_ms;
+    m_stats.max_update_ms = std::max(m_stats.max_update_ms, m_stats.last_update_ms);
+    if (m_stats.last_update_ms > m_config.hitch_ms) {
+        m_stats.hitches++;
+    }
+}
+
+void LevelStreamer::queue_loads(const Vector3& from, const Vector3& to, float furthest) {
+    // Chunks reaching within load_distance of the path, nearest the camera
+    // first. Chunk distances are from their centers, less half a diagonal.
+    float reach = m_config.load_distance;
+    float half_diagonal = m_chunk_size * 0.70710678f;
+    int32_t min_x = static_cast<int32_t>(floorf((std::min(from.x, to.x) - reach) / m_chunk_size));
+    int32_t max_x = static_cast<int32_t>(floorf((std::max(from.x, to.x) + reach) / m_chunk_size));
+    int32_t min_z = static_cast<int32_t>(floorf((std::min(from.z, to.z) - reach) / m_chunk_size));
+    int32_t max_z = static_cast<int32_t>(floorf((std::max(from.z, to.z) + reach) / m_chunk_size));
+
+    double now = now_ms();
+    std::vector<std::pair<float, LoadRequest>> wanted;
+    for (int32_t z = min_z; z <= max_z; ++z) {
+        for (int32_t x = min_x; x <= max_x; ++x) {
+            float center_x = (static_cast<float>(x) + 0.5f) * m_chunk_size;
+            float center_z = (static_cast<float>(z) + 0.5f) * m_chunk_size;
+            uint64_t key = chunk_key(x, z);
+            if (distance_to_segment(center_x, center_z, from, to) - half_diagonal > reach ||
+                m_chunks.count(key) || (m_loading && key == m_loading_key)) {
+                continue;
+            }
+            auto requested = m_request_times.find(key);
+            double requested_ms = requested != m_request_times.end() ? requested->second : now;
+            float dx = center_x - from.x;
+            float dz = center_z - from.z;
+            wanted.push_back({sqrtf(dx * dx + dz * dz), LoadRequest{x, z, requested_ms}});
+        }
+    }
+    std::sort(wanted.begin(), wanted.end(),
+              [](const std::pair<float, LoadRequest>& a, const std::pair<float, LoadRequest>& b) {
+                  return a.first < b.first;
+              });
+
+    // While the budget has no room for another chunk of the resident
+    // chunks' mean size, only load chunks nearer than the furthest
+    // resident one, which the load will push out
+    std::unordered_map<uint64_t, double> request_times;
+    if (m_loading) {
+        auto loading = m_request_times.find(m_loading_key);
+        if (loading != m_request_times.end()) {
+            request_times.insert(*loading);
+        }
+    }
+    size_t mean_bytes = m_chunks.empty() ? 0 : m_stats.resident_bytes / m_chunks.size();
+    size_t expected_bytes = m_stats.resident_bytes + (m_loading ? mean_bytes : 0);
+    m_queue.clear();
+    for (const auto& entry : wanted) {
+        if (m_queue.size() >= m_config.max_queued_loads) {
+            break;
+        }
+        if (expected_bytes + mean_bytes > m_config.memory_budget && entry.first >= furthest) {
+            break;
+        }
+        expected_bytes += mean_bytes;
+        m_queue.push_back(entry.second);
+        request_times[chunk_key(entry.second.x, entry.second.z)] = entry.second.requested_ms;
+    }
+    std::reverse(m_queue.begin(), m_queue.end());
+    m_request_times.swap(request_times);
+    m_stats.queued_loads = static_cast<uint32_t>(m_queue.size()) + (m_loading ? 1 : 0);
+}
+
+void LevelStreamer::add_loaded(std::vector<Chunk>& loaded, const std::vector<double>& load_times) {
+    for (size_t i = 0; i < loaded.size(); ++i) {
+        Chunk& chunk = loaded[i];
+        uint64_t key = chunk_key(chunk.x, chunk.z);
+        m_request_times.erase(key);
+        if (m_chunks.count(key)) {
+            m_to_retire.push_back(std::move(chunk.level));
+            continue;
+        }
+
+        m_stats.loads++;
+        m_load_time_total += load_times[i];
+        m_stats.mean_load_ms = m_load_time_total / static_cast<double>(m_stats.loads);
+        m_stats.max_load_ms = std::max(m_stats.max_load_ms, load_times[i]);
+        m_stats.resident_bytes += chunk.bytes;
+        m_chunks.emplace(key, std::move(chunk));
+    }
+    m_stats.peak_bytes = std::max(m_stats.peak_bytes, m_stats.resident_bytes);
+    m_stats.resident_chunks = static_cast<uint32_t>(m_chunks.size());
+}
+
+float LevelStreamer::evict(const Vector3& from, const Vector3& to) {
+    float half_diagonal = m_chunk_size * 0.70710678f;
+    std::vector<std::pair<float, uint64_t>> by_distance;
+    for (auto it = m_chunks.begin(); it != m_chunks.end();) {
+        float center_x = (static_cast<float>(it->second.x) + 0.5f) * m_chunk_size;
+        float center_z = (static_cast<float>(it->second.z) + 0.5f) * m_chunk_size;
+        if (distance_to_segment(center_x, center_z, from, to) - half_diagonal > m_config.evict_distance) {
+            m_stats.resident_bytes -= it->second.bytes;
+            m_stats.evictions++;
+            m_to_retire.push_back(std::move(it->second.level));
+            it = m_chunks.erase(it);
+            continue;
+        }
+        float dx = center_x - from.x;
+        float dz = center_z - from.z;
+        by_distance.push_back({sqrtf(dx * dx + dz * dz), it->first});
+        ++it;
+    }
+
+    // Over budget: furthest from the camera first
+    if (m_stats.resident_bytes > m_config.memory_budget) {
+        std::sort(by_distance.begin(), by_distance.end());
+        while (m_stats.resident_bytes > m_config.memory_budget && by_distance.size() > 1) {
+            auto it = m_chunks.find(by_distance.back().second);
+            by_distance.pop_back();
+            m_stats.resident_bytes -= it->second.bytes;
+            m_stats.evictions++;
+            m_stats.budget_evictions++;
+            m_to_retire.push_back(std::move(it->second.level));
+            m_chunks.erase(it);
+        }
+    }
+    m_stats.resident_chunks = static_cast<uint32_t>(m_chunks.size());
+
+    float furthest = 0.0f;
+    for (const auto& entry : by_distance) {
+        furthest = std::max(furthest, entry.first);
+    }
+    return furthest;
+}
+
+const Level* LevelStreamer::get_chunk(int32_t x, int32_t z) const {
+    auto it = m_chunks.find(chunk_key(x, z));
+    return it != m_chunks.end() ? it->second.level.get() : nullptr;
+}
+
+const Level* LevelStreamer::get_chunk_at(float x, float z) const {
+    return get_chunk(static_cast<int32_t>(floorf(x / m_chunk_size)),
+                     static_cast<int32_t>(floorf(z / m_chunk_size)));
+}
+
+uint32_t LevelStreamer::get_open_seams(int32_t x, int32_t z) const {
+    auto it = m_chunks.find(chunk_key(x, z));
+    if (it == m_chunks.end() || !it->second.level) {
+        return 0;
+    }
+    uint32_t resident = (get_chunk(x - 1, z) ? CHUNK_EDGE_MIN_X : 0) |
+                        (get_chunk(x + 1, z) ? CHUNK_EDGE_MAX_X : 0) |
+                        (get_chunk(x, z - 1) ? CHUNK_EDGE_MIN_Z : 0) |
+                        (get_chunk(x, z + 1) ? CHUNK_EDGE_MAX_Z : 0);
+    return it->second.seams & resident;
+}
+
+void LevelStreamer::get_chunks_in_box(float min_x, float min_z, float max_x, float max_z,
+                                      std::vector<ChunkLevel>& out) const {
+    int32_t first_x = static_cast<int32_t>(floorf(min_x / m_chunk_size));
+    int32_t first_z = static_cast<int32_t>(floorf(min_z / m_chunk_size));
+    int32_t last_x = static_cast<int32_t>(floorf(max_x / m_chunk_size));
+    int32_t last_z = static_cast<int32_t>(floorf(max_z / m_chunk_size));
+    for (int32_t z = first_z; z <= last_z; ++z) {
+        for (int32_t x = first_x; x <= last_x; ++x) {
+            if (const Level* level = get_chunk(x, z)) {
+                ChunkLevel chunk;
+                chunk.level = level;
+                chunk.min_x = static_cast<float>(x) * m_chunk_size;
+                chunk.min_z = static_cast<float>(z) * m_chunk_size;
+                chunk.max_x = static_cast<float>(x + 1) * m_chunk_size;
+                chunk.max_z = static_cast<float>(z + 1) * m_chunk_size;
+                chunk.seams = get_open_seams(x, z);
+                out.push_back(chunk);
+            }
+        }
+    }
+}
+
+void LevelStreamer::finish_loads() {
+    std::vector<Chunk> loaded;
+    std::vector<double> load_times;
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_idle.wait(lock, [this]() { return m_queue.empty() && !m_loading; });
+        loaded.swap(m_loaded);
+        load_times.swap(m_load_times);
+        m_stats.queued_loads = 0;
+    }
+    add_loaded(loaded, load_times);
+}
+
+} // namespace game
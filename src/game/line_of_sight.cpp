@@ -0,0 +1,372 @@
+#include "game/line_of_sight.h"
+#include "game/bsp.h"
+#include <algorithm>
+#include <array>
+#include <limits>
+
+#if defined(__AVX__)
+    #include <immintrin.h>
+    #define LOS_PACKET_LANES Lanes8
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define LOS_PACKET_LANES Lanes4
+#endif
+
+namespace game {
+
+namespace {
+
+// Thin wrappers so one packet routine serves both vector widths
+
+#if defined(__AVX__)
+struct Lanes8 {
+    static constexpr int WIDTH = 8;
+    using Float = __m256;
+
+    static Float set1(float v) { return _mm256_set1_ps(v); }
+    static Float load(const float* p) { return _mm256_loadu_ps(p); }
+    static Float add(Float a, Float b) { return _mm256_add_ps(a, b); }
+    static Float sub(Float a, Float b) { return _mm256_sub_ps(a, b); }
+    static Float mul(Float a, Float b) { return _mm256_mul_ps(a, b); }
+    static Float div(Float a, Float b) { return _mm256_div_ps(a, b); }
+    static Float ge(Float a, Float b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+    static Float le(Float a, Float b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+    static Float both(Float a, Float b) { return _mm256_and_ps(a, b); }
+    static uint32_t bits(Float a) { return static_cast<uint32_t>(_mm256_movemask_ps(a)); }
+};
+#endif
+
+#if defined(LOS_PACKET_LANES)
+struct Lanes4 {
+    static constexpr int WIDTH = 4;
+    using Float = __m128;
+
+    static Float set1(float v) { return _mm_set1_ps(v); }
+    static Float load(const float* p) { return _mm_loadu_ps(p); }
+    static Float add(Float a, Float b) { return _mm_add_ps(a, b); }
+    static Float sub(Float a, Float b) { return _mm_sub_ps(a, b); }
+    static Float mul(Float a, Float b) { return _mm_mul_ps(a, b); }
+    static Float div(Float a, Float b) { return _mm_div_ps(a, b); }
+    static Float ge(Float a, Float b) { return _mm_cmpge_ps(a, b); }
+    static Float le(Float a, Float b) { return _mm_cmple_ps(a, b); }
+    static Float both(Float a, Float b) { return _mm_and_ps(a, b); }
+    static uint32_t bits(Float a) { return static_cast<uint32_t>(_mm_movemask_ps(a)); }
+};
+#endif
+
+// Deepest tree the packet walk has to handle
+constexpr size_t MAX_STACK = BSPTree::MAX_DEPTH + 2;
+
+// Cells per side of the grid pairs are bucketed on before packing (a power of 2)
+constexpr uint32_t GRID_SIZE = 64;
+
+// Spread the low 16 bits of v out to the even bits (Morton order)
+uint32_t interleave_bits(uint32_t v) {
+    v &= 0xFFFFu;
+    v = (v | (v << 8)) & 0x00FF00FFu;
+    v = (v | (v << 4)) & 0x0F0F0F0Fu;
+    v = (v | (v << 2)) & 0x33333333u;
+    v = (v | (v << 1)) & 0x55555555u;
+    return v;
+}
+
+} // namespace
+
+LineOfSight::LineOfSight() {
+}
+
+void LineOfSight::build(const Level& level) {
+    m_nodes.clear();
+    m_wall_x.clear();
+    m_wall_z.clear();
+    m_wall_dx.clear();
+    m_wall_dz.clear();
+    m_open_floor.clear();
+    m_open_ceiling.clear();
+
+    const auto& sectors = level.get_sectors();
+    const LevelGeometry& geometry = level.get_geometry();
+    const BSPTree* bsp_tree = level.get_bsp_tree();
+
+    if (bsp_tree && bsp_tree->is_built()) {
+        // Same node numbering as the tree; each leaf's segs become its run
+        // of walls, already in leaf order since leaves own contiguous segs
+        const auto& tree_nodes = bsp_tree->get_nodes();
+        const auto& segs = bsp_tree->get_segs();
+        m_nodes.reserve(tree_nodes.size());
+        for (const BSPNode& tree_node : tree_nodes) {
+            Node node;
+            node.min_x = tree_node.bounds.min.x;
+            node.min_z = tree_node.bounds.min.z;
+            node.max_x = tree_node.bounds.max.x;
+            node.max_z = tree_node.bounds.max.z;
+            node.front = tree_node.front;
+            node.back = tree_node.back;
+            node.first_wall = static_cast<uint32_t>(m_wall_x.size());
+
+            if (tree_node.is_leaf()) {
+                for (uint32_t s = 0; s < tree_node.subsector_count; ++s) {
+                    const BSPSubSector& subsector = bsp_tree->get_subsector(tree_node.first_subsector + s);
+                    const Sector& sector = sectors[subsector.sector];
+                    for (uint32_t i = 0; i < subsector.seg_count; ++i) {
+                        const BSPSeg& seg = segs[subsector.first_seg + i];
+                        add_wall(level, seg.start, seg.end,
+                                 geometry.wall_portal[sector.first_wall + seg.wall]);
+                    }
+                }
+            }
+
+            node.wall_end = static_cast<uint32_t>(m_wall_x.size());
+            m_nodes.push_back(node);
+        }
+        return;
+    }
+
+    // No tree: a single leaf holding every wall
+    const float inf = std::numeric_limits<float>::infinity();
+    Node root{inf, inf, -inf, -inf, BSP_NULL_NODE, BSP_NULL_NODE, 0, 0};
+    for (const Sector& sector : sectors) {
+        for (uint32_t w = 0; w < sector.wall_count; ++w) {
+            Wall wall = geometry.get_wall(sector, w);
+            if (wall.vertex_a >= sector.vertex_count || wall.vertex_b >= sector.vertex_count) {
+                continue;
+            }
+            Vertex a = geometry.get_vertex(sector, wall.vertex_a);
+            Vertex b = geometry.get_vertex(sector, wall.vertex_b);
+            add_wall(level, a, b, wall.portal_id);
+
+            root.min_x = std::min({root.min_x, a.x, b.x});
+            root.min_z = std::min({root.min_z, a.z, b.z});
+            root.max_x = std::max({root.max_x, a.x, b.x});
+            root.max_z = std::max({root.max_z, a.z, b.z});
+        }
+    }
+    root.wall_end = static_cast<uint32_t>(m_wall_x.size());
+    m_nodes.push_back(root);
+}
+
+void LineOfSight::add_wall(const Level& level, const Vertex& start, const Vertex& end,
+                           int32_t portal_id) {
+    // Solid walls get an empty opening that no height falls into
+    float open_floor = std::numeric_limits<float>::infinity();
+    float open_ceiling = -std::numeric_limits<float>::infinity();
+
+    const auto& portals = level.get_portals();
+    if (portal_id >= 0 && static_cast<size_t>(portal_id) < portals.size()) {
+        open_floor = portals[portal_id].floor_height;
+        open_ceiling = portals[portal_id].ceiling_height;
+    }
+
+    m_wall_x.push_back(start.x);
+    m_wall_z.push_back(start.z);
+    m_wall_dx.push_back(end.x - start.x);
+    m_wall_dz.push_back(end.z - start.z);
+    m_open_floor.push_back(open_floor);
+    m_open_ceiling.push_back(open_ceiling);
+}
+
+bool LineOfSight::is_visible(const Vector3& from, const Vector3& to) const {
+    if (m_nodes.empty()) {
+        return true;
+    }
+
+    float rx = to.x - from.x;
+    float ry = to.y - from.y;
+    float rz = to.z - from.z;
+    float lo_x = std::min(from.x, to.x);
+    float hi_x = std::max(from.x, to.x);
+    float lo_z = std::min(from.z, to.z);
+    float hi_z = std::max(from.z, to.z);
+
+    std::array<uint32_t, MAX_STACK> stack;
+    size_t stack_size = 0;
+    stack[stack_size++] = 0;
+
+    while (stack_size > 0) {
+        const Node& node = m_nodes[stack[--stack_size]];
+        if (lo_x > node.max_x || hi_x < node.min_x || lo_z > node.max_z || hi_z < node.min_z) {
+            continue;
+        }
+
+        for (uint32_t w = node.first_wall; w < node.wall_end; ++w) {
+            // Segment-segment intersection with both parameters in [0, 1];
+            // parallel walls give NaN or infinity and fail the range checks
+            float qx = m_wall_x[w] - from.x;
+            float qz = m_wall_z[w] - from.z;
+            float denom = rx * m_wall_dz[w] - rz * m_wall_dx[w];
+            float t = (qx * m_wall_dz[w] - qz * m_wall_dx[w]) / denom;
+            float u = (qx * rz - qz * rx) / denom;
+            if (!(t >= 0.0f && t <= 1.0f && u >= 0.0f && u <= 1.0f)) {
+                continue;
+            }
+
+            float y = from.y + t * ry;
+            if (!(y >= m_open_floor[w] && y <= m_open_ceiling[w])) {
+                return false;
+            }
+        }
+
+        if (node.front != BSP_NULL_NODE) {
+            stack[stack_size++] = node.front;
+        }
+        if (node.back != BSP_NULL_NODE) {
+            stack[stack_size++] = node.back;
+        }
+    }
+
+    return true;
+}
+
+template <typename Lanes>
+uint32_t LineOfSight::test_packet(const Vector3* from, const Vector3* to,
+                                  const uint32_t* pairs, int count) const {
+    using Float = typename Lanes::Float;
+    constexpr int WIDTH = Lanes::WIDTH;
+
+    // Transpose the pairs into lanes; unused lanes repeat the first pair
+    alignas(32) float px[WIDTH], py[WIDTH], pz[WIDTH];
+    alignas(32) float rx[WIDTH], ry[WIDTH], rz[WIDTH];
+    alignas(32) float lo_x[WIDTH], hi_x[WIDTH], lo_z[WIDTH], hi_z[WIDTH];
+    for (int i = 0; i < WIDTH; ++i) {
+        uint32_t k = pairs[(i < count) ? i : 0];
+        px[i] = from[k].x;
+        py[i] = from[k].y;
+        pz[i] = from[k].z;
+        rx[i] = to[k].x - from[k].x;
+        ry[i] = to[k].y - from[k].y;
+        rz[i] = to[k].z - from[k].z;
+        lo_x[i] = std::min(from[k].x, to[k].x);
+        hi_x[i] = std::max(from[k].x, to[k].x);
+        lo_z[i] = std::min(from[k].z, to[k].z);
+        hi_z[i] = std::max(from[k].z, to[k].z);
+    }
+
+    const Float PX = Lanes::load(px), PY = Lanes::load(py), PZ = Lanes::load(pz);
+    const Float RX = Lanes::load(rx), RY = Lanes::load(ry), RZ = Lanes::load(rz);
+    const Float LO_X = Lanes::load(lo_x), HI_X = Lanes::load(hi_x);
+    const Float LO_Z = Lanes::load(lo_z), HI_Z = Lanes::load(hi_z);
+    const Float ZERO = Lanes::set1(0.0f);
+    const Float ONE = Lanes::set1(1.0f);
+
+    uint32_t open = (1u << count) - 1u;
+
+    std::array<uint32_t, MAX_STACK> stack;
+    size_t stack_size = 0;
+    stack[stack_size++] = 0;
+
+    // Lanes drop out as they get blocked; the walk ends when none are left
+    while (stack_size > 0 && open != 0) {
+        const Node& node = m_nodes[stack[--stack_size]];
+
+        Float overlap = Lanes::both(
+            Lanes::both(Lanes::le(LO_X, Lanes::set1(node.max_x)),
+                        Lanes::ge(HI_X, Lanes::set1(node.min_x))),
+            Lanes::both(Lanes::le(LO_Z, Lanes::set1(node.max_z)),
+                        Lanes::ge(HI_Z, Lanes::set1(node.min_z))));
+        uint32_t lanes = Lanes::bits(overlap) & open;
+        if (lanes == 0) {
+            continue;
+        }
+
+        for (uint32_t w = node.first_wall; w < node.wall_end && lanes != 0; ++w) {
+            Float wall_dx = Lanes::set1(m_wall_dx[w]);
+            Float wall_dz = Lanes::set1(m_wall_dz[w]);
+            Float qx = Lanes::sub(Lanes::set1(m_wall_x[w]), PX);
+            Float qz = Lanes::sub(Lanes::set1(m_wall_z[w]), PZ);
+
+            Float denom = Lanes::sub(Lanes::mul(RX, wall_dz), Lanes::mul(RZ, wall_dx));
+            Float t = Lanes::div(Lanes::sub(Lanes::mul(qx, wall_dz), Lanes::mul(qz, wall_dx)), denom);
+            Float u = Lanes::div(Lanes::sub(Lanes::mul(qx, RZ), Lanes::mul(qz, RX)), denom);
+            Float crosses = Lanes::both(Lanes::both(Lanes::ge(t, ZERO), Lanes::le(t, ONE)),
+                                        Lanes::both(Lanes::ge(u, ZERO), Lanes::le(u, ONE)));
+
+            Float y = Lanes::add(PY, Lanes::mul(t, RY));
+            Float through = Lanes::both(Lanes::ge(y, Lanes::set1(m_open_floor[w])),
+                                        Lanes::le(y, Lanes::set1(m_open_ceiling[w])));
+
+            uint32_t blocked = Lanes::bits(crosses) & ~Lanes::bits(through) & lanes;
+            open &= ~blocked;
+            lanes &= ~blocked;
+        }
+
+        if (node.front != BSP_NULL_NODE) {
+            stack[stack_size++] = node.front;
+        }
+        if (node.back != BSP_NULL_NODE) {
+            stack[stack_size++] = node.back;
+        }
+    }
+
+    return open;
+}
+
+void LineOfSight::test(const Vector3* from, const Vector3* to, size_t count,
+                       std::vector<uint64_t>& visible) const {
+#if defined(LOS_PACKET_LANES)
+    visible.assign((count + 63) / 64, 0);
+    if (m_nodes.empty()) {
+        test_scalar(from, to, count, visible);
+        return;
+    }
+
+    // Lanes of a packet share one walk down the tree, so pairs that are
+    // far apart make every lane pay for the others' nodes. Bucket the
+    // pairs by the cell of their midpoint, in Morton order over a grid on
+    // the level, and fill packets from neighbouring pairs.
+    const Node& root = m_nodes[0];
+    float scale_x = GRID_SIZE / std::max(root.max_x - root.min_x, 1e-3f);
+    float scale_z = GRID_SIZE / std::max(root.max_z - root.min_z, 1e-3f);
+
+    std::vector<uint32_t> cells(count);
+    std::vector<uint32_t> starts(GRID_SIZE * GRID_SIZE + 1, 0);
+    for (size_t i = 0; i < count; ++i) {
+        float mid_x = (from[i].x + to[i].x) * 0.5f;
+        float mid_z = (from[i].z + to[i].z) * 0.5f;
+        uint32_t cell_x = static_cast<uint32_t>(std::clamp((mid_x - root.min_x) * scale_x, 0.0f, GRID_SIZE - 1.0f));
+        uint32_t cell_z = static_cast<uint32_t>(std::clamp((mid_z - root.min_z) * scale_z, 0.0f, GRID_SIZE - 1.0f));
+        cells[i] = interleave_bits(cell_x) | (interleave_bits(cell_z) << 1);
+        starts[cells[i] + 1]++;
+    }
+    for (size_t c = 1; c < starts.size(); ++c) {
+        starts[c] += starts[c - 1];
+    }
+    std::vector<uint32_t> order(count);
+    for (size_t i = 0; i < count; ++i) {
+        order[starts[cells[i]]++] = static_cast<uint32_t>(i);
+    }
+
+    constexpr size_t WIDTH = LOS_PACKET_LANES::WIDTH;
+    for (size_t base = 0; base < count; base += WIDTH) {
+        int lanes = static_cast<int>(std::min(WIDTH, count - base));
+        uint32_t bits = test_packet<LOS_PACKET_LANES>(from, to, &order[base], lanes);
+        for (int lane = 0; lane < lanes; ++lane) {
+            if (bits & (1u << lane)) {
+                uint32_t pair = order[base + lane];
+                visible[pair / 64] |= uint64_t(1) << (pair % 64);
+            }
+        }
+    }
+#else
+    test_scalar(from, to, count, visible);
+#endif
+}
+
+void LineOfSight::test_scalar(const Vector3* from, const Vector3* to, size_t count,
+                              std::vector<uint64_t>& visible) const {
+    visible.assign((count + 63) / 64, 0);
+    for (size_t i = 0; i < count; ++i) {
+        if (is_visible(from[i], to[i])) {
+            visible[i / 64] |= uint64_t(1) << (i % 64);
+        }
+    }
+}
+
+int LineOfSight::get_packet_width() {
+#if defined(LOS_PACKET_LANES)
+    return LOS_PACKET_LANES::WIDTH;
+#else
+    return 1;
+#endif
+}
+
+} // namespace game
@@ -0,0 +1,199 @@
+#include "game/portal_visibility.h"
+#include <algorithm>
+#include <cmath>
+
+namespace game {
+
+namespace {
+
+// Matches the camera's near clip distance
+constexpr float PORTAL_NEAR = 0.01f;
+
+// Narrowest window still worth walking through (in normalized screen x)
+constexpr float MIN_WINDOW_WIDTH = 1e-4f;
+
+// Sign of a sector's winding in the XZ plane, so "inside" is known per wall
+float sector_winding(const LevelGeometry& geometry, const Sector& sector) {
+    float area = 0.0f;
+    uint32_t count = sector.vertex_count;
+    for (uint32_t i = 0; i < count; ++i) {
+        Vertex a = geometry.get_vertex(sector, i);
+        Vertex b = geometry.get_vertex(sector, (i + 1) % count);
+        area += a.x * b.z - b.x * a.z;
+    }
+    return area >= 0.0f ? 1.0f : -1.0f;
+}
+
+float distance_to_segment_sq(float px, float pz, const Vertex& a, const Vertex& b) {
+    float dx = b.x - a.x;
+    float dz = b.z - a.z;
+    float length_sq = dx * dx + dz * dz;
+    float t = length_sq > 0.0f ? ((px - a.x) * dx + (pz - a.z) * dz) / length_sq : 0.0f;
+    t = std::clamp(t, 0.0f, 1.0f);
+    float ex = a.x + dx * t - px;
+    float ez = a.z + dz * t - pz;
+    return ex * ex + ez * ez;
+}
+
+} // namespace
+
+PortalVisibility::PortalVisibility()
+    : m_queue_head(0)
+    , m_generation(0) {
+}
+
+void PortalVisibility::enqueue(uint32_t sector, uint32_t depth, float left, float right) {
+    if (m_window_stamps[sector] == m_generation &&
+        left >= m_window_left[sector] && right <= m_window_right[sector]) {
+        return;
+    }
+    if (m_window_stamps[sector] != m_generation ||
+        right - left > m_window_right[sector] - m_window_left[sector]) {
+        m_window_stamps[sector] = m_generation;
+        m_window_left[sector] = left;
+        m_window_right[sector] = right;
+    }
+    m_queue.push_back(ClipWindow{sector, depth, left, right});
+}
+
+bool PortalVisibility::compute(const Level& level, const Vector3& position,
+                               const Vector3& forward, float fov_y, float aspect) {
+    m_visible_sectors.clear();
+    m_queue.clear();
+    m_queue_head = 0;
+    m_stats = PortalVisibilityStats();
+
+    const auto& sectors = level.get_sectors();
+    const LevelGeometry& geometry = level.get_geometry();
+    const auto& portals = level.get_portals();
+
+    int32_t camera_sector = level.find_sector_at_point(position.x, position.z);
+    if (camera_sector < 0) {
+        return false;
+    }
+
+    // Horizontal view basis. Pitch widens the view's footprint on the XZ
+    // plane, so bound the window by the frustum corners flattened onto it.
+    float flat_length = sqrtf(forward.x * forward.x + forward.z * forward.z);
+    if (flat_length < 1e-4f) {
+        return false;
+    }
+    float fx = forward.x / flat_length;
+    float fz = forward.z / flat_length;
+    float rx = -fz;
+    float rz = fx;
+
+    float half_height = tanf(fov_y * DEG2RAD * 0.5f);
+    float half_width = half_height * aspect;
+    float pitch_cos = flat_length;
+    float pitch_sin = forward.y;
+    float screen_scale = 0.0f;
+    for (int corner = 0; corner < 4; ++corner) {
+        float up_offset = (corner & 1) ? half_height : -half_height;
+        float side_offset = (corner & 2) ? half_width : -half_width;
+
+        // Corner ray in (right, flat forward) coordinates; the camera's
+        // up vector tilts back by the pitch
+        float depth = pitch_cos - up_offset * pitch_sin;
+        if (depth <= PORTAL_NEAR) {
+            return false;
+        }
+        screen_scale = std::max(screen_scale, fabsf(side_offset) / depth);
+    }
+
+    // Fresh marks per walk without clearing
+    if (m_marks.size() != sectors.size()) {
+        m_marks.assign(sectors.size(), 0);
+        m_window_left.assign(sectors.size(), 0.0f);
+        m_window_right.assign(sectors.size(), 0.0f);
+        m_window_stamps.assign(sectors.size(), 0);
+        m_generation = 0;
+    }
+    m_generation++;
+
+    enqueue(static_cast<uint32_t>(camera_sector), 0, -1.0f, 1.0f);
+
+    while (m_queue_head < m_queue.size()) {
+        // Copy out; enqueue may reallocate the queue
+        ClipWindow window = m_queue[m_queue_head++];
+        m_stats.windows_processed++;
+
+        if (m_marks[window.sector] != m_generation) {
+            m_marks[window.sector] = m_generation;
+            m_visible_sectors.push_back(window.sector);
+        }
+
+        if (window.depth >= MAX_PORTAL_DEPTH) {
+            continue;
+        }
+
+        const Sector& sector = sectors[window.sector];
+        float winding = sector_winding(geometry, sector);
+
+        for (uint32_t w = 0; w < sector.wall_count; ++w) {
+            Wall wall = geometry.get_wall(sector, w);
+            if (wall.portal_id < 0 || static_cast<size_t>(wall.portal_id) >= portals.size()) {
+                continue;
+            }
+            const Portal& portal = portals[wall.portal_id];
+            if (portal.target_sector >= sectors.size() ||
+                portal.ceiling_height <= portal.floor_height) {
+                continue;
+            }
+            m_stats.portals_tested++;
+
+            Vertex a = geometry.get_vertex(sector, wall.vertex_a);
+            Vertex b = geometry.get_vertex(sector, wall.vertex_b);
+
+            // Standing in the opening: everything through it is in view
+            if (distance_to_segment_sq(position.x, position.z, a, b) < PORTAL_NEAR * PORTAL_NEAR) {
+                m_stats.portals_passed++;
+                enqueue(portal.target_sector, window.depth + 1, window.left, window.right);
+                continue;
+            }
+
+            // Openings are only seen from the inside of their sector
+            float side = (b.x - a.x) * (position.z - a.z) - (b.z - a.z) * (position.x - a.x);
+            if (side * winding <= 0.0f) {
+                continue;
+            }
+
+            // Camera space: lateral offset and depth along the flat view
+            float ax = (a.x - position.x) * rx + (a.z - position.z) * rz;
+            float ad = (a.x - position.x) * fx + (a.z - position.z) * fz;
+            float bx = (b.x - position.x) * rx + (b.z - position.z) * rz;
+            float bd = (b.x - position.x) * fx + (b.z - position.z) * fz;
+
+            // Clip against the near plane
+            if (ad < PORTAL_NEAR && bd < PORTAL_NEAR) {
+                continue;
+            }
+            if (ad < PORTAL_NEAR) {
+                float t = (PORTAL_NEAR - ad) / (bd - ad);
+                ax += (bx - ax) * t;
+                ad = PORTAL_NEAR;
+            } else if (bd < PORTAL_NEAR) {
+                float t = (PORTAL_NEAR - bd) / (ad - bd);
+                bx += (ax - bx) * t;
+                bd = PORTAL_NEAR;
+            }
+
+            // Project and narrow the window to the opening
+            float screen_a = ax / (ad * screen_scale);
+            float screen_b = bx / (bd * screen_scale);
+            float left = std::max(window.left, std::min(screen_a, screen_b));
+            float right = std::min(window.right, std::max(screen_a, screen_b));
+            if (right - left <= MIN_WINDOW_WIDTH) {
+                continue;
+            }
+
+            m_stats.portals_passed++;
+            enqueue(portal.target_sector, window.depth + 1, left, right);
+        }
+    }
+
+    m_stats.sectors_visible = static_cast<uint32_t>(m_visible_sectors.size());
+    return true;
+}
+
+} // namespace game
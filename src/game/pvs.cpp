@@ -0,0 +1,407 @@
+#include "game/pvs.h"
+#include "game/bsp.h"
+#include "platform/thread_pool.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace game {
+
+namespace {
+
+// Part of a portal, as a parameter range along a -> b
+struct PortalWindow {
+    uint32_t portal;
+    float t0;
+    float t1;
+};
+
+constexpr float FLOW_EPSILON = 0.001f;
+
+Vertex window_point(const PVSPortal& portal, float t) {
+    return Vertex(portal.a.x + (portal.b.x - portal.a.x) * t,
+                  portal.a.z + (portal.b.z - portal.a.z) * t);
+}
+
+// Per-thread state for flowing visibility out of one source sector
+class PortalFlow {
+public:
+    PortalFlow(const std::vector<PVSPortal>& portals,
+               const std::vector<uint32_t>& sector_first_portal,
+               size_t sector_count)
+        : m_portals(portals)
+        , m_sector_first_portal(sector_first_portal)
+        , m_bits((sector_count + 7) / 8, 0)
+        , m_best_t0(portals.size(), 0.0f)
+        , m_best_t1(portals.size(), 0.0f)
+        , m_stamp(portals.size(), 0)
+        , m_generation(0)
+        , m_sector_count(static_cast<uint32_t>(sector_count))
+        , m_overflow(false) {}
+
+    // Flow from every portal of a sector and leave the result in get_bits()
+    void flow_from_sector(uint32_t sector) {
+        std::fill(m_bits.begin(), m_bits.end(), 0);
+        m_overflow = false;
+        mark(sector);
+
+        for (uint32_t p = m_sector_first_portal[sector]; p < m_sector_first_portal[sector + 1]; ++p) {
+            const PVSPortal& source = m_portals[p];
+            mark(source.target_sector);
+
+            // Windows seen through an earlier pass are only valid for the
+            // same source portal
+            m_generation++;
+
+            // Everything inside the neighbour is visible through the source
+            // portal, so its own portals are the first pass windows
+            uint32_t next = source.target_sector;
+            for (uint32_t q = m_sector_first_portal[next]; q < m_sector_first_portal[next + 1]; ++q) {
+                if (same_segment(m_portals[q], source)) {
+                    continue;
+                }
+                flow(source, PortalWindow{q, 0.0f, 1.0f});
+            }
+        }
+
+        if (m_overflow) {
+            for (uint32_t i = 0; i < m_sector_count; ++i) {
+                mark(i);
+            }
+        }
+    }
+
+    const std::vector<uint8_t>& get_bits() const { return m_bits; }
+
+private:
+    const std::vector<PVSPortal>& m_portals;
+    const std::vector<uint32_t>& m_sector_first_portal;
+    std::vector<uint8_t> m_bits;
+
+    // Widest window already flowed through each portal for the current
+    // source portal. Visibility only grows with the window, so a window
+    // inside one already flowed cannot add anything.
+    std::vector<float> m_best_t0;
+    std::vector<float> m_best_t1;
+    std::vector<uint32_t> m_stamp;
+    uint32_t m_generation;
+
+    // A straight sight line enters each convex sector at most once, so no
+    // real chain of portals is longer than the sector count. Longer chains
+    // only come from the separators being looser than a single line; if
+    // one is cut off the row falls back to everything visible.
+    uint32_t m_sector_count;
+    bool m_overflow;
+
+    // Explicit walk stack; chains through open maps run hundreds deep
+    struct FlowFrame {
+        uint32_t portal;
+        uint32_t depth;
+        uint32_t next;          // Next portal of the pass sector to try
+        Vertex pass_a;
+        Vertex pass_b;
+    };
+    std::vector<FlowFrame> m_stack;
+
+    void mark(uint32_t sector) {
+        m_bits[sector >> 3] |= static_cast<uint8_t>(1u << (sector & 7));
+    }
+
+    static bool same_segment(const PVSPortal& a, const PVSPortal& b) {
+        auto near = [](const Vertex& u, const Vertex& v) {
+            return fabsf(u.x - v.x) < FLOW_EPSILON && fabsf(u.z - v.z) < FLOW_EPSILON;
+        };
+        return (near(a.a, b.a) && near(a.b, b.b)) || (near(a.a, b.b) && near(a.b, b.a));
+    }
+
+    // Mark the sector behind a pass window and queue its portals, unless
+    // an earlier pass already covered the window
+    void enter(const PortalWindow& pass, uint32_t depth) {
+        const PVSPortal& pass_portal = m_portals[pass.portal];
+        mark(pass_portal.target_sector);
+
+        if (depth >= m_sector_count) {
+            m_overflow = true;
+            return;
+        }
+
+        uint32_t p = pass.portal;
+        if (m_stamp[p] == m_generation &&
+            pass.t0 >= m_best_t0[p] && pass.t1 <= m_best_t1[p]) {
+            return;
+        }
+        if (m_stamp[p] != m_generation ||
+            pass.t1 - pass.t0 > m_best_t1[p] - m_best_t0[p]) {
+            m_stamp[p] = m_generation;
+            m_best_t0[p] = pass.t0;
+            m_best_t1[p] = pass.t1;
+        }
+
+        m_stack.push_back(FlowFrame{p, depth,
+                                    m_sector_first_portal[pass_portal.target_sector],
+                                    window_point(pass_portal, pass.t0),
+                                    window_point(pass_portal, pass.t1)});
+    }
+
+    // Depth-first flow from a source portal through a first pass window
+    void flow(const PVSPortal& source, const PortalWindow& first_pass) {
+        m_stack.clear();
+        enter(first_pass, 1);
+
+        while (!m_stack.empty()) {
+            FlowFrame& frame = m_stack.back();
+            const PVSPortal& pass_portal = m_portals[frame.portal];
+            uint32_t end = m_sector_first_portal[pass_portal.target_sector + 1];
+            if (frame.next >= end) {
+                m_stack.pop_back();
+                continue;
+            }
+
+            uint32_t q = frame.next++;
+            if (same_segment(m_portals[q], pass_portal)) {
+                continue;
+            }
+
+            PortalWindow target{q, 0.0f, 1.0f};
+            if (clip_to_separators(source, frame.pass_a, frame.pass_b, target)) {
+                enter(target, frame.depth + 1);
+            }
+        }
+    }
+
+    // Cut the target window down to the region reachable by straight lines
+    // through both the source portal and the pass window. That region is
+    // bounded by the lines joining a source endpoint to a pass endpoint
+    // with the other two endpoints on opposite sides.
+    bool clip_to_separators(const PVSPortal& source,
+                            const Vertex& pass_a, const Vertex& pass_b,
+                            PortalWindow& target) const {
+        const PVSPortal& portal = m_portals[target.portal];
+        const Vertex source_points[2] = {source.a, source.b};
+        const Vertex pass_points[2] = {pass_a, pass_b};
+
+        for (int i = 0; i < 2; ++i) {
+            for (int j = 0; j < 2; ++j) {
+                const Vertex& s = source_points[i];
+                const Vertex& p = pass_points[j];
+                float dx = p.x - s.x;
+                float dz = p.z - s.z;
+                if (dx * dx + dz * dz < FLOW_EPSILON * FLOW_EPSILON) {
+                    continue;
+                }
+
+                auto side = [&](const Vertex& v) {
+                    return dx * (v.z - s.z) - dz * (v.x - s.x);
+                };
+
+                float source_side = side(source_points[1 - i]);
+                float pass_side = side(pass_points[1 - j]);
+                if (source_side * pass_side >= 0.0f) {
+                    continue;  // Not a separator
+                }
+
+                // Keep the part of the target on the pass side
+                float keep = (pass_side > 0.0f) ? 1.0f : -1.0f;
+                float f0 = side(portal.a) * keep;
+                float f1 = side(portal.b) * keep;
+                float at_t0 = f0 + (f1 - f0) * target.t0;
+                float at_t1 = f0 + (f1 - f0) * target.t1;
+
+                if (at_t0 < -FLOW_EPSILON && at_t1 < -FLOW_EPSILON) {
+                    return false;
+                }
+                if (at_t0 < -FLOW_EPSILON || at_t1 < -FLOW_EPSILON) {
+                    float t_cross = f0 / (f0 - f1);
+                    if (at_t0 < -FLOW_EPSILON) {
+                        target.t0 = t_cross;
+                    } else {
+                        target.t1 = t_cross;
+                    }
+                }
+            }
+        }
+
+        return target.t1 - target.t0 > FLOW_EPSILON;
+    }
+};
+
+} // namespace
+
+PotentiallyVisibleSet::PotentiallyVisibleSet()
+    : m_sector_count(0) {
+}
+
+void PotentiallyVisibleSet::gather_portals(const Level& level, PVSPortals& out) {
+    const auto& sectors = level.get_sectors();
+    const LevelGeometry& geometry = level.get_geometry();
+    const auto& portals = level.get_portals();
+    out.sector_count = static_cast<uint32_t>(sectors.size());
+    out.portals.clear();
+    out.sector_first_portal.assign(sectors.size() + 1, 0);
+
+    for (size_t i = 0; i < sectors.size(); ++i) {
+        out.sector_first_portal[i] = static_cast<uint32_t>(out.portals.size());
+        const Sector& sector = sectors[i];
+        for (uint32_t w = 0; w < sector.wall_count; ++w) {
+            Wall wall = geometry.get_wall(sector, w);
+            if (wall.portal_id < 0 || static_cast<size_t>(wall.portal_id) >= portals.size()) {
+                continue;
+            }
+            uint32_t target = portals[wall.portal_id].target_sector;
+            if (target >= sectors.size()) {
+                continue;
+            }
+            out.portals.push_back(PVSPortal{geometry.get_vertex(sector, wall.vertex_a),
+                                            geometry.get_vertex(sector, wall.vertex_b),
+                                            target});
+        }
+    }
+    out.sector_first_portal[sectors.size()] = static_cast<uint32_t>(out.portals.size());
+}
+
+void PotentiallyVisibleSet::build(const Level& level, const BSPTree& bsp_tree) {
+    PVSPortals portals;
+    gather_portals(level, portals);
+    build(portals, bsp_tree);
+}
+
+void PotentiallyVisibleSet::build(const PVSPortals& portals, const BSPTree& bsp_tree) {
+    auto start_time = std::chrono::steady_clock::now();
+
+    const size_t sector_count = portals.sector_count;
+    const std::vector<PVSPortal>& portal_segments = portals.portals;
+    const std::vector<uint32_t>& sector_first_portal = portals.sector_first_portal;
+    m_sector_count = portals.sector_count;
+    m_stats = PVSBuildStats();
+
+    // Sector-to-sector visibility, one compressed row per source sector
+    std::vector<std::vector<uint8_t>> sector_rows(sector_count);
+    platform::ThreadPool::get_shared().parallel_for(sector_count, 16,
+        [&](size_t begin, size_t end) {
+            PortalFlow flow(portal_segments, sector_first_portal, sector_count);
+            for (size_t i = begin; i < end; ++i) {
+                flow.flow_from_sector(static_cast<uint32_t>(i));
+                compress_row(flow.get_bits(), sector_rows[i]);
+            }
+        });
+
+    // A leaf sees whatever any sector with a fragment in it sees. Most
+    // leaves hold one sector and reuse its row as is.
+    const auto& nodes = bsp_tree.get_nodes();
+    const auto& subsectors = bsp_tree.get_subsectors();
+    size_t row_bytes = (sector_count + 7) / 8;
+    std::vector<std::vector<uint8_t>> leaf_rows(nodes.size());
+
+    platform::ThreadPool::get_shared().parallel_for(nodes.size(), 64,
+        [&](size_t begin, size_t end) {
+            std::vector<uint8_t> bits;
+            for (size_t n = begin; n < end; ++n) {
+                const BSPNode& node = nodes[n];
+                if (!node.is_leaf() || node.subsector_count == 0) {
+                    continue;
+                }
+
+                uint32_t first_sector = subsectors[node.first_subsector].sector;
+                bool single_sector = true;
+                for (uint32_t i = 1; i < node.subsector_count; ++i) {
+                    single_sector &= subsectors[node.first_subsector + i].sector == first_sector;
+                }
+                if (single_sector) {
+                    leaf_rows[n] = sector_rows[first_sector];
+                    continue;
+                }
+
+                bits.assign(row_bytes, 0);
+                for (uint32_t i = 0; i < node.subsector_count; ++i) {
+                    uint32_t sector = subsectors[node.first_subsector + i].sector;
+                    const std::vector<uint8_t>& row = sector_rows[sector];
+                    for_each_in_row(row.data(), row.data() + row.size(), portals.sector_count,
+                                    [&bits](uint32_t visible) {
+                        bits[visible >> 3] |= static_cast<uint8_t>(1u << (visible & 7));
+                    });
+                }
+                compress_row(bits, leaf_rows[n]);
+            }
+        });
+
+    // Pack rows back to back
+    m_backing.reset();
+    m_rows.clear();
+    m_row_offsets.assign(nodes.size() + 1, 0);
+    for (size_t n = 0; n < nodes.size(); ++n) {
+        m_row_offsets[n] = static_cast<uint32_t>(m_rows.size());
+        m_rows.append(leaf_rows[n].begin(), leaf_rows[n].end());
+        if (nodes[n].is_leaf()) {
+            m_stats.leaf_count++;
+        }
+    }
+    m_row_offsets[nodes.size()] = static_cast<uint32_t>(m_rows.size());
+
+    for (size_t n = 0; n < nodes.size(); ++n) {
+        for_each_visible(static_cast<uint32_t>(n), [this](uint32_t) {
+            m_stats.visible_pairs++;
+        });
+    }
+    m_stats.compressed_bytes = m_rows.size();
+    m_stats.uncompressed_bytes = static_cast<size_t>(m_stats.leaf_count) * row_bytes;
+    m_stats.build_time_ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start_time).count();
+}
+
+void PotentiallyVisibleSet::attach(std::shared_ptr<const void> backing,
+                                   const uint8_t* rows, size_t row_bytes,
+                                   const uint32_t* row_offsets, size_t row_offset_count,
+                                   uint32_t sector_count, const PVSBuildStats& stats) {
+    m_backing = std::move(backing);
+    m_rows.borrow(rows, row_bytes);
+    m_row_offsets.borrow(row_offsets, row_offset_count);
+    m_sector_count = sector_count;
+    m_stats = stats;
+}
+
+bool PotentiallyVisibleSet::rows_in_range() const {
+    for (size_t n = 0; n + 1 < m_row_offsets.size(); ++n) {
+        if (m_row_offsets[n] > m_row_offsets[n + 1] || m_row_offsets[n + 1] > m_rows.size() ||
+            !for_each_in_row(m_rows.data() + m_row_offsets[n], m_rows.data() + m_row_offsets[n + 1],
+                             m_sector_count, [](uint32_t) {})) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void PotentiallyVisibleSet::get_visible_sectors(uint32_t leaf_node,
+                                                std::vector<uint32_t>& visible_sectors) const {
+    visible_sectors.clear();
+    for_each_visible(leaf_node, [&visible_sectors](uint32_t sector) {
+        visible_sectors.push_back(sector);
+    });
+}
+
+void PotentiallyVisibleSet::compress_row(const std::vector<uint8_t>& bits,
+                                         std::vector<uint8_t>& out) {
+    out.clear();
+
+    for (size_t i = 0; i < bits.size(); ++i) {
+        if (bits[i] != 0) {
+            out.push_back(bits[i]);
+            continue;
+        }
+
+        // Count the zero run, capped at what fits in a byte
+        size_t run = 1;
+        while (i + run < bits.size() && bits[i + run] == 0 && run < 255) {
+            run++;
+        }
+
+        // A run to the end of the row says nothing; leave it out
+        if (i + run == bits.size()) {
+            break;
+        }
+        out.push_back(0);
+        out.push_back(static_cast<uint8_t>(run));
+        i += run - 1;
+    }
+}
+
+} // namespace game
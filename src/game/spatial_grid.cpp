@@ -0,0 +1,201 @@
+#include "game/spatial_grid.h"
+#include "platform/thread_pool.h"
+#include <limits>
+
+namespace game {
+
+namespace {
+
+// Sectors per thread pool task when computing bounds
+constexpr size_t BOUNDS_GRAIN = 4096;
+
+// Changed sectors checked one by one before the grid is rebuilt: at least
+// this many, or this fraction of the level
+constexpr size_t MIN_CHANGED_BEFORE_REBUILD = 64;
+constexpr size_t CHANGED_FRACTION = 32;
+
+// Upper limit on cells per sector, so a few huge sectors can't make the
+// auto-picked cell size tiny
+constexpr size_t MAX_CELLS_PER_SECTOR = 4;
+
+} // namespace
+
+SpatialGrid::SpatialGrid()
+    : m_origin_x(0.0f)
+    , m_origin_z(0.0f)
+    , m_cell_size(1.0f)
+    , m_inverse_cell_size(1.0f)
+    , m_width(0)
+    , m_height(0) {
+}
+
+void SpatialGrid::set_sector_bounds(const Level& level, uint32_t index) {
+    const LevelGeometry& geometry = level.get_geometry();
+    const Sector& sector = level.get_sector(index);
+    float* bounds = &m_sector_bounds[static_cast<size_t>(index) * 4];
+    bounds[0] = std::numeric_limits<float>::max();
+    bounds[1] = std::numeric_limits<float>::max();
+    bounds[2] = -std::numeric_limits<float>::max();
+    bounds[3] = -std::numeric_limits<float>::max();
+    for (uint32_t i = 0; i < sector.vertex_count; ++i) {
+        Vertex vertex = geometry.get_vertex(sector, i);
+        bounds[0] = std::min(bounds[0], vertex.x);
+        bounds[1] = std::min(bounds[1], vertex.z);
+        bounds[2] = std::max(bounds[2], vertex.x);
+        bounds[3] = std::max(bounds[3], vertex.z);
+    }
+}
+
+void SpatialGrid::build(const Level& level, float cell_size) {
+    const auto& sectors = level.get_sectors();
+    const uint32_t sector_count = static_cast<uint32_t>(sectors.size());
+
+    m_sector_bounds.resize(static_cast<size_t>(sector_count) * 4);
+    platform::ThreadPool::get_shared().parallel_for(sector_count, BOUNDS_GRAIN,
+        [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                set_sector_bounds(level, static_cast<uint32_t>(i));
+            }
+        });
+
+    // Level extent and mean sector size
+    float min_x = std::numeric_limits<float>::max();
+    float min_z = std::numeric_limits<float>::max();
+    float max_x = -std::numeric_limits<float>::max();
+    float max_z = -std::numeric_limits<float>::max();
+    double extent_sum = 0.0;
+    uint32_t counted = 0;
+    for (uint32_t i = 0; i < sector_count; ++i) {
+        const float* bounds = &m_sector_bounds[static_cast<size_t>(i) * 4];
+        if (bounds[0] > bounds[2]) {
+            continue;   // No outline
+        }
+        min_x = std::min(min_x, bounds[0]);
+        min_z = std::min(min_z, bounds[1]);
+        max_x = std::max(max_x, bounds[2]);
+        max_z = std::max(max_z, bounds[3]);
+        extent_sum += std::max(bounds[2] - bounds[0], bounds[3] - bounds[1]);
+        counted++;
+    }
+    if (counted == 0) {
+        min_x = min_z = 0.0f;
+        max_x = max_z = 1.0f;
+    }
+    if (cell_size <= 0.0f) {
+        cell_size = counted > 0 ? static_cast<float>(extent_sum / counted) : 1.0f;
+    }
+    cell_size = std::max(cell_size, 1e-3f);
+
+    // Grow the cells if there would be far more of them than sectors
+    double span_x = static_cast<double>(max_x) - min_x;
+    double span_z = static_cast<double>(max_z) - min_z;
+    double max_cells = static_cast<double>(std::max<size_t>(sector_count, 1)) * MAX_CELLS_PER_SECTOR;
+    double cells = (span_x / cell_size + 1.0) * (span_z / cell_size + 1.0);
+    if (cells > max_cells) {
+        cell_size *= static_cast<float>(std::sqrt(cells / max_cells));
+    }
+
+    m_origin_x = min_x;
+    m_origin_z = min_z;
+    m_cell_size = cell_size;
+    m_inverse_cell_size = 1.0f / cell_size;
+    m_width = static_cast<uint32_t>(span_x / cell_size) + 1;
+    m_height = static_cast<uint32_t>(span_z / cell_size) + 1;
+    size_t cell_count = static_cast<size_t>(m_width) * m_height;
+
+    // Sectors: count per cell, prefix sum, fill
+    m_sector_offsets.assign(cell_count + 1, 0);
+    for (uint32_t i = 0; i < sector_count; ++i) {
+        const float* bounds = &m_sector_bounds[static_cast<size_t>(i) * 4];
+        if (bounds[0] > bounds[2]) {
+            continue;
+        }
+        for (uint32_t cz = cell_z(bounds[1]); cz <= cell_z(bounds[3]); ++cz) {
+            for (uint32_t cx = cell_x(bounds[0]); cx <= cell_x(bounds[2]); ++cx) {
+                m_sector_offsets[cz * m_width + cx + 1]++;
+            }
+        }
+    }
+    for (size_t cell = 0; cell < cell_count; ++cell) {
+        m_sector_offsets[cell + 1] += m_sector_offsets[cell];
+    }
+    m_sector_ids.resize(m_sector_offsets[cell_count]);
+    std::vector<uint32_t> cursor(m_sector_offsets.begin(), m_sector_offsets.end() - 1);
+    for (uint32_t i = 0; i < sector_count; ++i) {
+        const float* bounds = &m_sector_bounds[static_cast<size_t>(i) * 4];
+        if (bounds[0] > bounds[2]) {
+            continue;
+        }
+        for (uint32_t cz = cell_z(bounds[1]); cz <= cell_z(bounds[3]); ++cz) {
+            for (uint32_t cx = cell_x(bounds[0]); cx <= cell_x(bounds[2]); ++cx) {
+                m_sector_ids[cursor[cz * m_width + cx]++] = i;
+            }
+        }
+    }
+
+    // Walls the same way
+    m_wall_sector.assign(level.get_geometry().wall_vertex_a.size(),
+                         std::numeric_limits<uint32_t>::max());
+    m_wall_offsets.assign(cell_count + 1, 0);
+    float bounds[4];
+    for (uint32_t i = 0; i < sector_count; ++i) {
+        const Sector& sector = sectors[i];
+        for (uint32_t wall = sector.first_wall; wall < sector.first_wall + sector.wall_count; ++wall) {
+            m_wall_sector[wall] = i;
+            wall_bounds(level, i, wall, bounds);
+            for (uint32_t cz = cell_z(bounds[1]); cz <= cell_z(bounds[3]); ++cz) {
+                for (uint32_t cx = cell_x(bounds[0]); cx <= cell_x(bounds[2]); ++cx) {
+                    m_wall_offsets[cz * m_width + cx + 1]++;
+                }
+            }
+        }
+    }
+    for (size_t cell = 0; cell < cell_count; ++cell) {
+        m_wall_offsets[cell + 1] += m_wall_offsets[cell];
+    }
+    m_wall_ids.resize(m_wall_offsets[cell_count]);
+    cursor.assign(m_wall_offsets.begin(), m_wall_offsets.end() - 1);
+    for (uint32_t i = 0; i < sector_count; ++i) {
+        const Sector& sector = sectors[i];
+        for (uint32_t wall = sector.first_wall; wall < sector.first_wall + sector.wall_count; ++wall) {
+            wall_bounds(level, i, wall, bounds);
+            for (uint32_t cz = cell_z(bounds[1]); cz <= cell_z(bounds[3]); ++cz) {
+                for (uint32_t cx = cell_x(bounds[0]); cx <= cell_x(bounds[2]); ++cx) {
+                    m_wall_ids[cursor[cz * m_width + cx]++] = wall;
+                }
+            }
+        }
+    }
+
+    m_changed.clear();
+    m_is_changed.assign(sector_count, 0);
+}
+
+void SpatialGrid::update_sector(const Level& level, uint32_t index) {
+    if (!is_built() || index >= level.get_sectors().size()) {
+        return;
+    }
+
+    if (index >= m_is_changed.size()) {
+        m_is_changed.resize(static_cast<size_t>(index) + 1, 0);
+        m_sector_bounds.resize(static_cast<size_t>(index + 1) * 4);
+    }
+    set_sector_bounds(level, index);
+    if (!m_is_changed[index]) {
+        m_is_changed[index] = 1;
+        m_changed.push_back(index);
+    }
+
+    size_t limit = std::max(MIN_CHANGED_BEFORE_REBUILD, level.get_sectors().size() / CHANGED_FRACTION);
+    if (m_changed.size() > limit) {
+        build(level, m_cell_size);
+    }
+}
+
+size_t SpatialGrid::get_memory_bytes() const {
+    return (m_sector_offsets.capacity() + m_sector_ids.capacity() + m_wall_offsets.capacity() +
+            m_wall_ids.capacity() + m_wall_sector.capacity() + m_changed.capacity()) * sizeof(uint32_t) +
+           m_sector_bounds.capacity() * sizeof(float) + m_is_changed.capacity();
+}
+
+} // namespace game
@@ -0,0 +1,69 @@
+#include "game/visibility_query.h"
+#include "game/pvs.h"
+#include <algorithm>
+
+namespace game {
+
+VisibilityQuery::VisibilityQuery()
+    : m_generation(0)
+    , m_pvs_culled(0) {
+}
+
+core::Span<const uint32_t> VisibilityQuery::run(const Level& level, const Frustum& frustum,
+                                                bool use_pvs) {
+    m_subsectors.clear();
+    m_sectors.clear();
+    m_cull_stats = BSPCullStats();
+    m_pvs_culled = 0;
+
+    const BSPTree* bsp_tree = level.get_bsp_tree();
+    if (!bsp_tree || !bsp_tree->is_built()) {
+        return get_sectors();
+    }
+
+    // Marks only need resetting when the level changes size, or once the
+    // generation counter wraps around
+    size_t sector_count = level.get_sectors().size();
+    if (m_sector_marks.size() != sector_count || m_generation == UINT32_MAX) {
+        m_pvs_marks.assign(sector_count, 0);
+        m_sector_marks.assign(sector_count, 0);
+        m_generation = 0;
+    }
+    m_generation++;
+
+    bsp_tree->get_visible_subsectors(frustum, m_subsectors, &m_cull_stats);
+
+    // Mark what the PVS says can be seen from the viewer's leaf
+    const PotentiallyVisibleSet* pvs = level.get_pvs();
+    const Vector3& position = frustum.get_position();
+    uint32_t leaf = bsp_tree->find_leaf(position.x, position.z);
+    use_pvs = use_pvs && pvs && pvs->is_built() && leaf != BSP_NULL_NODE &&
+              pvs->get_sector_count() == sector_count;
+    if (use_pvs) {
+        uint32_t generation = m_generation;
+        pvs->for_each_visible(leaf, [this, generation](uint32_t sector) {
+            m_pvs_marks[sector] = generation;
+        });
+    }
+
+    // Filter in place and collect each sector at its nearest fragment
+    size_t kept = 0;
+    for (uint32_t index : m_subsectors) {
+        uint32_t sector = bsp_tree->get_subsector(index).sector;
+        if (sector >= sector_count || (use_pvs && m_pvs_marks[sector] != m_generation)) {
+            m_pvs_culled++;
+            continue;
+        }
+        m_subsectors[kept++] = index;
+
+        if (m_sector_marks[sector] != m_generation) {
+            m_sector_marks[sector] = m_generation;
+            m_sectors.push_back(sector);
+        }
+    }
+    m_subsectors.resize(kept);
+
+    return get_sectors();
+}
+
+} // namespace game
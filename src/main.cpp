@@ -1,6 +1,7 @@
 #include "core/application.h"
+#include <cstring>
 
-int main() {
+int main(int argc, char** argv) {
     // Configure application
     core::Application::Config config;
     config.window_title = "Yoshi's Wrath";
@@ -9,6 +10,11 @@ int main() {
     config.target_fps = 60;
     config.fullscreen = false;
 
+    // --stream plays a streamed generated world instead of the test level
+    for (int i = 1; i < argc; ++i) {
+        config.streaming = config.streaming || strcmp(argv[i], "--stream") == 0;
+    }
+
     // Create and run application
     core::Application app(config);
     return app.run();
@@ -38,6 +38,9 @@ InputState RaylibInputProvider::get_current_state() const {
     // Pause
     state.pause = IsKeyPressed(KEY_ESCAPE);
 
+    // Debug
+    state.toggle_visibility = IsKeyPressed(KEY_F2);
+
     return state;
 }
 
@@ -0,0 +1,220 @@
+#include "platform/thread_pool.h"
+#include <algorithm>
+#include <memory>
+
+namespace platform {
+
+namespace {
+
+// Pool and worker index of the current thread, if it is a pool worker
+thread_local const void* t_worker_pool = nullptr;
+thread_local size_t t_worker_index = 0;
+
+} // namespace
+
+ThreadPool::ThreadPool(size_t worker_count)
+    : m_queued_count(0)
+    , m_next_queue(0)
+    , m_stopping(false) {
+    if (worker_count == 0) {
+        size_t hardware = std::thread::hardware_concurrency();
+        worker_count = (hardware > 1) ? hardware - 1 : 1;
+    }
+
+    // All queues exist before any worker starts looking at them
+    m_queues.reserve(worker_count);
+    for (size_t i = 0; i < worker_count; ++i) {
+        m_queues.push_back(std::make_unique<WorkerQueue>());
+    }
+
+    m_workers.reserve(worker_count);
+    for (size_t i = 0; i < worker_count; ++i) {
+        m_workers.emplace_back([this, i]() { worker_loop(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_condition.notify_all();
+
+    for (auto& worker : m_workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    // Workers keep their own tasks close; outside callers spread theirs
+    size_t queue = current_worker();
+    if (queue == m_queues.size()) {
+        queue = m_next_queue.fetch_add(1) % m_queues.size();
+    }
+
+    // Count first so the count never drops below the number of queued tasks
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queued_count.fetch_add(1);
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_queues[queue]->mutex);
+        m_queues[queue]->tasks.push_back(std::move(task));
+    }
+    m_condition.notify_one();
+}
+
+void ThreadPool::parallel_for(size_t count, size_t grain_size,
+                              const std::function<void(size_t, size_t)>& body) {
+    if (count == 0) {
+        return;
+    }
+
+    grain_size = std::max<size_t>(grain_size, 1);
+    size_t chunk_count = (count + grain_size - 1) / grain_size;
+
+    // Small jobs are not worth waking anyone up for
+    if (chunk_count == 1 || m_workers.empty()) {
+        body(0, count);
+        return;
+    }
+
+    // Shared between caller and helpers; helpers may still be queued when
+    // the caller returns, so they keep the state alive themselves
+    struct Job {
+        std::atomic<size_t> next_chunk{0};
+        std::atomic<size_t> done_chunks{0};
+        std::mutex mutex;
+        std::condition_variable finished;
+    };
+    auto job = std::make_shared<Job>();
+
+    // Each participant claims chunks until none are left
+    auto run_chunks = [job, count, grain_size, chunk_count, &body]() {
+        size_t completed = 0;
+        for (size_t chunk = job->next_chunk.fetch_add(1); chunk < chunk_count;
+             chunk = job->next_chunk.fetch_add(1)) {
+            size_t begin = chunk * grain_size;
+            size_t end = std::min(begin + grain_size, count);
+            body(begin, end);
+            ++completed;
+        }
+        if (completed > 0 &&
+            job->done_chunks.fetch_add(completed) + completed == chunk_count) {
+            std::lock_guard<std::mutex> lock(job->mutex);
+            job->finished.notify_all();
+        }
+    };
+
+    // Helpers only touch body while unclaimed chunks remain, and the caller
+    // cannot return before every chunk has completed, so the reference is safe
+    size_t helper_count = std::min(m_workers.size(), chunk_count - 1);
+    for (size_t i = 0; i < helper_count; ++i) {
+        submit(run_chunks);
+    }
+
+    run_chunks();
+
+    std::unique_lock<std::mutex> lock(job->mutex);
+    job->finished.wait(lock, [&job, chunk_count]() {
+        return job->done_chunks.load() == chunk_count;
+    });
+}
+
+void ThreadPool::fork_join(const std::function<void()>& first,
+                           const std::function<void()>& second) {
+    if (m_workers.empty()) {
+        first();
+        second();
+        return;
+    }
+
+    // Whoever claims first runs it. The queued task may only get looked at
+    // after this call returned, so it keeps the state alive itself.
+    struct Fork {
+        std::atomic<bool> claimed{false};
+        std::atomic<bool> done{false};
+    };
+    auto fork = std::make_shared<Fork>();
+
+    submit([fork, &first]() {
+        if (!fork->claimed.exchange(true)) {
+            first();
+            fork->done.store(true, std::memory_order_release);
+        }
+    });
+
+    second();
+
+    // Nobody got to it: run it here
+    if (!fork->claimed.exchange(true)) {
+        first();
+        return;
+    }
+
+    // Another thread is running it; make ourselves useful until it is done
+    size_t own = current_worker();
+    while (!fork->done.load(std::memory_order_acquire)) {
+        if (!run_one(own)) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+bool ThreadPool::run_one(size_t own) {
+    std::function<void()> task;
+
+    if (own < m_queues.size()) {
+        WorkerQueue& queue = *m_queues[own];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty()) {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        }
+    }
+
+    // Steal the oldest task, which tends to be the biggest piece of work
+    for (size_t i = 1; !task && i <= m_queues.size(); ++i) {
+        WorkerQueue& queue = *m_queues[(own + i) % m_queues.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty()) {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+    }
+
+    if (!task) {
+        return false;
+    }
+    m_queued_count.fetch_sub(1);
+    task();
+    return true;
+}
+
+size_t ThreadPool::current_worker() const {
+    return t_worker_pool == this ? t_worker_index : m_queues.size();
+}
+
+ThreadPool& ThreadPool::get_shared() {
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::worker_loop(size_t index) {
+    t_worker_pool = this;
+    t_worker_index = index;
+
+    while (true) {
+        if (run_one(index)) {
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_condition.wait(lock, [this]() { return m_stopping || m_queued_count.load() > 0; });
+        if (m_stopping && m_queued_count.load() == 0) {
+            return;
+        }
+    }
+}
+
+} // namespace platform
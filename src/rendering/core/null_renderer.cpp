@@ -0,0 +1,125 @@
+#include "rendering/core/null_renderer.h"
+#include "game/bsp.h"
+#include <algorithm>
+#include <cmath>
+
+namespace rendering {
+
+NullRenderer::NullRenderer(int width, int height)
+    : m_aspect(static_cast<float>(std::max(width, 1)) / static_cast<float>(std::max(height, 1)))
+    , m_frame_count(0) {
+}
+
+void NullRenderer::begin_frame() {
+    m_stats = NullRenderStats();
+}
+
+void NullRenderer::end_frame() {
+    m_frame_count++;
+}
+
+void NullRenderer::render(const game::Level& level, const game::Camera& camera) {
+    m_textures.clear();
+    count_level(level, camera, true);
+    count_binds();
+}
+
+void NullRenderer::render_world(const game::LevelStreamer& streamer, const game::Camera& camera) {
+    // Every resident chunk, each with batches of its own as BasicRenderer
+    // draws them; the PVS only holds for the chunk the camera is in
+    const Vector3& eye = camera.get_position();
+    float size = streamer.get_chunk_size();
+    int32_t eye_x = static_cast<int32_t>(floorf(eye.x / size));
+    int32_t eye_z = static_cast<int32_t>(floorf(eye.z / size));
+    streamer.for_each_chunk([&](int32_t x, int32_t z, const game::Level& level) {
+        m_textures.clear();
+        count_level(level, camera, x == eye_x && z == eye_z);
+        count_binds();
+    });
+}
+
+void NullRenderer::count_level(const game::Level& level, const game::Camera& camera, bool use_pvs) {
+    const game::BSPTree* tree = level.get_bsp_tree();
+    if (tree && tree->is_built()) {
+        m_visibility_query.run(level, camera.get_frustum(m_aspect), use_pvs);
+        for (uint32_t subsector : m_visibility_query.get_subsectors()) {
+            count_piece(level, true, subsector);
+        }
+        m_stats.sectors += static_cast<uint32_t>(m_visibility_query.get_sectors().size());
+    } else if (m_portal_visibility.compute(level, camera.get_position(), camera.get_forward(),
+                                           camera.get_fov(), m_aspect)) {
+        for (uint32_t sector : m_portal_visibility.get_visible_sectors()) {
+            count_piece(level, false, sector);
+        }
+        m_stats.sectors += static_cast<uint32_t>(m_portal_visibility.get_visible_sectors().size());
+    }
+}
+
+void NullRenderer::count_binds() {
+    // LevelMesh draws its batches in texture order: one bind per texture
+    std::sort(m_textures.begin(), m_textures.end());
+    m_stats.texture_binds += static_cast<uint32_t>(
+        std::unique(m_textures.begin(), m_textures.end()) - m_textures.begin());
+}
+
+void NullRenderer::render_sprites(const std::vector<Sprite>& sprites, const game::Camera& camera) {
+    // Far to near like BasicRenderer, binding whenever the texture changes
+    std::vector<std::pair<float, uint32_t>>& order = m_sprite_order;
+    order.clear();
+    const Vector3& eye = camera.get_position();
+    for (const Sprite& sprite : sprites) {
+        float dx = sprite.position.x - eye.x;
+        float dy = sprite.position.y - eye.y;
+        float dz = sprite.position.z - eye.z;
+        order.emplace_back(dx * dx + dy * dy + dz * dz, sprite.texture_id);
+    }
+    std::stable_sort(order.begin(), order.end(),
+                     [](const std::pair<float, uint32_t>& a, const std::pair<float, uint32_t>& b) {
+                         return a.first > b.first;
+                     });
+    for (size_t i = 0; i < order.size(); ++i) {
+        if (i == 0 || order[i].second != order[i - 1].second) {
+            m_stats.texture_binds++;
+        }
+    }
+    m_stats.sprite_quads += static_cast<uint32_t>(sprites.size());
+}
+
+void NullRenderer::count_piece(const game::Level& level, bool by_subsector, uint32_t piece) {
+    const game::LevelGeometry& geometry = level.get_geometry();
+    const game::Sector* sector;
+    uint32_t vertex_count;
+    if (by_subsector) {
+        const game::BSPTree& tree = *level.get_bsp_tree();
+        const game::BSPSubSector& subsector = tree.get_subsector(piece);
+        sector = &level.get_sector(subsector.sector);
+        vertex_count = subsector.vertex_count;
+        for (uint32_t i = 0; i < subsector.seg_count; ++i) {
+            uint32_t wall = sector->first_wall + tree.get_segs()[subsector.first_seg + i].wall;
+            if (geometry.wall_portal[wall] < 0) {
+                m_stats.wall_quads++;
+                m_textures.push_back(geometry.wall_texture[wall]);
+            }
+        }
+    } else {
+        sector = &level.get_sector(piece);
+        vertex_count = sector->vertex_count;
+        for (uint32_t i = 0; i < sector->wall_count; ++i) {
+            uint32_t wall = sector->first_wall + i;
+            if (geometry.wall_portal[wall] < 0) {
+                m_stats.wall_quads++;
+                m_textures.push_back(geometry.wall_texture[wall]);
+            }
+        }
+    }
+
+    // A floor and a ceiling of vertex_count - 2 triangles each
+    if (vertex_count >= 3) {
+        m_stats.floor_triangles += (vertex_count - 2) * 2;
+        m_textures.push_back(sector->floor_texture);
+        m_textures.push_back(sector->ceiling_texture);
+    }
+    m_stats.pieces++;
+}
+
+} // namespace rendering
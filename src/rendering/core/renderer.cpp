@@ -3,16 +3,18 @@
 #include "raymath.h"
 #include "rlgl.h"
 #include <algorithm>
+#include <cmath>
 
 namespace rendering {
 
 BasicRenderer::BasicRenderer()
     : m_texture_manager(std::make_unique<TextureManager>())
     , m_hud(std::make_unique<HUD>())
-    , m_sector_renderer(std::make_unique<SectorRenderer>(*m_texture_manager))
+    , m_level_mesh(std::make_unique<LevelMesh>(*m_texture_manager))
     , m_weapon_sprite(std::make_unique<WeaponSprite>())
     , m_render_width(1920)   // Default 1080p resolution
-    , m_render_height(1080) {
+    , m_render_height(1080)
+    , m_visibility_mode(VisibilityMode::BSP) {
     // Load weapon sprite
     m_weapon_sprite->load_from_json("sprites/weapon_fist.json");
 
@@ -91,27 +93,104 @@ void BasicRenderer::render(const game::Level& level, const game::Camera& camera)
     Camera3D raylib_camera = camera.to_raylib_camera();
 
     BeginMode3D(raylib_camera);
+    m_mesh_stats = LevelMeshStats();
+    render_level(level, camera, *m_level_mesh, true);
+    EndMode3D();
 
-    const auto& sectors = level.get_sectors();
+    // Draw HUD and weapon
+    m_hud->render();
+    m_weapon_sprite->render();
+}
 
-    // Use BSP tree for optimized rendering
-    std::vector<uint32_t> visible_sectors;
-    level.get_bsp_tree()->get_visible_sectors(camera.get_position(), visible_sectors);
+void BasicRenderer::render_world(const game::LevelStreamer& streamer, const game::Camera& camera) {
+    Camera3D raylib_camera = camera.to_raylib_camera();
+    const Vector3& eye = camera.get_position();
+    float size = streamer.get_chunk_size();
+    int32_t eye_x = static_cast<int32_t>(floorf(eye.x / size));
+    int32_t eye_z = static_cast<int32_t>(floorf(eye.z / size));
 
-    // Render visible sectors in BSP order
-    for (uint32_t idx : visible_sectors) {
-        if (idx < sectors.size()) {
-            m_sector_renderer->render_sector(sectors[idx]);
-        }
+    for (auto& entry : m_chunk_meshes) {
+        entry.second.resident = false;
     }
 
+    BeginMode3D(raylib_camera);
+    m_mesh_stats = LevelMeshStats();
+    streamer.for_each_chunk([&](int32_t x, int32_t z, const game::Level& level) {
+        uint64_t key = (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32) | static_cast<uint32_t>(z);
+        ChunkMesh& chunk = m_chunk_meshes[key];
+        if (!chunk.mesh) {
+            chunk.mesh = std::make_unique<LevelMesh>(*m_texture_manager);
+        }
+        chunk.resident = true;
+
+        // Seams onto resident neighbours are walked through, so not drawn
+        chunk.mesh->set_open_edges(static_cast<float>(x) * size, static_cast<float>(z) * size,
+                                   static_cast<float>(x + 1) * size, static_cast<float>(z + 1) * size,
+                                   streamer.get_open_seams(x, z));
+        render_level(level, camera, *chunk.mesh, x == eye_x && z == eye_z);
+    });
     EndMode3D();
 
+    // Meshes of evicted chunks go with them
+    for (auto it = m_chunk_meshes.begin(); it != m_chunk_meshes.end();) {
+        it = it->second.resident ? std::next(it) : m_chunk_meshes.erase(it);
+    }
+
     // Draw HUD and weapon
     m_hud->render();
     m_weapon_sprite->render();
 }
 
+void BasicRenderer::render_level(const game::Level& level, const game::Camera& camera,
+                                 LevelMesh& mesh, bool use_pvs) {
+    // Level geometry is uploaded once, then patched as sectors change
+    mesh.update(level);
+
+    mesh.begin_frame(camera.get_position());
+    if (m_visibility_mode != VisibilityMode::PORTALS || !render_portals(level, camera, mesh)) {
+        render_bsp(level, camera, mesh, use_pvs);
+    }
+    mesh.draw();
+
+    const LevelMeshStats& stats = mesh.get_stats();
+    m_mesh_stats.draw_calls += stats.draw_calls;
+    m_mesh_stats.texture_binds += stats.texture_binds;
+    m_mesh_stats.triangles += stats.triangles;
+    m_mesh_stats.pieces += stats.pieces;
+}
+
+bool BasicRenderer::render_portals(const game::Level& level, const game::Camera& camera,
+                                   LevelMesh& mesh) {
+    float aspect = static_cast<float>(m_render_width) / static_cast<float>(m_render_height);
+    if (!m_portal_visibility.compute(level, camera.get_position(), camera.get_forward(),
+                                     camera.get_fov(), aspect)) {
+        return false;
+    }
+
+    // Sectors are convex and come out front to back, so each is drawn whole
+    for (uint32_t sector : m_portal_visibility.get_visible_sectors()) {
+        mesh.add_sector(sector);
+    }
+    return true;
+}
+
+void BasicRenderer::render_bsp(const game::Level& level, const game::Camera& camera,
+                               LevelMesh& mesh, bool use_pvs) {
+    // Use BSP tree for optimized rendering, skipping subtrees outside the view
+    float aspect = static_cast<float>(m_render_width) / static_cast<float>(m_render_height);
+    game::Frustum frustum = camera.get_frustum(aspect);
+
+    // Frustum-culled, PVS-filtered fragments; the query reuses its buffers
+    // so steady-state frames don't allocate
+    m_visibility_query.run(level, frustum, use_pvs);
+
+    // Queue the visible sector fragments; every piece of geometry belongs
+    // to exactly one fragment so nothing is drawn twice
+    for (uint32_t idx : m_visibility_query.get_subsectors()) {
+        mesh.add_subsector(idx);
+    }
+}
+
 void BasicRenderer::trigger_weapon_attack() {
     m_weapon_sprite->trigger_attack();
 }
@@ -156,13 +235,7 @@ void BasicRenderer::render_sprites(const std::vector<Sprite>& sprites, const gam
     }
 
     // Sort sprites by distance from camera (back to front for alpha blending)
-    struct SpriteDistance {
-        const Sprite* sprite;
-        float distance_sq;
-    };
-
-    std::vector<SpriteDistance> sorted_sprites;
-    sorted_sprites.reserve(sprites.size());
+    m_sorted_sprites.clear();
 
     Vector3 cam_pos = camera.get_position();
     for (const auto& sprite : sprites) {
@@ -170,16 +243,16 @@ void BasicRenderer::render_sprites(const std::vector<Sprite>& sprites, const gam
         float dy = sprite.position.y - cam_pos.y;
         float dz = sprite.position.z - cam_pos.z;
         float dist_sq = dx * dx + dy * dy + dz * dz;
-        sorted_sprites.push_back({&sprite, dist_sq});
+        m_sorted_sprites.push_back({&sprite, dist_sq});
     }
 
-    std::sort(sorted_sprites.begin(), sorted_sprites.end(),
+    std::sort(m_sorted_sprites.begin(), m_sorted_sprites.end(),
              [](const SpriteDistance& a, const SpriteDistance& b) {
                  return a.distance_sq > b.distance_sq;  // Far to near
              });
 
     // Render sorted sprites
-    for (const auto& sd : sorted_sprites) {
+    for (const auto& sd : m_sorted_sprites) {
         render_sprite(*sd.sprite, camera);
     }
 }
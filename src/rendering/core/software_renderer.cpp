@@ -0,0 +1,732 @@
+#include "rendering/core/software_renderer.h"
+#include "game/bsp.h"
+#include "platform/thread_pool.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define SOFTWARE_SPANS_SSE2
+#endif
+
+namespace rendering {
+
+namespace {
+
+// Same near clip as the GPU path (rlgl's default)
+constexpr float NEAR_DISTANCE = 0.01f;
+
+// Furthest the view shears up or down, as the tangent of the pitch; past
+// this the picture stretches too much to be worth it
+constexpr float MAX_SHEAR = 1.0f;
+
+// Rows per clear task
+constexpr size_t CLEAR_GRAIN = 64;
+
+// Column not yet in a visplane
+constexpr int UNSET_ROW = std::numeric_limits<int>::max();
+
+// What a generated texture is for; surfaces are tinted as the GPU path
+// tints them
+enum TextureUse : uint32_t {
+    USE_WALL = 0,
+    USE_FLOOR = 1,
+    USE_CEILING = 2,
+    USE_SPRITE = 3
+};
+
+constexpr uint32_t TEXTURE_MASK = SoftwareRenderer::TEXTURE_SIZE - 1;
+
+// RGBA8 in memory order (little-endian)
+uint32_t pack_color(uint32_t r, uint32_t g, uint32_t b, uint32_t a = 255) {
+    return r | (g << 8) | (b << 16) | (a << 24);
+}
+
+uint32_t hash(uint32_t value) {
+    value ^= value >> 16;
+    value *= 0x7feb352dU;
+    value ^= value >> 15;
+    value *= 0x846ca68bU;
+    value ^= value >> 16;
+    return value;
+}
+
+// A texel coordinate as 16.16 fixed point, wrapped to the texture. Only
+// the position within the texture matters, and the texture size divides
+// 2^16, so coordinates and steps wrap freely in 32 bits.
+uint32_t to_fixed(float texels) {
+    const float size = static_cast<float>(SoftwareRenderer::TEXTURE_SIZE);
+    float wrapped = texels - floorf(texels / size) * size;
+    return static_cast<uint32_t>(wrapped * 65536.0f);
+}
+
+// First pixel row (or column) whose centre is at or past y, clamped to
+// [low, high]
+int first_row(float y, int low, int high) {
+    y = std::min(std::max(y, static_cast<float>(low) - 1.0f), static_cast<float>(high) + 1.0f);
+    return std::min(std::max(static_cast<int>(ceilf(y - 0.5f)), low), high);
+}
+
+void fill_span(uint32_t* out, size_t count, uint32_t color) {
+    size_t i = 0;
+#if defined(SOFTWARE_SPANS_SSE2)
+    __m128i value = _mm_set1_epi32(static_cast<int>(color));
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), value);
+    }
+#endif
+    for (; i < count; ++i) {
+        out[i] = color;
+    }
+}
+
+// Texture a horizontal run of pixels, stepping (u, v) by (du, dv) each,
+// all 16.16 fixed point
+void fill_textured_span(uint32_t* out, size_t count, uint32_t u, uint32_t v,
+                        uint32_t du, uint32_t dv, const uint32_t* texels) {
+    size_t i = 0;
+#if defined(SOFTWARE_SPANS_SSE2)
+    // Texel addresses four at a time; SSE2 has no gather, so the fetches
+    // stay scalar
+    if (count >= 4) {
+        __m128i lane_u = _mm_setr_epi32(static_cast<int>(u), static_cast<int>(u + du),
+                                        static_cast<int>(u + du * 2), static_cast<int>(u + du * 3));
+        __m128i lane_v = _mm_setr_epi32(static_cast<int>(v), static_cast<int>(v + dv),
+                                        static_cast<int>(v + dv * 2), static_cast<int>(v + dv * 3));
+        const __m128i step_u = _mm_set1_epi32(static_cast<int>(du * 4));
+        const __m128i step_v = _mm_set1_epi32(static_cast<int>(dv * 4));
+        const __m128i mask = _mm_set1_epi32(static_cast<int>(TEXTURE_MASK));
+        alignas(16) uint32_t index[4];
+        for (; i + 4 <= count; i += 4) {
+            __m128i column = _mm_and_si128(_mm_srli_epi32(lane_u, 16), mask);
+            __m128i row = _mm_and_si128(_mm_srli_epi32(lane_v, 16), mask);
+            _mm_store_si128(reinterpret_cast<__m128i*>(index),
+                            _mm_or_si128(_mm_slli_epi32(row, SoftwareRenderer::TEXTURE_BITS), column));
+            __m128i colors = _mm_setr_epi32(
+                static_cast<int>(texels[index[0]]), static_cast<int>(texels[index[1]]),
+                static_cast<int>(texels[index[2]]), static_cast<int>(texels[index[3]]));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), colors);
+            lane_u = _mm_add_epi32(lane_u, step_u);
+            lane_v = _mm_add_epi32(lane_v, step_v);
+        }
+        u += du * static_cast<uint32_t>(i);
+        v += dv * static_cast<uint32_t>(i);
+    }
+#endif
+    for (; i < count; ++i) {
+        out[i] = texels[(((v >> 16) & TEXTURE_MASK) << SoftwareRenderer::TEXTURE_BITS) |
+                        ((u >> 16) & TEXTURE_MASK)];
+        u += du;
+        v += dv;
+    }
+}
+
+// A texture made up from its id: bricks for walls, tiles for floors and
+// ceilings, a round blob for sprites
+std::vector<uint32_t> generate_texture(uint32_t texture_id, uint32_t use) {
+    const int size = SoftwareRenderer::TEXTURE_SIZE;
+    uint32_t seed = hash(texture_id + 1);
+    float base_r = static_cast<float>(128 + (seed & 127));
+    float base_g = static_cast<float>(128 + ((seed >> 8) & 127));
+    float base_b = static_cast<float>(128 + ((seed >> 16) & 127));
+
+    float tint_r = 1.0f;
+    float tint_g = 1.0f;
+    float tint_b = 1.0f;
+    if (use == USE_FLOOR) {
+        tint_r = 139.0f / 255.0f;
+        tint_g = 69.0f / 255.0f;
+        tint_b = 19.0f / 255.0f;
+    } else if (use == USE_CEILING) {
+        tint_r = tint_g = tint_b = 169.0f / 255.0f;
+    }
+
+    std::vector<uint32_t> texels(static_cast<size_t>(size) * size);
+    for (int y = 0; y < size; ++y) {
+        for (int x = 0; x < size; ++x) {
+            bool grout;
+            if (use == USE_WALL) {
+                int shift = (y / 16) % 2 == 0 ? 0 : 16;
+                grout = y % 16 == 0 || (x + shift) % 32 == 0;
+            } else {
+                grout = y % 32 == 0 || x % 32 == 0;
+            }
+            uint32_t noise = hash(seed ^ static_cast<uint32_t>(y * size + x)) & 31;
+            float shade = grout ? 0.55f : 0.85f + static_cast<float>(noise) / 200.0f;
+
+            uint32_t alpha = 255;
+            if (use == USE_SPRITE) {
+                float dx = (static_cast<float>(x) + 0.5f) / size * 2.0f - 1.0f;
+                float dy = (static_cast<float>(y) + 0.5f) / size * 2.0f - 1.0f;
+                float distance_sq = dx * dx + dy * dy;
+                alpha = distance_sq <= 1.0f ? 255 : 0;
+                shade = 1.0f - distance_sq * 0.4f;
+            }
+
+            auto channel = [shade](float base, float tint) {
+                return static_cast<uint32_t>(std::min(base * tint * shade, 255.0f));
+            };
+            texels[static_cast<size_t>(y) * size + x] =
+                pack_color(channel(base_r, tint_r), channel(base_g, tint_g), channel(base_b, tint_b), alpha);
+        }
+    }
+    return texels;
+}
+
+} // namespace
+
+SoftwareRenderer::SoftwareRenderer(const SoftwareRendererConfig& config)
+    : m_width(std::max(config.width, 1))
+    , m_height(std::max(config.height, 1))
+    , m_pool(config.pool)
+    , m_pixels(static_cast<size_t>(m_width) * m_height, get_clear_color())
+    , m_column_depth(m_width, std::numeric_limits<float>::infinity())
+    , m_view()
+    , m_revision(0)
+    , m_texture()
+    , m_has_texture(false) {
+    int strip_width = std::max(config.strip_width, 1);
+    for (int x = 0; x < m_width; x += strip_width) {
+        Strip strip;
+        strip.x_begin = x;
+        strip.x_end = std::min(x + strip_width, m_width);
+        strip.clip_top.resize(strip.x_end - strip.x_begin);
+        strip.clip_bottom.resize(strip.x_end - strip.x_begin);
+        strip.plane_count = 0;
+        strip.span_start.resize(m_height);
+        strip.wall_columns = 0;
+        strip.spans = 0;
+        m_strips.push_back(std::move(strip));
+    }
+}
+
+SoftwareRenderer::~SoftwareRenderer() {
+    if (m_has_texture) {
+        UnloadTexture(m_texture);
+    }
+}
+
+uint32_t SoftwareRenderer::get_clear_color() {
+    return pack_color(0, 0, 0);
+}
+
+void SoftwareRenderer::begin_frame() {
+    m_stats = SoftwareRenderStats();
+    std::fill(m_column_depth.begin(), m_column_depth.end(), std::numeric_limits<float>::infinity());
+
+    platform::ThreadPool& workers = m_pool ? *m_pool : platform::ThreadPool::get_shared();
+    workers.parallel_for(static_cast<size_t>(m_height), CLEAR_GRAIN, [this](size_t begin, size_t end) {
+        fill_span(m_pixels.data() + begin * m_width, (end - begin) * m_width, get_clear_color());
+    });
+}
+
+void SoftwareRenderer::end_frame() {
+    // Headless: the framebuffer is the output
+    if (!IsWindowReady()) {
+        return;
+    }
+
+    if (!m_has_texture) {
+        Image image = GenImageColor(m_width, m_height, BLACK);
+        m_texture = LoadTextureFromImage(image);
+        UnloadImage(image);
+        m_has_texture = true;
+    }
+    UpdateTexture(m_texture, m_pixels.data());
+
+    // Fit the framebuffer to the window, keeping its aspect ratio
+    BeginDrawing();
+    ClearBackground(BLACK);
+
+    float window_width = static_cast<float>(GetScreenWidth());
+    float window_height = static_cast<float>(GetScreenHeight());
+    float scale = std::min(window_width / m_width, window_height / m_height);
+    float draw_width = m_width * scale;
+    float draw_height = m_height * scale;
+    Rectangle source = {0.0f, 0.0f, static_cast<float>(m_width), static_cast<float>(m_height)};
+    Rectangle dest = {(window_width - draw_width) * 0.5f, (window_height - draw_height) * 0.5f,
+                      draw_width, draw_height};
+    DrawTexturePro(m_texture, source, dest, {0.0f, 0.0f}, 0.0f, WHITE);
+
+    EndDrawing();
+}
+
+void SoftwareRenderer::render(const game::Level& level, const game::Camera& camera) {
+    prepare(level);
+    set_view(camera);
+
+    // Project the visible walls front to back, then rasterise them strip
+    // by strip
+    bool by_subsector = false;
+    core::Span<const uint32_t> pieces = find_pieces(level, camera, by_subsector);
+    m_walls.clear();
+    for (uint32_t piece : pieces) {
+        project_piece(level, by_subsector, piece);
+    }
+
+    platform::ThreadPool& workers = m_pool ? *m_pool : platform::ThreadPool::get_shared();
+    workers.parallel_for(m_strips.size(), 1, [this](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            render_strip(m_strips[i]);
+        }
+    });
+
+    m_stats.pieces = static_cast<uint32_t>(pieces.size());
+    m_stats.walls = static_cast<uint32_t>(m_walls.size());
+    m_stats.wall_columns = 0;
+    m_stats.visplanes = 0;
+    m_stats.spans = 0;
+    for (const Strip& strip : m_strips) {
+        m_stats.wall_columns += strip.wall_columns;
+        m_stats.visplanes += static_cast<uint32_t>(strip.plane_count);
+        m_stats.spans += strip.spans;
+    }
+}
+
+void SoftwareRenderer::render_sprites(const std::vector<Sprite>& sprites, const game::Camera& camera) {
+    set_view(camera);
+
+    // Far to near, each drawn over what's behind it
+    m_sorted_sprites.clear();
+    for (const Sprite& sprite : sprites) {
+        float dx = sprite.position.x - m_view.eye.x;
+        float dy = sprite.position.y - m_view.eye.y;
+        float dz = sprite.position.z - m_view.eye.z;
+        m_sorted_sprites.push_back({&sprite, dx * dx + dy * dy + dz * dz});
+    }
+    std::sort(m_sorted_sprites.begin(), m_sorted_sprites.end(),
+              [](const SpriteDistance& a, const SpriteDistance& b) {
+                  return a.distance_sq > b.distance_sq;
+              });
+
+    for (const SpriteDistance& entry : m_sorted_sprites) {
+        draw_sprite(*entry.sprite);
+    }
+}
+
+void SoftwareRenderer::prepare(const game::Level& level) {
+    if (m_revision != 0 && m_revision == level.get_revision()) {
+        return;
+    }
+
+    // Which way round each sector's outline goes, so walls can be culled
+    // by the side the camera is on
+    const game::LevelGeometry& geometry = level.get_geometry();
+    const std::vector<game::Sector>& sectors = level.get_sectors();
+    m_sector_winding.resize(sectors.size());
+    for (size_t i = 0; i < sectors.size(); ++i) {
+        const game::Sector& sector = sectors[i];
+        float twice_area = 0.0f;
+        if (sector.vertex_count > 0) {
+            game::Vertex origin = geometry.get_vertex(sector, 0);
+            for (uint32_t v = 1; v + 1 < sector.vertex_count; ++v) {
+                game::Vertex a = geometry.get_vertex(sector, v);
+                game::Vertex b = geometry.get_vertex(sector, v + 1);
+                twice_area += (a.x - origin.x) * (b.z - origin.z) - (b.x - origin.x) * (a.z - origin.z);
+            }
+        }
+        m_sector_winding[i] = twice_area < 0.0f ? -1 : 1;
+    }
+    m_revision = level.get_revision();
+}
+
+const uint32_t* SoftwareRenderer::get_texels(uint32_t texture_id, uint32_t use) {
+    uint32_t key = (texture_id << 2) | use;
+    auto found = m_textures.find(key);
+    if (found == m_textures.end()) {
+        found = m_textures.emplace(key, generate_texture(texture_id, use)).first;
+    }
+    return found->second.data();
+}
+
+void SoftwareRenderer::set_view(const game::Camera& camera) {
+    float yaw = camera.get_yaw();
+    float half_fov = camera.get_fov() * 0.5f * DEG2RAD;
+    float shear = std::min(std::max(tanf(camera.get_pitch()), -MAX_SHEAR), MAX_SHEAR);
+
+    m_view.eye = camera.get_position();
+    m_view.forward_x = sinf(yaw);
+    m_view.forward_z = cosf(yaw);
+    m_view.right_x = -m_view.forward_z;
+    m_view.right_z = m_view.forward_x;
+    m_view.focal = m_height * 0.5f / tanf(half_fov);
+    m_view.center_x = m_width * 0.5f;
+    m_view.horizon = m_height * 0.5f + shear * m_view.focal;
+}
+
+core::Span<const uint32_t> SoftwareRenderer::find_pieces(const game::Level& level,
+                                                        const game::Camera& camera,
+                                                        bool& by_subsector) {
+    // The view is level, but sheared: widen the vertical field of view to
+    // take in the rows above and below the shifted horizon
+    float tan_half = tanf(camera.get_fov() * 0.5f * DEG2RAD);
+    float shear = fabsf(m_view.horizon - m_height * 0.5f) / m_view.focal;
+    float fov_y = 2.0f * atanf(tan_half + shear) * RAD2DEG;
+    float aspect = static_cast<float>(m_width) / m_height * tan_half / (tan_half + shear);
+    Vector3 forward = {m_view.forward_x, 0.0f, m_view.forward_z};
+
+    const game::BSPTree* tree = level.get_bsp_tree();
+    by_subsector = tree && tree->is_built();
+    if (by_subsector) {
+        game::Frustum frustum(m_view.eye, forward, fov_y, aspect, NEAR_DISTANCE);
+        m_visibility_query.run(level, frustum);
+        return m_visibility_query.get_subsectors();
+    }
+    if (m_portal_visibility.compute(level, m_view.eye, forward, fov_y, aspect)) {
+        const std::vector<uint32_t>& sectors = m_portal_visibility.get_visible_sectors();
+        return core::Span<const uint32_t>(sectors.data(), sectors.size());
+    }
+    return core::Span<const uint32_t>();
+}
+
+void SoftwareRenderer::project_piece(const game::Level& level, bool by_subsector, uint32_t piece) {
+    if (by_subsector) {
+        const game::BSPTree& tree = *level.get_bsp_tree();
+        const game::BSPSubSector& subsector = tree.get_subsector(piece);
+        const core::FlatArray<game::BSPSeg>& segs = tree.get_segs();
+        for (uint32_t i = 0; i < subsector.seg_count; ++i) {
+            const game::BSPSeg& seg = segs[subsector.first_seg + i];
+            project_wall(level, subsector.sector, seg.wall, seg.start, seg.end, seg.offset);
+        }
+    } else {
+        const game::Sector& sector = level.get_sector(piece);
+        const game::LevelGeometry& geometry = level.get_geometry();
+        for (uint32_t i = 0; i < sector.wall_count; ++i) {
+            game::Wall wall = geometry.get_wall(sector, i);
+            project_wall(level, piece, i, geometry.get_vertex(sector, wall.vertex_a),
+                         geometry.get_vertex(sector, wall.vertex_b), 0.0f);
+        }
+    }
+}
+
+void SoftwareRenderer::project_wall(const game::Level& level, uint32_t sector_index, uint32_t wall,
+                                    const game::Vertex& start, const game::Vertex& end, float u_start) {
+    // Only walls seen from inside their sector
+    float edge_x = end.x - start.x;
+    float edge_z = end.z - start.z;
+    float side = edge_x * (m_view.eye.z - start.z) - edge_z * (m_view.eye.x - start.x);
+    if (side * m_sector_winding[sector_index] <= 0.0f) {
+        return;
+    }
+
+    // To view space, clipped to the near plane
+    auto to_view = [this](const game::Vertex& v, float& x, float& depth) {
+        float dx = v.x - m_view.eye.x;
+        float dz = v.z - m_view.eye.z;
+        x = dx * m_view.right_x + dz * m_view.right_z;
+        depth = dx * m_view.forward_x + dz * m_view.forward_z;
+    };
+    float x1, depth1, x2, depth2;
+    to_view(start, x1, depth1);
+    to_view(end, x2, depth2);
+    if (depth1 < NEAR_DISTANCE && depth2 < NEAR_DISTANCE) {
+        return;
+    }
+    float u1 = u_start;
+    float u2 = u_start + sqrtf(edge_x * edge_x + edge_z * edge_z);
+    if (depth1 < NEAR_DISTANCE) {
+        float t = (NEAR_DISTANCE - depth1) / (depth2 - depth1);
+        x1 += (x2 - x1) * t;
+        u1 += (u2 - u1) * t;
+        depth1 = NEAR_DISTANCE;
+    } else if (depth2 < NEAR_DISTANCE) {
+        float t = (NEAR_DISTANCE - depth2) / (depth1 - depth2);
+        x2 += (x1 - x2) * t;
+        u2 += (u1 - u2) * t;
+        depth2 = NEAR_DISTANCE;
+    }
+
+    ProjectedWall projected;
+    projected.x_left = m_view.center_x + x1 * m_view.focal / depth1;
+    projected.x_right = m_view.center_x + x2 * m_view.focal / depth2;
+    projected.inv_depth_left = 1.0f / depth1;
+    projected.inv_depth_right = 1.0f / depth2;
+    projected.u_left = u1 / depth1;
+    projected.u_right = u2 / depth2;
+    if (projected.x_left > projected.x_right) {
+        std::swap(projected.x_left, projected.x_right);
+        std::swap(projected.inv_depth_left, projected.inv_depth_right);
+        std::swap(projected.u_left, projected.u_right);
+    }
+
+    // Off screen, or too narrow to cover a column centre
+    int first = first_row(projected.x_left, 0, m_width);
+    int last = first_row(projected.x_right, 0, m_width);
+    if (first >= last) {
+        return;
+    }
+
+    const game::Sector& sector = level.get_sector(sector_index);
+    const game::LevelGeometry& geometry = level.get_geometry();
+    int32_t portal = geometry.wall_portal[sector.first_wall + wall];
+    projected.floor_height = sector.floor_height;
+    projected.ceiling_height = sector.ceiling_height;
+    projected.portal = portal >= 0;
+    projected.back_floor_height = sector.floor_height;
+    projected.back_ceiling_height = sector.ceiling_height;
+    if (projected.portal) {
+        const game::Sector& back = level.get_sector(level.get_portals()[portal].target_sector);
+        projected.back_floor_height = back.floor_height;
+        projected.back_ceiling_height = back.ceiling_height;
+    }
+    projected.texels = get_texels(geometry.wall_texture[sector.first_wall + wall], USE_WALL);
+    projected.floor_texels = get_texels(sector.floor_texture, USE_FLOOR);
+    projected.ceiling_texels = get_texels(sector.ceiling_texture, USE_CEILING);
+    m_walls.push_back(projected);
+}
+
+void SoftwareRenderer::render_strip(Strip& strip) {
+    int width = strip.x_end - strip.x_begin;
+    std::fill(strip.clip_top.begin(), strip.clip_top.end(), 0);
+    std::fill(strip.clip_bottom.begin(), strip.clip_bottom.end(), m_height);
+    strip.plane_count = 0;
+    strip.wall_columns = 0;
+    strip.spans = 0;
+
+    const View& view = m_view;
+    int open_columns = width;
+
+    // Draw the column of wall rows [begin, end)
+    auto draw_column = [this, &strip, &view](int x, int begin, int end, float u, float depth,
+                                             float ceiling_height, const uint32_t* texels) {
+        if (begin >= end) {
+            return;
+        }
+        strip.wall_columns++;
+
+        // V runs down from the ceiling, one texture per world unit
+        float step = depth / view.focal;
+        float v = (ceiling_height - view.eye.y) + (static_cast<float>(begin) + 0.5f - view.horizon) * step;
+        uint32_t v_fixed = to_fixed(v * TEXTURE_SIZE);
+        uint32_t v_step = to_fixed(step * TEXTURE_SIZE);
+        const uint32_t* column = texels + ((to_fixed(u * TEXTURE_SIZE) >> 16) & TEXTURE_MASK);
+        uint32_t* out = m_pixels.data() + static_cast<size_t>(begin) * m_width + x;
+        for (int y = begin; y < end; ++y) {
+            *out = column[((v_fixed >> 16) & TEXTURE_MASK) << TEXTURE_BITS];
+            out += m_width;
+            v_fixed += v_step;
+        }
+    };
+
+    for (const ProjectedWall& wall : m_walls) {
+        if (open_columns == 0) {
+            break;
+        }
+        int begin = std::max(first_row(wall.x_left, 0, m_width), strip.x_begin);
+        int end = std::min(first_row(wall.x_right, 0, m_width), strip.x_end);
+        if (begin >= end) {
+            continue;
+        }
+
+        // Planes are only seen from the side facing the eye
+        const size_t no_plane = std::numeric_limits<size_t>::max();
+        size_t ceiling_plane = wall.ceiling_height > view.eye.y
+            ? find_plane(strip, wall.ceiling_height, wall.ceiling_texels, begin - strip.x_begin, end - 1 - strip.x_begin)
+            : no_plane;
+        size_t floor_plane = wall.floor_height < view.eye.y
+            ? find_plane(strip, wall.floor_height, wall.floor_texels, begin - strip.x_begin, end - 1 - strip.x_begin)
+            : no_plane;
+        Visplane* ceiling = ceiling_plane != no_plane ? &strip.planes[ceiling_plane] : nullptr;
+        Visplane* floor = floor_plane != no_plane ? &strip.planes[floor_plane] : nullptr;
+
+        float width_on_screen = wall.x_right - wall.x_left;
+        for (int x = begin; x < end; ++x) {
+            int local = x - strip.x_begin;
+            int top = strip.clip_top[local];
+            int bottom = strip.clip_bottom[local];
+            if (top >= bottom) {
+                continue;
+            }
+
+            // Perspective-correct depth and u at the column centre
+            float t = (static_cast<float>(x) + 0.5f - wall.x_left) / width_on_screen;
+            float inv_depth = wall.inv_depth_left + (wall.inv_depth_right - wall.inv_depth_left) * t;
+            float depth = 1.0f / inv_depth;
+            float u = (wall.u_left + (wall.u_right - wall.u_left) * t) * depth;
+            float scale = view.focal * inv_depth;
+
+            int wall_top = first_row(view.horizon - (wall.ceiling_height - view.eye.y) * scale, top, bottom);
+            int wall_bottom = first_row(view.horizon - (wall.floor_height - view.eye.y) * scale, wall_top, bottom);
+            if (ceiling && wall_top > top) {
+                ceiling->top[local] = top;
+                ceiling->bottom[local] = wall_top - 1;
+            }
+            if (floor && bottom > wall_bottom) {
+                floor->top[local] = wall_bottom;
+                floor->bottom[local] = bottom - 1;
+            }
+
+            if (!wall.portal) {
+                draw_column(x, wall_top, wall_bottom, u, depth, wall.ceiling_height, wall.texels);
+                strip.clip_top[local] = bottom;
+                m_column_depth[x] = depth;
+                open_columns--;
+                continue;
+            }
+
+            // Portal: draw the steps down from a lower ceiling and up to a
+            // higher floor, and see the rest through the opening
+            int open_top = wall_top;
+            int open_bottom = wall_bottom;
+            if (wall.back_ceiling_height < wall.ceiling_height) {
+                open_top = first_row(view.horizon - (wall.back_ceiling_height - view.eye.y) * scale,
+                                     wall_top, wall_bottom);
+                draw_column(x, wall_top, open_top, u, depth, wall.ceiling_height, wall.texels);
+            }
+            if (wall.back_floor_height > wall.floor_height) {
+                open_bottom = first_row(view.horizon - (wall.back_floor_height - view.eye.y) * scale,
+                                        open_top, wall_bottom);
+                draw_column(x, open_bottom, wall_bottom, u, depth, wall.ceiling_height, wall.texels);
+            }
+            strip.clip_top[local] = open_top;
+            strip.clip_bottom[local] = open_bottom;
+            if (open_top >= open_bottom) {
+                m_column_depth[x] = depth;
+                open_columns--;
+            }
+        }
+    }
+
+    draw_planes(strip);
+}
+
+size_t SoftwareRenderer::find_plane(Strip& strip, float height, const uint32_t* texels,
+                                    int start, int stop) {
+    // Reuse a plane at the same height and texture if none of these
+    // columns are taken in it yet; the latest planes are likeliest
+    for (size_t i = strip.plane_count; i-- > 0;) {
+        Visplane& plane = strip.planes[i];
+        if (plane.height != height || plane.texels != texels) {
+            continue;
+        }
+        int overlap_begin = std::max(start, plane.min_x);
+        int overlap_end = std::min(stop, plane.max_x);
+        bool free = true;
+        for (int x = overlap_begin; x <= overlap_end && free; ++x) {
+            free = plane.top[x] == UNSET_ROW;
+        }
+        if (free) {
+            plane.min_x = std::min(plane.min_x, start);
+            plane.max_x = std::max(plane.max_x, stop);
+            return i;
+        }
+    }
+
+    if (strip.plane_count == strip.planes.size()) {
+        strip.planes.emplace_back();
+    }
+    Visplane& plane = strip.planes[strip.plane_count];
+    plane.height = height;
+    plane.texels = texels;
+    plane.min_x = start;
+    plane.max_x = stop;
+    plane.top.assign(strip.x_end - strip.x_begin, UNSET_ROW);
+    plane.bottom.resize(strip.x_end - strip.x_begin);
+    return strip.plane_count++;
+}
+
+void SoftwareRenderer::draw_planes(Strip& strip) {
+    // Turn each plane's columns into rows: a span opens on a row where a
+    // column starts covering it and is drawn where a column stops
+    for (size_t i = 0; i < strip.plane_count; ++i) {
+        const Visplane& plane = strip.planes[i];
+        auto close = [this, &strip, &plane](int y, int x_end) {
+            draw_span(plane, y, strip.x_begin + strip.span_start[y], strip.x_begin + x_end);
+            strip.spans++;
+        };
+
+        for (int x = plane.min_x; x <= plane.max_x + 1; ++x) {
+            int top1 = x > plane.min_x ? plane.top[x - 1] : UNSET_ROW;
+            int bottom1 = x > plane.min_x ? plane.bottom[x - 1] : -1;
+            int top2 = x <= plane.max_x ? plane.top[x] : UNSET_ROW;
+            int bottom2 = x <= plane.max_x ? plane.bottom[x] : -1;
+
+            while (top1 < top2 && top1 <= bottom1) {
+                close(top1++, x - 1);
+            }
+            while (bottom1 > bottom2 && bottom1 >= top1) {
+                close(bottom1--, x - 1);
+            }
+            while (top2 < top1 && top2 <= bottom2) {
+                strip.span_start[top2++] = x;
+            }
+            while (bottom2 > bottom1 && bottom2 >= top2) {
+                strip.span_start[bottom2--] = x;
+            }
+        }
+    }
+}
+
+void SoftwareRenderer::draw_span(const Visplane& plane, int y, int x1, int x2) {
+    // Depth of the row on the plane, then world (x, z) along it, which
+    // are the texture coordinates
+    float rise = m_view.horizon - (static_cast<float>(y) + 0.5f);
+    float depth = (plane.height - m_view.eye.y) * m_view.focal / rise;
+    if (!(depth > 0.0f) || !std::isfinite(depth)) {
+        return;
+    }
+    float step = depth / m_view.focal;
+    float across = (0.5f - m_view.center_x) * step;
+    float world_x = m_view.eye.x + m_view.forward_x * depth + m_view.right_x * across;
+    float world_z = m_view.eye.z + m_view.forward_z * depth + m_view.right_z * across;
+
+    // Stepped from the row's first column, so a pixel comes out the same
+    // whichever span (and strip) it is drawn in
+    uint32_t du = to_fixed(m_view.right_x * step * TEXTURE_SIZE);
+    uint32_t dv = to_fixed(m_view.right_z * step * TEXTURE_SIZE);
+    uint32_t u = to_fixed(world_x * TEXTURE_SIZE) + du * static_cast<uint32_t>(x1);
+    uint32_t v = to_fixed(world_z * TEXTURE_SIZE) + dv * static_cast<uint32_t>(x1);
+    fill_textured_span(m_pixels.data() + static_cast<size_t>(y) * m_width + x1,
+                       static_cast<size_t>(x2 - x1 + 1), u, v, du, dv, plane.texels);
+}
+
+void SoftwareRenderer::draw_sprite(const Sprite& sprite) {
+    float dx = sprite.position.x - m_view.eye.x;
+    float dz = sprite.position.z - m_view.eye.z;
+    float depth = dx * m_view.forward_x + dz * m_view.forward_z;
+    if (depth < NEAR_DISTANCE) {
+        return;
+    }
+    float scale = m_view.focal / depth;
+    float center = m_view.center_x + (dx * m_view.right_x + dz * m_view.right_z) * scale;
+    float half_width = sprite.width * 0.5f * scale;
+
+    // Anchored as BasicRenderer anchors it
+    float bottom = sprite.position.y + sprite.height * sprite.anchor_y;
+    float screen_left = center - half_width;
+    float screen_top = m_view.horizon - (bottom + sprite.height - m_view.eye.y) * scale;
+    float screen_height = sprite.height * scale;
+
+    int x_begin = first_row(screen_left, 0, m_width);
+    int x_end = first_row(center + half_width, 0, m_width);
+    int y_begin = first_row(screen_top, 0, m_height);
+    int y_end = first_row(screen_top + screen_height, 0, m_height);
+    if (x_begin >= x_end || y_begin >= y_end) {
+        return;
+    }
+    m_stats.sprites++;
+
+    // Hidden behind walls that closed the column nearer than the sprite;
+    // steps seen through portals don't hide it
+    const uint32_t* texels = get_texels(sprite.texture_id, USE_SPRITE);
+    float u_scale = TEXTURE_SIZE / (half_width * 2.0f);
+    float v_scale = TEXTURE_SIZE / screen_height;
+    for (int x = x_begin; x < x_end; ++x) {
+        if (depth >= m_column_depth[x]) {
+            continue;
+        }
+        int u = std::min(static_cast<int>((static_cast<float>(x) + 0.5f - screen_left) * u_scale),
+                         TEXTURE_SIZE - 1);
+        for (int y = y_begin; y < y_end; ++y) {
+            int v = std::min(static_cast<int>((static_cast<float>(y) + 0.5f - screen_top) * v_scale),
+                             TEXTURE_SIZE - 1);
+            uint32_t texel = texels[(v << TEXTURE_BITS) | u];
+            if ((texel >> 24) != 0) {
+                m_pixels[static_cast<size_t>(y) * m_width + x] = texel;
+            }
+        }
+    }
+}
+
+} // namespace rendering
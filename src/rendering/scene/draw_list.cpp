@@ -0,0 +1,51 @@
+#include "rendering/scene/draw_list.h"
+#include <utility>
+
+namespace rendering {
+
+void DrawList::sort() {
+    size_t count = m_items.size();
+    if (count < 2) {
+        return;
+    }
+
+    // Histograms of all four key bytes in one pass
+    uint32_t counts[4][256] = {};
+    for (const DrawItem& entry : m_items) {
+        counts[0][entry.key & 0xFF]++;
+        counts[1][(entry.key >> 8) & 0xFF]++;
+        counts[2][(entry.key >> 16) & 0xFF]++;
+        counts[3][entry.key >> 24]++;
+    }
+
+    m_scratch.resize(count);
+    DrawItem* source = m_items.data();
+    DrawItem* target = m_scratch.data();
+    for (uint32_t byte = 0; byte < 4; ++byte) {
+        uint32_t* histogram = counts[byte];
+        uint32_t shift = byte * 8;
+
+        // Every key has the same byte here; nothing to do
+        if (histogram[(source[0].key >> shift) & 0xFF] == count) {
+            continue;
+        }
+
+        uint32_t offset = 0;
+        for (uint32_t bucket = 0; bucket < 256; ++bucket) {
+            uint32_t bucket_count = histogram[bucket];
+            histogram[bucket] = offset;
+            offset += bucket_count;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            target[histogram[(source[i].key >> shift) & 0xFF]++] = source[i];
+        }
+        std::swap(source, target);
+    }
+
+    // Odd number of scatters: the result is in the scratch buffer
+    if (source != m_items.data()) {
+        m_items.swap(m_scratch);
+    }
+}
+
+} // namespace rendering
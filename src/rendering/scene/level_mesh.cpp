@@ -0,0 +1,571 @@
+#include "rendering/scene/level_mesh.h"
+#include "game/bsp.h"
+#include "game/level_streamer.h"
+#include "raymath.h"
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+namespace rendering {
+
+namespace {
+
+// Vertices a batch can hold with 16-bit indices
+constexpr uint32_t MAX_BATCH_VERTICES = 65536;
+
+// Mesh::vboId slot of the index buffer
+constexpr int MESH_INDEX_BUFFER = 6;
+
+// Vertex tints: walls plain, floors brown, ceilings grey
+const Color WALL_COLOR = {255, 255, 255, 255};
+const Color FLOOR_COLOR = {139, 69, 19, 255};
+const Color CEILING_COLOR = {169, 169, 169, 255};
+
+} // namespace
+
+LevelMesh::Batch::Batch()
+    : texture(0)
+    , vertex_count(0)
+    , mesh()
+    , uploaded(false)
+    , dirty(false) {
+}
+
+LevelMesh::LevelMesh(TextureManager& texture_manager)
+    : m_texture_manager(texture_manager)
+    , m_material()
+    , m_default_diffuse()
+    , m_has_material(false)
+    , m_revision(0)
+    , m_by_subsector(false)
+    , m_dead_indices(0)
+    , m_open_box{0.0f, 0.0f, 0.0f, 0.0f}
+    , m_open_edges(0)
+    , m_inverse_depth_range(1.0f)
+    , m_eye{0.0f, 0.0f, 0.0f} {
+}
+
+LevelMesh::~LevelMesh() {
+    unload();
+    if (m_has_material) {
+        m_material.maps[MATERIAL_MAP_DIFFUSE].texture = m_default_diffuse;
+        UnloadMaterial(m_material);
+    }
+}
+
+bool LevelMesh::is_built_for(const game::Level& level) const {
+    return m_revision != 0 && m_revision == level.get_revision();
+}
+
+void LevelMesh::set_open_edges(float min_x, float min_z, float max_x, float max_z, uint32_t edges) {
+    if (edges == m_open_edges && min_x == m_open_box[0] && min_z == m_open_box[1] &&
+        max_x == m_open_box[2] && max_z == m_open_box[3]) {
+        return;
+    }
+    m_open_box[0] = min_x;
+    m_open_box[1] = min_z;
+    m_open_box[2] = max_x;
+    m_open_box[3] = max_z;
+    m_open_edges = edges;
+    m_revision = 0;
+}
+
+bool LevelMesh::on_open_edge(const game::Vertex& a, const game::Vertex& b) const {
+    return game::find_chunk_edge(m_open_box[0], m_open_box[1], m_open_box[2], m_open_box[3],
+                                 m_open_edges, a, b) != 0;
+}
+
+void LevelMesh::build(const game::Level& level) {
+    unload();
+
+    const auto& sectors = level.get_sectors();
+    const game::BSPTree* bsp_tree = level.get_bsp_tree();
+    m_by_subsector = bsp_tree != nullptr;
+    size_t piece_count = m_by_subsector ? bsp_tree->get_subsectors().size() : sectors.size();
+
+    // Floors and ceilings are triangulated up front, in parallel
+    m_floors.build(level);
+
+    m_range_offsets.assign(piece_count + 1, 0);
+    m_piece_centers.resize(piece_count * 3);
+    for (size_t piece = 0; piece < piece_count; ++piece) {
+        uint32_t index = static_cast<uint32_t>(piece);
+        lay_out_piece(level, index, m_floors.get_triangles(index).begin(), m_ranges,
+                      &m_piece_centers[piece * 3]);
+        m_range_offsets[piece + 1] = static_cast<uint32_t>(m_ranges.size());
+    }
+
+    // Depth keys span the level's extent
+    float min_x = 0.0f;
+    float min_z = 0.0f;
+    float max_x = 0.0f;
+    float max_z = 0.0f;
+    for (size_t piece = 0; piece < piece_count; ++piece) {
+        float x = m_piece_centers[piece * 3];
+        float z = m_piece_centers[piece * 3 + 2];
+        min_x = piece == 0 ? x : std::min(min_x, x);
+        min_z = piece == 0 ? z : std::min(min_z, z);
+        max_x = piece == 0 ? x : std::max(max_x, x);
+        max_z = piece == 0 ? z : std::max(max_z, z);
+    }
+    float extent = sqrtf((max_x - min_x) * (max_x - min_x) + (max_z - min_z) * (max_z - min_z));
+    m_inverse_depth_range = 1.0f / std::max(extent, 1.0f);
+
+    index_sector_pieces(level);
+
+    // Nothing is added to these batches later; edits get batches of their own
+    m_open_batches.clear();
+    if (!m_has_material) {
+        m_material = LoadMaterialDefault();
+        m_default_diffuse = m_material.maps[MATERIAL_MAP_DIFFUSE].texture;
+        m_has_material = true;
+    }
+    upload_dirty();
+    rank_batches();
+    m_revision = level.get_revision();
+}
+
+void LevelMesh::update(const game::Level& level) {
+    if (is_built_for(level)) {
+        return;
+    }
+
+    // Patch only a mesh of the same kind of pieces, still mostly in use,
+    // when the level knows what changed since it was built
+    const auto& sectors = level.get_sectors();
+    const game::BSPTree* bsp_tree = level.get_bsp_tree();
+    bool by_subsector = bsp_tree != nullptr;
+    size_t used_indices = 0;
+    for (const Batch& batch : m_batches) {
+        used_indices += batch.indices.size();
+    }
+    size_t old_sector_count = m_by_subsector
+        ? (m_sector_offsets.empty() ? 0 : m_sector_offsets.size() - 1)
+        : (m_range_offsets.empty() ? 0 : m_range_offsets.size() - 1);
+    if (m_revision == 0 || by_subsector != m_by_subsector || old_sector_count != sectors.size() ||
+        m_dead_indices * 2 > used_indices || m_batches.size() >= DrawList::MAX_GROUPS / 2 ||
+        !level.get_sectors_changed_since(m_revision, m_changed_sectors)) {
+        build(level);
+        return;
+    }
+
+    std::vector<uint8_t> changed(sectors.size(), 0);
+    for (uint32_t sector : m_changed_sectors) {
+        if (sector < sectors.size()) {
+            changed[sector] = 1;
+        }
+    }
+
+    // Unchanged sectors keep their pieces, in the same order, only
+    // renumbered; anything else means the mesh can't be patched
+    size_t piece_count = by_subsector ? bsp_tree->get_subsectors().size() : sectors.size();
+    if (by_subsector) {
+        std::vector<uint32_t> counts(sectors.size(), 0);
+        for (size_t piece = 0; piece < piece_count; ++piece) {
+            counts[bsp_tree->get_subsector(static_cast<uint32_t>(piece)).sector]++;
+        }
+        for (size_t sector = 0; sector < sectors.size(); ++sector) {
+            if (!changed[sector] && counts[sector] != m_sector_offsets[sector + 1] - m_sector_offsets[sector]) {
+                build(level);
+                return;
+            }
+        }
+    }
+
+    // Changed sectors' old triangles stay in their batches, unused
+    for (uint32_t sector : m_changed_sectors) {
+        if (sector >= sectors.size()) {
+            continue;
+        }
+        uint32_t first = m_by_subsector ? m_sector_offsets[sector] : sector;
+        uint32_t end = m_by_subsector ? m_sector_offsets[sector + 1] : sector + 1;
+        for (uint32_t i = first; i < end; ++i) {
+            uint32_t piece = m_by_subsector ? m_sector_pieces[i] : i;
+            for (uint32_t r = m_range_offsets[piece]; r < m_range_offsets[piece + 1]; ++r) {
+                m_dead_indices += m_ranges[r].index_count;
+            }
+        }
+    }
+
+    std::vector<uint32_t> range_offsets(piece_count + 1, 0);
+    std::vector<Range> ranges;
+    ranges.reserve(m_ranges.size());
+    std::vector<float> centers(piece_count * 3);
+    std::vector<uint32_t> cursor;
+    if (by_subsector) {
+        cursor.assign(m_sector_offsets.begin(), m_sector_offsets.end() - 1);
+    }
+    for (size_t piece = 0; piece < piece_count; ++piece) {
+        uint32_t index = static_cast<uint32_t>(piece);
+        uint32_t sector = by_subsector ? bsp_tree->get_subsector(index).sector : index;
+        if (changed[sector]) {
+            lay_out_piece(level, index, nullptr, ranges, &centers[piece * 3]);
+        } else {
+            uint32_t old_piece = by_subsector ? m_sector_pieces[cursor[sector]++] : index;
+            ranges.insert(ranges.end(), m_ranges.begin() + m_range_offsets[old_piece],
+                          m_ranges.begin() + m_range_offsets[old_piece + 1]);
+            std::copy(&m_piece_centers[old_piece * 3], &m_piece_centers[old_piece * 3] + 3,
+                      &centers[piece * 3]);
+        }
+        range_offsets[piece + 1] = static_cast<uint32_t>(ranges.size());
+    }
+    m_range_offsets.swap(range_offsets);
+    m_ranges.swap(ranges);
+    m_piece_centers.swap(centers);
+    index_sector_pieces(level);
+
+    upload_dirty();
+    rank_batches();
+    m_revision = level.get_revision();
+}
+
+void LevelMesh::lay_out_piece(const game::Level& level, uint32_t piece,
+                              const uint32_t* floor_triangles, std::vector<Range>& ranges,
+                              float* center) {
+    const game::LevelGeometry& geometry = level.get_geometry();
+    const game::BSPTree* bsp_tree = m_by_subsector ? level.get_bsp_tree() : nullptr;
+    const game::BSPSubSector* subsector = bsp_tree ? &bsp_tree->get_subsector(piece) : nullptr;
+    const game::Sector& sector = level.get_sector(subsector ? subsector->sector : piece);
+
+    // Outline of the piece's floor and ceiling
+    uint32_t vertex_count = game::FloorTriangulation::get_outline(level, m_by_subsector, piece, m_outline);
+    const game::Vertex* vertices = m_outline.data();
+    if (!floor_triangles && vertex_count >= 3) {
+        m_floor_triangles.resize((vertex_count - 2) * 3);
+        game::FloorTriangulation::triangulate(vertices, vertex_count, m_floor_triangles.data());
+        floor_triangles = m_floor_triangles.data();
+    }
+
+    float center_x = 0.0f;
+    float center_z = 0.0f;
+    for (uint32_t i = 0; i < vertex_count; ++i) {
+        center_x += vertices[i].x;
+        center_z += vertices[i].z;
+    }
+    float inverse_count = vertex_count > 0 ? 1.0f / static_cast<float>(vertex_count) : 0.0f;
+    center[0] = center_x * inverse_count;
+    center[1] = (sector.floor_height + sector.ceiling_height) * 0.5f;
+    center[2] = center_z * inverse_count;
+
+    // Ends of a wall surface (seg or wall), and U at its start
+    auto get_wall_ends = [&](uint32_t index, game::Vertex& start, game::Vertex& end) {
+        if (subsector) {
+            const game::BSPSeg& seg = bsp_tree->get_segs()[index];
+            start = seg.start;
+            end = seg.end;
+            return seg.offset;
+        }
+        game::Wall wall = geometry.get_wall(sector, index);
+        start = geometry.get_vertex(sector, wall.vertex_a);
+        end = geometry.get_vertex(sector, wall.vertex_b);
+        return 0.0f;
+    };
+
+    // Solid walls (portals and open edges are openings), floor and
+    // ceiling, grouped by texture so each texture's triangles are one run
+    std::vector<Surface>& surfaces = m_surfaces;
+    surfaces.clear();
+    uint32_t wall_count = subsector ? subsector->seg_count : sector.wall_count;
+    for (uint32_t i = 0; i < wall_count; ++i) {
+        uint32_t index = subsector ? subsector->first_seg + i : i;
+        uint32_t wall = subsector ? bsp_tree->get_segs()[index].wall : i;
+        if (geometry.wall_portal[sector.first_wall + wall] >= 0) {
+            continue;
+        }
+        if (m_open_edges != 0) {
+            game::Vertex start;
+            game::Vertex end;
+            get_wall_ends(index, start, end);
+            if (on_open_edge(start, end)) {
+                continue;
+            }
+        }
+        surfaces.push_back({geometry.wall_texture[sector.first_wall + wall],
+                            SurfaceKind::WALL, index});
+    }
+    if (vertex_count >= 3) {
+        surfaces.push_back({sector.floor_texture, SurfaceKind::FLOOR, 0});
+        surfaces.push_back({sector.ceiling_texture, SurfaceKind::CEILING, 0});
+    }
+    std::stable_sort(surfaces.begin(), surfaces.end(),
+                     [](const Surface& a, const Surface& b) { return a.texture < b.texture; });
+
+    size_t first_range = ranges.size();
+    for (const Surface& surface : surfaces) {
+        uint32_t surface_vertices = surface.kind == SurfaceKind::WALL ? 4 : vertex_count;
+
+        // Start a new batch for the texture if this one is full
+        auto open = m_open_batches.find(surface.texture);
+        if (open == m_open_batches.end() ||
+            m_batches[open->second].vertex_count + surface_vertices > MAX_BATCH_VERTICES) {
+            m_batches.emplace_back();
+            m_batches.back().texture = surface.texture;
+            open = m_open_batches.insert_or_assign(surface.texture,
+                static_cast<uint32_t>(m_batches.size() - 1)).first;
+        }
+        uint32_t batch_index = open->second;
+        Batch& batch = m_batches[batch_index];
+        batch.dirty = true;
+
+        if (ranges.size() == first_range || ranges.back().batch != batch_index) {
+            ranges.push_back({batch_index, static_cast<uint32_t>(batch.indices.size()), 0});
+        }
+
+        uint32_t base = batch.vertex_count;
+        auto push_vertex = [&batch](float x, float y, float z, float u, float v, Color color) {
+            batch.positions.insert(batch.positions.end(), {x, y, z});
+            batch.texcoords.insert(batch.texcoords.end(), {u, v});
+            batch.colors.insert(batch.colors.end(), {color.r, color.g, color.b, color.a});
+            batch.vertex_count++;
+        };
+
+        if (surface.kind == SurfaceKind::WALL) {
+            // U runs along the whole wall, V down from the ceiling
+            game::Vertex start;
+            game::Vertex end;
+            float u_start = get_wall_ends(surface.index, start, end);
+            float u_end = u_start + sqrtf((end.x - start.x) * (end.x - start.x) +
+                                          (end.z - start.z) * (end.z - start.z));
+            float v_bottom = sector.ceiling_height - sector.floor_height;
+
+            push_vertex(start.x, sector.floor_height, start.z, u_start, v_bottom, WALL_COLOR);
+            push_vertex(end.x, sector.floor_height, end.z, u_end, v_bottom, WALL_COLOR);
+            push_vertex(end.x, sector.ceiling_height, end.z, u_end, 0.0f, WALL_COLOR);
+            push_vertex(start.x, sector.ceiling_height, start.z, u_start, 0.0f, WALL_COLOR);
+            for (uint32_t corner : {0u, 1u, 2u, 0u, 2u, 3u}) {
+                batch.indices.push_back(static_cast<uint16_t>(base + corner));
+            }
+        } else {
+            // Triangles with world-space UVs so neighbouring pieces line
+            // up. They wind for a viewer below; floors are seen from
+            // above, so flip them.
+            bool facing_up = surface.kind == SurfaceKind::FLOOR;
+            float height = facing_up ? sector.floor_height : sector.ceiling_height;
+            Color color = facing_up ? FLOOR_COLOR : CEILING_COLOR;
+            for (uint32_t i = 0; i < vertex_count; ++i) {
+                push_vertex(vertices[i].x, height, vertices[i].z,
+                            vertices[i].x, vertices[i].z, color);
+            }
+            for (uint32_t i = 0; i < (vertex_count - 2) * 3; i += 3) {
+                uint32_t second = floor_triangles[facing_up ? i + 2 : i + 1];
+                uint32_t third = floor_triangles[facing_up ? i + 1 : i + 2];
+                batch.indices.push_back(static_cast<uint16_t>(base + floor_triangles[i]));
+                batch.indices.push_back(static_cast<uint16_t>(base + second));
+                batch.indices.push_back(static_cast<uint16_t>(base + third));
+            }
+        }
+        ranges.back().index_count =
+            static_cast<uint32_t>(batch.indices.size()) - ranges.back().first_index;
+    }
+}
+
+void LevelMesh::index_sector_pieces(const game::Level& level) {
+    const auto& sectors = level.get_sectors();
+    const game::BSPTree* bsp_tree = level.get_bsp_tree();
+    if (!m_by_subsector || !bsp_tree) {
+        m_sector_offsets.clear();
+        m_sector_pieces.clear();
+        return;
+    }
+
+    // Sector to sub-sector pieces, for drawing whole sectors
+    size_t piece_count = bsp_tree->get_subsectors().size();
+    m_sector_offsets.assign(sectors.size() + 1, 0);
+    for (size_t piece = 0; piece < piece_count; ++piece) {
+        m_sector_offsets[bsp_tree->get_subsector(static_cast<uint32_t>(piece)).sector + 1]++;
+    }
+    for (size_t sector = 0; sector < sectors.size(); ++sector) {
+        m_sector_offsets[sector + 1] += m_sector_offsets[sector];
+    }
+    m_sector_pieces.resize(piece_count);
+    std::vector<uint32_t> cursor(m_sector_offsets.begin(), m_sector_offsets.end() - 1);
+    for (size_t piece = 0; piece < piece_count; ++piece) {
+        uint32_t sector = bsp_tree->get_subsector(static_cast<uint32_t>(piece)).sector;
+        m_sector_pieces[cursor[sector]++] = static_cast<uint32_t>(piece);
+    }
+}
+
+void LevelMesh::rank_batches() {
+    std::vector<uint32_t> order(m_batches.size());
+    for (uint32_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+        return m_batches[a].texture < m_batches[b].texture;
+    });
+
+    m_batch_ranks.resize(m_batches.size());
+    for (uint32_t i = 0; i < order.size(); ++i) {
+        m_batch_ranks[order[i]] = i;
+    }
+}
+
+void LevelMesh::upload_dirty() {
+    for (uint32_t i = 0; i < m_batches.size(); ++i) {
+        if (m_batches[i].dirty) {
+            upload(i);
+        }
+    }
+}
+
+void LevelMesh::upload(uint32_t index) {
+    Batch& batch = m_batches[index];
+    unload_batch(batch);
+    batch.mesh = Mesh();
+    batch.mesh.vertexCount = static_cast<int>(batch.vertex_count);
+    batch.mesh.triangleCount = static_cast<int>(batch.indices.size() / 3);
+    batch.mesh.vertices = batch.positions.data();
+    batch.mesh.texcoords = batch.texcoords.data();
+    batch.mesh.colors = batch.colors.data();
+    batch.mesh.indices = batch.indices.data();
+
+    // Dynamic so the index buffer can take each frame's visible triangles
+    UploadMesh(&batch.mesh, true);
+    batch.uploaded = true;
+    batch.dirty = false;
+
+    // Only the indices are needed again, unless more geometry is coming;
+    // draw calls want them non-null
+    batch.mesh.vertices = nullptr;
+    batch.mesh.texcoords = nullptr;
+    batch.mesh.colors = nullptr;
+    auto open = m_open_batches.find(batch.texture);
+    if (open == m_open_batches.end() || open->second != index) {
+        std::vector<float>().swap(batch.positions);
+        std::vector<float>().swap(batch.texcoords);
+        std::vector<unsigned char>().swap(batch.colors);
+    }
+}
+
+void LevelMesh::unload_batch(Batch& batch) {
+    if (!batch.uploaded) {
+        return;
+    }
+
+    // UnloadMesh frees the CPU arrays too; those belong to the batch
+    batch.mesh.indices = nullptr;
+    UnloadMesh(batch.mesh);
+    batch.uploaded = false;
+}
+
+void LevelMesh::unload() {
+    for (Batch& batch : m_batches) {
+        unload_batch(batch);
+    }
+    m_batches.clear();
+    m_batch_ranks.clear();
+    m_open_batches.clear();
+    m_dead_indices = 0;
+    m_range_offsets.clear();
+    m_ranges.clear();
+    m_sector_offsets.clear();
+    m_sector_pieces.clear();
+    m_piece_centers.clear();
+    m_floors = game::FloorTriangulation();
+    m_draw_list.clear();
+    m_revision = 0;
+}
+
+size_t LevelMesh::get_vertex_count() const {
+    size_t count = 0;
+    for (const Batch& batch : m_batches) {
+        count += batch.vertex_count;
+    }
+    return count;
+}
+
+size_t LevelMesh::get_triangle_count() const {
+    size_t count = 0;
+    for (const Batch& batch : m_batches) {
+        count += batch.indices.size() / 3;
+    }
+    return count;
+}
+
+void LevelMesh::begin_frame(const Vector3& eye) {
+    m_eye = eye;
+    m_draw_list.clear();
+    m_stats = LevelMeshStats();
+}
+
+void LevelMesh::add_piece(uint32_t piece) {
+    if (piece + 1 >= m_range_offsets.size()) {
+        return;
+    }
+
+    const float* center = &m_piece_centers[static_cast<size_t>(piece) * 3];
+    float dx = center[0] - m_eye.x;
+    float dy = center[1] - m_eye.y;
+    float dz = center[2] - m_eye.z;
+    float depth = sqrtf(dx * dx + dy * dy + dz * dz) * m_inverse_depth_range;
+    for (uint32_t i = m_range_offsets[piece]; i < m_range_offsets[piece + 1]; ++i) {
+        m_draw_list.add(DrawList::make_key(0, m_batch_ranks[m_ranges[i].batch], depth), i);
+    }
+    m_stats.pieces++;
+}
+
+void LevelMesh::add_subsector(uint32_t subsector) {
+    if (m_by_subsector) {
+        add_piece(subsector);
+    }
+}
+
+void LevelMesh::add_sector(uint32_t sector) {
+    if (!m_by_subsector) {
+        add_piece(sector);
+        return;
+    }
+    if (sector + 1 >= m_sector_offsets.size()) {
+        return;
+    }
+    for (uint32_t i = m_sector_offsets[sector]; i < m_sector_offsets[sector + 1]; ++i) {
+        add_piece(m_sector_pieces[i]);
+    }
+}
+
+void LevelMesh::draw() {
+    m_draw_list.sort();
+
+    // Gather each batch's run of ranges, nearest first, and draw it
+    uint32_t bound_texture = 0;
+    bool has_bound = false;
+    uint32_t current = 0;
+    m_frame_indices.clear();
+    for (const DrawItem& entry : m_draw_list.get_items()) {
+        const Range& range = m_ranges[entry.item];
+        if (range.batch != current && !m_frame_indices.empty()) {
+            draw_batch(current);
+        }
+        current = range.batch;
+
+        const Batch& batch = m_batches[range.batch];
+        if (!has_bound || batch.texture != bound_texture) {
+            bound_texture = batch.texture;
+            has_bound = true;
+            m_stats.texture_binds++;
+        }
+        const uint16_t* first = batch.indices.data() + range.first_index;
+        m_frame_indices.insert(m_frame_indices.end(), first, first + range.index_count);
+    }
+    if (!m_frame_indices.empty()) {
+        draw_batch(current);
+    }
+}
+
+void LevelMesh::draw_batch(uint32_t index) {
+    Batch& batch = m_batches[index];
+    UpdateMeshBuffer(batch.mesh, MESH_INDEX_BUFFER, m_frame_indices.data(),
+                     static_cast<int>(m_frame_indices.size() * sizeof(uint16_t)), 0);
+
+    // Draw just the triangles written this frame
+    Mesh visible = batch.mesh;
+    visible.triangleCount = static_cast<int>(m_frame_indices.size() / 3);
+    m_material.maps[MATERIAL_MAP_DIFFUSE].texture = m_texture_manager.get_texture(batch.texture);
+    DrawMesh(visible, m_material, MatrixIdentity());
+
+    m_stats.draw_calls++;
+    m_stats.triangles += static_cast<uint32_t>(visible.triangleCount);
+    m_frame_indices.clear();
+}
+
+} // namespace rendering
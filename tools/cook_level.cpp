@@ -0,0 +1,130 @@
+// Cooks a JSON level into the binary format the game loads at startup:
+// builds the BSP tree and PVS, writes them with the geometry, then loads
+// the written file back and checks it sees exactly what the source level
+// does (the PVS of every leaf, and frustum visibility from inside every
+// sector) before reporting success.
+//
+// Usage: cook_level <level.json> <level.ywlevel>
+
+#include "game/bsp.h"
+#include "game/camera.h"
+#include "game/cooked_level.h"
+#include "game/json_level.h"
+#include "game/level.h"
+#include "game/pvs.h"
+#include "game/visibility_query.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace {
+
+double elapsed_ms(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+// Same visible sectors per leaf in both sets
+bool same_pvs(const game::Level& source, const game::Level& cooked) {
+    const game::PotentiallyVisibleSet* expected = source.get_pvs();
+    const game::PotentiallyVisibleSet* actual = cooked.get_pvs();
+    if (!expected || !actual || !actual->is_built()) {
+        return false;
+    }
+    std::vector<uint32_t> expected_sectors;
+    std::vector<uint32_t> actual_sectors;
+    const game::BSPTree& tree = *source.get_bsp_tree();
+    for (uint32_t node = 0; node < tree.get_nodes().size(); ++node) {
+        if (!tree.get_node(node).is_leaf()) {
+            continue;
+        }
+        expected->get_visible_sectors(node, expected_sectors);
+        actual->get_visible_sectors(node, actual_sectors);
+        if (expected_sectors != actual_sectors) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Same frustum visibility, looking four ways from the middle of every sector
+bool same_visibility(const game::Level& source, const game::Level& cooked) {
+    game::VisibilityQuery expected_query;
+    game::VisibilityQuery actual_query;
+    const game::LevelGeometry& geometry = source.get_geometry();
+    for (const game::Sector& sector : source.get_sectors()) {
+        if (sector.vertex_count == 0) {
+            continue;
+        }
+        float x = 0.0f;
+        float z = 0.0f;
+        for (uint32_t i = 0; i < sector.vertex_count; ++i) {
+            uint32_t vertex = geometry.vertex_indices[sector.first_vertex + i];
+            x += geometry.vertex_x[vertex];
+            z += geometry.vertex_z[vertex];
+        }
+        x /= static_cast<float>(sector.vertex_count);
+        z /= static_cast<float>(sector.vertex_count);
+        float eye = sector.floor_height + 1.7f;
+
+        for (int view = 0; view < 4; ++view) {
+            float yaw = 1.5707963f * static_cast<float>(view);
+            game::Camera camera({x, eye, z}, {x + sinf(yaw), eye, z + cosf(yaw)}, 75.0f);
+            game::Frustum frustum = camera.get_frustum(16.0f / 9.0f);
+            core::Span<const uint32_t> expected = expected_query.run(source, frustum);
+            core::Span<const uint32_t> actual = actual_query.run(cooked, frustum);
+            if (expected.size() != actual.size() ||
+                !std::equal(expected.begin(), expected.end(), actual.begin())) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc != 3) {
+        fprintf(stderr, "usage: cook_level <level.json> <level.ywlevel>\n");
+        return 2;
+    }
+    const std::string source_path = argv[1];
+    const std::string cooked_path = argv[2];
+
+    std::string error;
+    game::Level level;
+    if (!game::JsonLevel::load(source_path, level, &error)) {
+        fprintf(stderr, "cook_level: %s: %s\n", source_path.c_str(), error.c_str());
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    level.build_bsp();
+    level.build_pvs();
+    double build_ms = elapsed_ms(start);
+
+    if (!game::CookedLevel::write(level, cooked_path, &error)) {
+        fprintf(stderr, "cook_level: %s: %s\n", cooked_path.c_str(), error.c_str());
+        return 1;
+    }
+
+    game::Level cooked;
+    if (!game::CookedLevel::load(cooked_path, cooked, &error)) {
+        fprintf(stderr, "cook_level: %s: reload failed: %s\n", cooked_path.c_str(), error.c_str());
+        return 1;
+    }
+    if (cooked.get_sectors().size() != level.get_sectors().size() ||
+        !same_pvs(level, cooked) || !same_visibility(level, cooked)) {
+        fprintf(stderr, "cook_level: %s: reloaded level sees differently\n", cooked_path.c_str());
+        return 1;
+    }
+
+    printf("%s -> %s: %zu sectors, %zu BSP nodes, built in %.1f ms, verified\n",
+           source_path.c_str(), cooked_path.c_str(), level.get_sectors().size(),
+           level.get_bsp_tree()->get_nodes().size(), build_ms);
+    return 0;
+}